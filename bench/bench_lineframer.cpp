@@ -0,0 +1,130 @@
+/**
+ * @file bench_lineframer.cpp
+ * @brief Micro-benchmark: legacy QByteArray indexOf/left/remove framing vs. LineFramer.
+ *
+ * Usage: bench_lineframer [capture.bin] [chunkBytes] [repeat]
+ * The capture is a raw RX byte stream (as read from the port); it is replayed
+ * `repeat` times in `chunkBytes` slices to mimic readyRead() granularity.
+ */
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+#include <cstdio>
+
+#include "../src/services/lineframer.h"
+
+#ifndef FIRST1_BENCH_DATA_DIR
+#define FIRST1_BENCH_DATA_DIR "."
+#endif
+
+namespace
+{
+struct Result
+{
+    qint64 frames = 0;
+    qint64 checksum = 0;
+    qint64 ns = 0;
+};
+
+// Mirrors the original SerialService::onReadyRead().
+Result runLegacy(const QByteArray& stream, int chunk, int repeat)
+{
+    Result r;
+    QByteArray rxBuffer;
+    QElapsedTimer t;
+    t.start();
+    for (int rep = 0; rep < repeat; ++rep)
+    {
+        for (qsizetype off = 0; off < stream.size(); off += chunk)
+        {
+            rxBuffer.append(stream.constData() + off, qMin<qsizetype>(chunk, stream.size() - off));
+            while (true)
+            {
+                const int end = rxBuffer.indexOf('\n');
+                if (end < 0)
+                {
+                    if (rxBuffer.size() > 8192)
+                        rxBuffer.clear();
+                    break;
+                }
+                const QByteArray line = rxBuffer.left(end + 1);
+                rxBuffer.remove(0, end + 1);
+                const QString frame = QString::fromUtf8(line).trimmed();
+                if (!frame.isEmpty())
+                {
+                    ++r.frames;
+                    r.checksum += frame.size();
+                }
+            }
+        }
+    }
+    r.ns = t.nsecsElapsed();
+    return r;
+}
+
+Result runFramer(const QByteArray& stream, int chunk, int repeat, bool copyOut)
+{
+    Result r;
+    LineFramer framer(8192);
+    QElapsedTimer t;
+    t.start();
+    auto sink = [&](QByteArrayView line) {
+        ++r.frames;
+        if (copyOut)
+            r.checksum += line.toByteArray().size();
+        else
+            r.checksum += line.size();
+    };
+    for (int rep = 0; rep < repeat; ++rep)
+    {
+        for (qsizetype off = 0; off < stream.size(); off += chunk)
+            framer.feed(stream.constData() + off, qMin<qsizetype>(chunk, stream.size() - off), sink);
+    }
+    r.ns = t.nsecsElapsed();
+    return r;
+}
+
+void report(const char* name, const Result& r, qint64 bytes)
+{
+    const double nsPerFrame = r.frames > 0 ? double(r.ns) / double(r.frames) : 0.0;
+    const double mbPerSec = r.ns > 0 ? (double(bytes) / (1024.0 * 1024.0)) / (double(r.ns) / 1e9) : 0.0;
+    std::printf("%-22s frames=%-9lld ns/frame=%8.1f  MB/s=%8.1f  (checksum %lld)\n",
+                name, static_cast<long long>(r.frames), nsPerFrame, mbPerSec,
+                static_cast<long long>(r.checksum));
+}
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const QString path = (argc > 1) ? QString::fromLocal8Bit(argv[1])
+                                    : QStringLiteral(FIRST1_BENCH_DATA_DIR "/rx_capture.bin");
+    const int chunk = (argc > 2) ? qMax(1, atoi(argv[2])) : 64;
+    const int repeat = (argc > 3) ? qMax(1, atoi(argv[3])) : 200;
+
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+    {
+        std::fprintf(stderr, "cannot open capture: %s\n", qPrintable(path));
+        return 1;
+    }
+    const QByteArray stream = f.readAll();
+    const qint64 totalBytes = stream.size() * qint64(repeat);
+
+    std::printf("capture=%s bytes=%lld chunk=%d repeat=%d\n",
+                qPrintable(path), static_cast<long long>(stream.size()), chunk, repeat);
+
+    // Warm-up
+    runLegacy(stream, chunk, 1);
+    runFramer(stream, chunk, 1, true);
+
+    report("legacy (QString)", runLegacy(stream, chunk, repeat), totalBytes);
+    report("LineFramer (view)", runFramer(stream, chunk, repeat, false), totalBytes);
+    report("LineFramer (copy)", runFramer(stream, chunk, repeat, true), totalBytes);
+    return 0;
+}
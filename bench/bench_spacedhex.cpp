@@ -0,0 +1,129 @@
+/**
+ * @file bench_spacedhex.cpp
+ * @brief Micro-benchmark: legacy QStringList bytesToSpacedHex vs. scalar vs. SIMD encodeSpacedHex.
+ *
+ * Usage: bench_spacedhex [payloadBytes] [repeat]
+ * Without arguments runs 32 B (short prompt), 512 B and 4096 B (long announcement)
+ * payloads. Each encoder's output is checked against the legacy one before timing.
+ */
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QString>
+#include <QStringList>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "../src/core/spacedhex.h"
+
+namespace
+{
+struct Result
+{
+    qint64 ns = 0;
+    qint64 checksum = 0;
+};
+
+// Mirrors the original Protocol bytesToSpacedHex().
+QString legacyBytesToSpacedHex(const QByteArray& bytes)
+{
+    QStringList parts;
+    parts.reserve(bytes.size());
+    for (unsigned char b : bytes)
+        parts << QString::number(b, 16).rightJustified(2, QChar('0')).toUpper();
+    return parts.join(' ');
+}
+
+Result runLegacy(const QByteArray& payload, int repeat)
+{
+    Result r;
+    QElapsedTimer t;
+    t.start();
+    for (int rep = 0; rep < repeat; ++rep)
+    {
+        const QString hex = legacyBytesToSpacedHex(payload);
+        r.checksum += hex.size() + hex.at(hex.size() / 2).unicode();
+    }
+    r.ns = t.nsecsElapsed();
+    return r;
+}
+
+template <typename Encode>
+Result runEncoder(const QByteArray& payload, int repeat, Encode encode)
+{
+    Result r;
+    QByteArray out(Protocol::spacedHexSize(payload.size()), Qt::Uninitialized); // preallocated, reused
+    QElapsedTimer t;
+    t.start();
+    for (int rep = 0; rep < repeat; ++rep)
+    {
+        encode(payload.constData(), payload.size(), out.data());
+        r.checksum += out.size() + quint8(out.at(out.size() / 2));
+    }
+    r.ns = t.nsecsElapsed();
+    return r;
+}
+
+void report(const char* name, const Result& r, qint64 bytes, int repeat)
+{
+    const double nsPerCall = double(r.ns) / double(repeat);
+    const double mbPerSec = r.ns > 0 ? (double(bytes) * repeat / (1024.0 * 1024.0)) / (double(r.ns) / 1e9) : 0.0;
+    std::printf("  %-18s ns/call=%10.1f  MB/s=%9.1f  (checksum %lld)\n",
+                name, nsPerCall, mbPerSec, static_cast<long long>(r.checksum));
+}
+
+bool verify(const QByteArray& payload)
+{
+    const QByteArray expect = legacyBytesToSpacedHex(payload).toLatin1();
+    QByteArray a(Protocol::spacedHexSize(payload.size()), Qt::Uninitialized);
+    QByteArray b(a.size(), Qt::Uninitialized);
+    Protocol::encodeSpacedHexScalar(payload.constData(), payload.size(), a.data());
+    Protocol::encodeSpacedHex(payload.constData(), payload.size(), b.data());
+    return a == expect && b == expect;
+}
+
+bool runSize(int bytes, int repeat)
+{
+    QByteArray payload(bytes, Qt::Uninitialized);
+    QRandomGenerator rng(42);
+    for (char& c : payload)
+        c = char(rng.bounded(256));
+
+    std::printf("payload=%d bytes repeat=%d\n", bytes, repeat);
+    if (!verify(payload))
+    {
+        std::fprintf(stderr, "  output mismatch against legacy encoder\n");
+        return false;
+    }
+
+    // Warm-up
+    runLegacy(payload, 1);
+    runEncoder(payload, 1, Protocol::encodeSpacedHex);
+
+    report("legacy (QString)", runLegacy(payload, repeat), bytes, repeat);
+    report("scalar", runEncoder(payload, repeat, Protocol::encodeSpacedHexScalar), bytes, repeat);
+    report(Protocol::spacedHexImplementation(), runEncoder(payload, repeat, Protocol::encodeSpacedHex), bytes, repeat);
+    return true;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const int repeat = (argc > 2) ? qMax(1, atoi(argv[2])) : 20000;
+    bool ok = true;
+    if (argc > 1)
+    {
+        ok = runSize(qMax(1, atoi(argv[1])), repeat);
+    }
+    else
+    {
+        for (int bytes : {32, 512, 4096})
+            ok = runSize(bytes, repeat) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -10,6 +10,7 @@
 #include <QFontMetrics>
 #include <QGroupBox>
 #include <QComboBox>
+#include <QCheckBox>
 #include <QSpinBox>
 #include <QMessageBox>
 #include <QFileDialog>
@@ -37,15 +38,16 @@
 #include <QSlider>
 #include <QSignalBlocker>
 #include <QSet>
-#include <QTimer>
-#include <QSerialPortInfo>
 #include <QCloseEvent>
 #include <QKeyEvent>
 
 #include "src/config/appsettings.h"
 #include "src/services/serialservice.h"
+#include "src/services/transport.h"
 #include "src/core/excelimporter.h"
+#include "src/core/fixturestation.h"
 #include "src/core/randomcolorresolver.h"
+#include "src/core/runcheckpoint.h"
 #include "src/core/workflowengine.h"
 #include "src/core/models.h"
 #include "src/core/protocol.h"
@@ -58,20 +60,18 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
     m_serial   = new SerialService(this);
+    m_serial->setPortWatchEnabled(true);
     m_engine   = new WorkflowEngine(this);
     m_importer = new ExcelImporter(this);
     m_engine->setSerialService(m_serial);
+    m_station  = new FixtureStation(m_engine, this);
+    m_engine->setCheckpointPath(RunCheckpoint::defaultPath());
 
     loadSettings();
     buildUi();
     wireSignals();
     qApp->installEventFilter(this);
 
-    m_portRefreshTimer = new QTimer(this);
-    m_portRefreshTimer->setInterval(500);
-    connect(m_portRefreshTimer, &QTimer::timeout, this, &MainWindow::onRefreshPorts);
-    m_portRefreshTimer->start();
-
     // Models / delegates
     m_queueModel = new QueueTableModel(this);
     m_tblQueue->setModel(m_queueModel);
@@ -130,6 +130,8 @@ MainWindow::MainWindow(QWidget *parent)
     m_serial->refreshPorts();
     m_uiState = UiRunState::NoConfig;
     applyUiState();
+    if (QFileInfo::exists(RunCheckpoint::defaultPath()))
+        m_lblHint->setText(tr("检测到未完成的 Run，打开串口后可点击“恢复”从中断处继续。"));
     m_hotkeyAutoSaveEnabled = true;
 }
 
@@ -242,6 +244,9 @@ QWidget* MainWindow::buildStatusPage()
     auto* gbSerial = new QGroupBox(tr("串口设置"), page);
     auto* gSerial = new QGridLayout(gbSerial);
     m_cmbPort = new QComboBox(gbSerial);
+    m_cmbPort->setEditable(true);
+    m_cmbPort->setInsertPolicy(QComboBox::NoInsert);
+    m_cmbPort->setToolTip(tr("串口名，或 pty / tcp://127.0.0.1:5555 / mem://sim"));
     m_btnOpenClose = new QPushButton(tr("打开串口"), gbSerial);
     gSerial->addWidget(new QLabel(tr("端口"), gbSerial), 0, 0);
     gSerial->addWidget(m_cmbPort, 0, 1);
@@ -267,10 +272,16 @@ QWidget* MainWindow::buildStatusPage()
     auto* left = new QVBoxLayout();
     m_btnStart = new QPushButton(tr("开始"), page);
     m_btnNext  = new QPushButton(tr("下一步"), page);
+    m_btnResume = new QPushButton(tr("恢复"), page);
+    m_btnResume->setToolTip(tr("从上次中断的 Run 继续：同样的颜色与段位置，无需重新导入 Excel"));
+    m_chkAutoplay = new QCheckBox(tr("自动连播"), page);
+    m_chkAutoplay->setToolTip(tr("每段执行完（收到最后一步 STEPRUN）后自动下发下一段"));
     m_btnMarkRerun = new QPushButton(tr("标记需重做"), page);
     m_btnReset = new QPushButton(tr("重置"), page);
     left->addWidget(m_btnStart);
+    left->addWidget(m_btnResume);
     left->addWidget(m_btnNext);
+    left->addWidget(m_chkAutoplay);
     left->addWidget(m_btnMarkRerun);
     left->addWidget(m_btnReset);
     left->addStretch(1);
@@ -500,6 +511,8 @@ void MainWindow::wireSignals()
     connect(m_btnApplyConfig, &QPushButton::clicked, this, &MainWindow::onApplyConfig);
     connect(m_btnStart, &QPushButton::clicked, this, &MainWindow::onStart);
     connect(m_btnNext, &QPushButton::clicked, this, &MainWindow::onNext);
+    connect(m_btnResume, &QPushButton::clicked, this, &MainWindow::onResume);
+    connect(m_chkAutoplay, &QCheckBox::toggled, this, &MainWindow::onAutoplayToggled);
     connect(m_btnMarkRerun, &QPushButton::clicked, this, &MainWindow::onMarkRerun);
     connect(m_btnReset, &QPushButton::clicked, this, &MainWindow::onReset);
 
@@ -507,8 +520,13 @@ void MainWindow::wireSignals()
     connect(m_btnOpenClose, &QPushButton::clicked, this, &MainWindow::onOpenCloseSerial);
     connect(m_cmbPort, &QComboBox::currentTextChanged, this, &MainWindow::onPortSelectionChanged);
     connect(m_serial, &SerialService::portsUpdated, this, &MainWindow::onPortsUpdated);
+    connect(m_serial, &SerialService::portsAdded, this, &MainWindow::onPortsAdded);
+    connect(m_serial, &SerialService::portsRemoved, this, &MainWindow::onPortsRemoved);
     connect(m_serial, &SerialService::opened, this, &MainWindow::onSerialOpened);
     connect(m_serial, &SerialService::closed, this, &MainWindow::onSerialClosed);
+    connect(m_serial, &SerialService::transportReady, this, [this](const QString& description) {
+        statusBar()->showMessage(tr("已连接：%1").arg(description));
+    });
     connect(m_serial, &SerialService::error, this, &MainWindow::onSerialError);
 
     // device
@@ -548,9 +566,35 @@ void MainWindow::wireSignals()
     connect(m_engine, &WorkflowEngine::segmentStarted, this, &MainWindow::onEngineSegmentStarted);
     connect(m_engine, &WorkflowEngine::actionStarted, this, [](int, const QString&, const QString&) {});
     connect(m_engine, &WorkflowEngine::progressUpdated, this, &MainWindow::onEngineProgressUpdated);
+    connect(m_engine, &WorkflowEngine::stepTimingSlow, this,
+            [this](const QString& flow, int step, qint64 predictedMs, qint64 actualMs) {
+                m_queueModel->setStepSlow(flow, step, predictedMs, actualMs); // model is created after wireSignals()
+            });
+    wireStationSignals();
     connect(m_engine, &WorkflowEngine::rerunMarked, this, &MainWindow::onEngineRerunMarked);
     connect(m_engine, &WorkflowEngine::logLine, this, &MainWindow::onEngineLogLine);
-    connect(m_serial, &SerialService::rxRaw, m_engine, &WorkflowEngine::onSerialFrame);
+    connect(m_serial, &SerialService::rxLine, m_engine, &WorkflowEngine::onSerialLine);
+    connect(m_engine, &WorkflowEngine::deviceReport, this, [this](bool fault, int code, const QString& detail) {
+        const QString text = fault ? tr("下位机故障 %1：%2").arg(code).arg(detail)
+                                   : tr("下位机报错 %1：%2").arg(code).arg(detail);
+        statusBar()->showMessage(text, 8000);
+        if (fault)
+            m_lblHint->setText(text);
+    });
+    connect(m_engine, &WorkflowEngine::autoplayChanged, this, [this](bool on) {
+        {
+            QSignalBlocker blocker(m_chkAutoplay);
+            m_chkAutoplay->setChecked(on);
+        }
+        applyUiState();
+    });
+    connect(m_engine, &WorkflowEngine::protocolNegotiated, this, [this](int version, bool binary, bool sequenced) {
+        statusBar()->showMessage(version > 0
+            ? tr("下位机协议 v%1，%2%3").arg(version)
+                  .arg(binary ? tr("二进制帧") : tr("文本帧"))
+                  .arg(sequenced ? tr("，序号确认") : QString())
+            : tr("下位机未响应版本握手，使用文本帧"), 5000);
+    });
 }
 
 void MainWindow::applyUiState()
@@ -560,7 +604,8 @@ void MainWindow::applyUiState()
 
     m_btnApplyConfig->setEnabled(true);
     m_btnStart->setEnabled(hasConfig);
-    m_btnNext->setEnabled(started);
+    m_btnResume->setEnabled(!started && QFileInfo::exists(RunCheckpoint::defaultPath()));
+    m_btnNext->setEnabled(started && !m_engine->isAutoplay()); // autoplay dispatches by itself
     m_btnMarkRerun->setEnabled(hasConfig);
     m_btnReset->setEnabled(hasConfig);
     enableTestHotkeys(!started);
@@ -674,6 +719,11 @@ void MainWindow::closeEvent(QCloseEvent* event)
     m_settings->conflicts = m_conflictModel->triples();
     AppSettings::save(*m_settings);
 
+    if (m_engine)
+        m_engine->finishRun();
+    if (m_station)
+        m_station->closeFixtures(); // finishes their runs first
+
     QMainWindow::closeEvent(event);
 }
 
@@ -828,42 +878,156 @@ void MainWindow::onStart()
         return;
     }
 
-    m_engine->setDeviceProps(m_settings->device);
-    m_engine->setColors(m_settings->colors);
-    m_engine->setVoiceSets(m_settings->voice1, m_settings->voice2);
+    m_engine->applyRunSettings(*m_settings);
+    m_station->applyRunSettings(*m_settings);
+    m_station->setMode(FixtureStation::modeFromString(m_settings->station.mode));
     m_engine->beginRun();
+    m_station->beginRun();
+    m_engine->sendConfigs();
+    m_station->sendConfigs();
+    RunCheckpoint::Display display;
+    display.excelPath = m_excelPath;
+    display.tableRows = m_importer->tableRows();
+    display.tableColumnStart = m_importer->tableColumnStart();
+    display.tableColumnCount = m_importer->tableColumnCount();
+    if (m_station->mode() == FixtureStation::Mode::Shard && m_station->fixtureCount() > 1)
+        display.actions = resolved; // fixture 0's own plan is only its share of the segments
+    m_engine->setCheckpointDisplay(display);
+    m_station->loadPlan(resolved); // fixture 0 (m_engine) included
+    m_fixtureFlows.clear();
+    m_queueModel->clearFlowStates();
+    m_queueModel->clearStepTimes();
+
+    m_uiState = UiRunState::Started;
+    applyUiState();
+    if (m_engine->isAutoplay())
+        onNext(); // unattended: the first segment goes out right away
+}
+
+void MainWindow::onResume()
+{
+    if (!m_settings || m_uiState == UiRunState::Started || m_uiState == UiRunState::Running)
+        return;
+    if (!m_serial->isOpen())
+    {
+        QMessageBox::warning(this, tr("恢复失败"), tr("请先打开串口（多治具时其余治具随主串口一起打开）。"));
+        return;
+    }
+
+    RunCheckpoint::Checkpoint cp;
+    QString err;
+    if (!RunCheckpoint::load(RunCheckpoint::defaultPath(), cp, err))
+    {
+        QMessageBox::warning(this, tr("恢复失败"), err);
+        return;
+    }
+
+    // The plan was compiled with this LED count (the Excel may have overridden the setting).
+    if (cp.ledCount > 0)
+    {
+        m_settings->device.ledCount = cp.ledCount;
+        m_spLedCount->setValue(cp.ledCount);
+    }
+    m_engine->applyRunSettings(*m_settings);
+    m_station->applyRunSettings(*m_settings);
+    m_station->setMode(FixtureStation::modeFromString(m_settings->station.mode));
+    if (!m_engine->resumeRun(cp, err))
+    {
+        QMessageBox::warning(this, tr("恢复失败"), err);
+        return;
+    }
+    QString stationErr;
+    if (!m_station->resumeRun(stationErr))
+        onEngineLogLine(tr("部分治具未恢复：%1").arg(stationErr));
     m_engine->sendConfigs();
-    m_engine->loadPlan(resolved);
+    m_station->sendConfigs();
+
+    // Queue table straight from the checkpoint: the whole resolved plan, and per fixture the
+    // segments it has finished (a segment still executing at the crash is not done).
+    m_excelPath = cp.display.excelPath;
+    m_editExcelPath->setText(m_excelPath);
+    m_queueModel->setTableRows(cp.display.tableRows, cp.display.tableColumnStart, cp.display.tableColumnCount);
+    m_queueModel->setActions(cp.display.actions.isEmpty() ? cp.actions : cp.display.actions);
+    refreshQueueLedColors();
     m_queueModel->clearFlowStates();
     m_queueModel->clearStepTimes();
+    const bool shard = !cp.display.actions.isEmpty(); // else every fixture runs every segment
+    int segmentsTotal = 0;
+    int segmentsDone = 0;
+    for (int f = 0; f < m_station->fixtureCount(); ++f)
+    {
+        const WorkflowEngine* e = m_station->engine(f);
+        const QVector<Segment>& segments = e->segments();
+        const int done = qMin(e->currentSegmentIndex() + 1, int(segments.size()));
+        for (int i = 0; i < done; ++i)
+            m_queueModel->setFlowDone(e->plan()[segments[i].startIndex].flowName);
+        if (f == 0 || shard)
+        {
+            segmentsTotal += int(segments.size());
+            segmentsDone += done;
+        }
+        const int rerun = e->markedRerunSegment();
+        if (rerun >= 0 && rerun < segments.size())
+            m_queueModel->setFlowRerunMarked(e->plan()[segments[rerun].startIndex].flowName);
+    }
+    applyQueueColumnLayout();
+    m_fixtureFlows.clear();
+    m_currentFlowName.clear();
 
+    m_configApplied = true;
     m_uiState = UiRunState::Started;
     applyUiState();
+    m_lblHint->setText(tr("已从断点恢复：共 %1 段，已完成 %2 段").arg(segmentsTotal).arg(segmentsDone));
+    if (m_engine->isAutoplay())
+        onNext();
 }
 
 void MainWindow::onNext()
 {
     if (m_uiState != UiRunState::Started)
         return;
+    if (m_engine->isAutoplay() && m_engine->isAwaitingSegment())
+        return; // hotkey during autoplay: the engine sends the next segment itself
+    m_engine->noteTrigger();
     m_uiState = UiRunState::Running;
     applyUiState();
     m_engine->runNextSegment();
+    m_station->runNextSegment();
+}
+
+void MainWindow::onAutoplayToggled(bool on)
+{
+    if (m_settings)
+        m_engine->setAutoplayGapMs(m_settings->run.autoplayGapMs);
+    m_engine->setAutoplay(on);
+    m_station->setAutoplay(on);
+    applyUiState();
+    // Switched on between segments: kick off; otherwise the segment in flight continues the chain.
+    if (on && m_uiState == UiRunState::Started && !m_engine->isAwaitingSegment())
+        onNext();
 }
 
 void MainWindow::onMarkRerun()
 {
     if (!m_configApplied) return;
     m_engine->markCurrentOrPreviousSegmentForRerun();
+    m_station->markCurrentOrPreviousSegmentForRerun();
     m_lblHint->setText(tr("已标记需重做段，下一次执行优先重做。"));
 }
 
 void MainWindow::onReset()
 {
+    m_engine->finishRun();
     m_engine->resetRun();
+    m_engine->discardCheckpoint();
+    m_station->finishRun();
+    m_station->resetRun();
+    m_station->discardCheckpoints();
+    m_fixtureFlows.clear();
     m_uiState = m_configApplied ? UiRunState::Ready : UiRunState::NoConfig;
     m_lblHint->clear();
     m_currentFlowName.clear();
-    if (m_importer)
+    if (m_importer && !m_importer->actions().isEmpty()) // after a resume the table came from the checkpoint
     {
         m_queueModel->setTableRows(m_importer->tableRows(),
                                    m_importer->tableColumnStart(),
@@ -876,33 +1040,41 @@ void MainWindow::onReset()
 }
 
 // ================= Serial =================
-void MainWindow::onRefreshPorts()
+void MainWindow::onPortsAdded(const QStringList &ports)
 {
-    if (!m_serial)
-        return;
+    const QSignalBlocker blocker(m_cmbPort);
+    const QString current = m_cmbPort->currentText();
+    for (const QString& p : ports)
+    {
+        if (m_cmbPort->findText(p, Qt::MatchExactly) < 0)
+            m_cmbPort->addItem(p);
+    }
 
-    if (m_serial->isOpen())
+    if (!current.isEmpty())
     {
-        const QString current = m_cmbPort ? m_cmbPort->currentText() : QString();
-        bool exists = false;
-        const auto infos = QSerialPortInfo::availablePorts();
-        for (const auto& info : infos)
-        {
-            if (info.portName() == current)
-            {
-                exists = true;
-                break;
-            }
-        }
-        if (!exists)
-        {
-            m_serial->closePort();
-            m_serial->refreshPorts();
-        }
+        m_cmbPort->setEditText(current);
         return;
     }
+    const QString preferred = m_settings ? m_settings->serial.portName : QString();
+    const int idx = preferred.isEmpty() ? -1 : m_cmbPort->findText(preferred, Qt::MatchExactly);
+    m_cmbPort->setCurrentIndex(idx >= 0 ? idx : 0);
+}
 
-    m_serial->refreshPorts();
+void MainWindow::onPortsRemoved(const QStringList &ports)
+{
+    const QString current = m_cmbPort->currentText();
+    if (m_serial->isOpen() && ports.contains(current))
+        m_serial->closePort();
+
+    const QSignalBlocker blocker(m_cmbPort);
+    for (const QString& p : ports)
+    {
+        const int idx = m_cmbPort->findText(p, Qt::MatchExactly);
+        if (idx >= 0)
+            m_cmbPort->removeItem(idx);
+    }
+    if (!ports.contains(current))
+        m_cmbPort->setEditText(current);
 }
 
 void MainWindow::onPortsUpdated(const QStringList &ports)
@@ -911,6 +1083,14 @@ void MainWindow::onPortsUpdated(const QStringList &ports)
     QString preferred = m_cmbPort ? m_cmbPort->currentText() : QString();
     if (preferred.isEmpty() && m_settings)
         preferred = m_settings->serial.portName;
+
+    // The combo is editable: leave what the user is typing alone unless the list changed.
+    QStringList currentItems;
+    for (int i = 0; i < m_cmbPort->count(); ++i)
+        currentItems << m_cmbPort->itemText(i);
+    if (currentItems == ports && !m_cmbPort->currentText().isEmpty())
+        return;
+
     m_cmbPort->clear();
     m_cmbPort->addItems(ports);
     if (!preferred.isEmpty())
@@ -921,6 +1101,11 @@ void MainWindow::onPortsUpdated(const QStringList &ports)
             m_cmbPort->setCurrentIndex(idx);
             return;
         }
+        if (!Transport::isSerialPortSpec(preferred) || preferred.contains('/'))
+        {
+            m_cmbPort->setEditText(preferred);
+            return;
+        }
     }
     if (m_cmbPort->count() > 0)
         m_cmbPort->setCurrentIndex(0);
@@ -938,6 +1123,7 @@ void MainWindow::onOpenCloseSerial()
     if (m_serial->isOpen())
     {
         m_serial->closePort();
+        m_station->closeFixtures();
         return;
     }
     const QString port = m_cmbPort->currentText();
@@ -951,7 +1137,15 @@ void MainWindow::onOpenCloseSerial()
     const QString parity = QStringLiteral("None");
     const int stopBits = 1;
 
+    if (m_settings)
+    {
+        m_serial->setThreadedIo(m_settings->serial.threadedIo);
+        m_serial->setTxLimits(m_settings->serial.txInFlightBytes, m_settings->serial.txCoalesceBytes);
+        m_engine->applySerialSettings(m_settings->serial);
+    }
     m_serial->openPort(port, baud, dataBits, parity, stopBits);
+    if (m_settings && !m_settings->station.extraPorts.isEmpty())
+        m_station->openFixtures(m_settings->station.extraPorts, *m_settings);
 
     if (m_settings)
     {
@@ -1639,21 +1833,66 @@ void MainWindow::onEngineSegmentStarted(const QString &name, int startRow, int e
 
 void MainWindow::onEngineProgressUpdated(int currentStep, qint64 deviceMs)
 {
-    m_lblHint->setText(tr("下位机进度：Step=%1  DeviceMs=%2").arg(currentStep).arg(deviceMs));
-    if (!m_currentFlowName.isEmpty())
+    const double clockErrMs = m_engine ? m_engine->deviceClockErrorMs() : -1.0;
+    if (clockErrMs >= 0.0)
+        m_lblHint->setText(tr("下位机进度：Step=%1  DeviceMs=%2  时钟误差 ±%3 ms")
+                               .arg(currentStep)
+                               .arg(deviceMs)
+                               .arg(clockErrMs, 0, 'f', 1));
+    else
+        m_lblHint->setText(tr("下位机进度：Step=%1  DeviceMs=%2").arg(currentStep).arg(deviceMs));
+    advanceFlowStep(m_currentFlowName, currentStep, deviceMs);
+}
+
+void MainWindow::advanceFlowStep(QString& flowName, int currentStep, qint64 deviceMs)
+{
+    if (flowName.isEmpty())
+        return;
+    m_queueModel->setStepTime(flowName, currentStep, deviceMs);
+    const int stepCount = m_queueModel->stepCountForFlow(flowName);
+    if (stepCount > 0 && currentStep >= stepCount)
     {
-        m_queueModel->setStepTime(m_currentFlowName, currentStep, deviceMs);
-        const int stepCount = m_queueModel->stepCountForFlow(m_currentFlowName);
-        if (stepCount > 0 && currentStep >= stepCount)
-        {
-            m_queueModel->setFlowDone(m_currentFlowName);
-            m_currentFlowName.clear();
-        }
-        else
-        {
-            m_queueModel->setStepRunning(m_currentFlowName, currentStep + 1);
-        }
+        m_queueModel->setFlowDone(flowName);
+        flowName.clear();
     }
+    else
+    {
+        m_queueModel->setStepRunning(flowName, currentStep + 1);
+    }
+}
+
+void MainWindow::wireStationSignals()
+{
+    connect(m_station, &FixtureStation::fixtureLog, this, [this](int fixture, const QString& line) {
+        onEngineLogLine(QStringLiteral("[#%1] %2").arg(fixture).arg(line));
+    });
+    connect(m_station, &FixtureStation::fixtureOpened, this, [this](int fixture, bool ok, const QString& err) {
+        if (!ok)
+            m_lblHint->setText(tr("治具 #%1 打开失败：%2").arg(fixture).arg(err));
+    });
+    connect(m_station, &FixtureStation::fixtureStepSlow, this,
+            [this](int, const QString& flow, int step, qint64 predictedMs, qint64 actualMs) {
+                m_queueModel->setStepSlow(flow, step, predictedMs, actualMs);
+            });
+
+    // Shard mode: every fixture runs flows of its own, so their progress goes to the queue table too.
+    // In broadcast mode fixture 0 already shows the same flows.
+    connect(m_station, &FixtureStation::fixtureSegmentStarted, this,
+            [this](int fixture, const QString&, int startRow, int) {
+                WorkflowEngine* e = m_station->engine(fixture);
+                if (m_station->mode() != FixtureStation::Mode::Shard || !e || startRow < 0
+                    || startRow >= e->plan().size())
+                    return;
+                const QString flow = e->plan()[startRow].flowName;
+                m_fixtureFlows.insert(fixture, flow);
+                m_queueModel->setFlowRunning(flow);
+                m_queueModel->setStepRunning(flow, 1);
+            });
+    connect(m_station, &FixtureStation::fixtureProgress, this, [this](int fixture, int step, qint64 deviceMs) {
+        auto it = m_fixtureFlows.find(fixture);
+        if (it != m_fixtureFlows.end())
+            advanceFlowStep(it.value(), step, deviceMs);
+    });
 }
 
 void MainWindow::onEngineRerunMarked(const QString& flowName)
@@ -3,6 +3,7 @@
  * @brief Main window: Status (Excel-driven queue) and Settings.
  */
 
+#include <QHash>
 #include <QMainWindow>
 #include <QPointer>
 #include <QVector>
@@ -18,14 +19,15 @@ class QTableView;
 class QLabel;
 class QComboBox;
 class QSpinBox;
+class QCheckBox;
 class QKeySequenceEdit;
 class QShortcut;
-class QTimer;
 class QModelIndex;
 class QCloseEvent;
 
 class SerialService;
 class WorkflowEngine;
+class FixtureStation;
 class ExcelImporter;
 class QueueTableModel;
 class ColorTableModel;
@@ -44,14 +46,17 @@ private slots:
     void onPickExcel();
     void onApplyConfig();
     void onStart();
+    void onResume();
     void onNext();
+    void onAutoplayToggled(bool on);
     void onMarkRerun();
     void onReset();
 
     // Settings: serial
-    void onRefreshPorts();
     void onOpenCloseSerial();
     void onPortsUpdated(const QStringList& ports);
+    void onPortsAdded(const QStringList& ports);
+    void onPortsRemoved(const QStringList& ports);
     void onPortSelectionChanged(const QString& port);
 
     // Settings: device
@@ -111,6 +116,8 @@ private:
     QWidget* buildSettingsPage();
     void wireSignals();
     void applyUiState();
+    void wireStationSignals();
+    void advanceFlowStep(QString& flowName, int currentStep, qint64 deviceMs);
 
     bool loadSettings();
     void saveSettings();
@@ -146,6 +153,8 @@ private:
 
     QPointer<SerialService>  m_serial;
     QPointer<WorkflowEngine> m_engine;
+    QPointer<FixtureStation> m_station;  ///< fixtures 1..N-1 (station/extraPorts)
+    QHash<int, QString> m_fixtureFlows;  ///< shard mode: fixture -> flow in progress
     QPointer<ExcelImporter>  m_importer;
 
     // Status page widgets
@@ -155,6 +164,8 @@ private:
     QPushButton* m_btnApplyConfig = nullptr;
     QPushButton* m_btnStart = nullptr;
     QPushButton* m_btnNext  = nullptr;
+    QPushButton* m_btnResume = nullptr;
+    QCheckBox* m_chkAutoplay = nullptr;
     QPushButton* m_btnMarkRerun = nullptr;
     QPushButton* m_btnReset = nullptr;
     QTableView* m_tblQueue = nullptr;
@@ -164,7 +175,6 @@ private:
     // Serial widgets
     QComboBox* m_cmbPort = nullptr;
     QPushButton* m_btnOpenClose = nullptr;
-    QTimer* m_portRefreshTimer = nullptr;
 
     // Device widgets
     QSpinBox* m_spOnMs = nullptr;
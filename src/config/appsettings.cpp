@@ -16,10 +16,18 @@
 #include <QDir>
 
 // ==============================
-// ini 路径：程序目录 ./config.ini
+// ini 路径：程序目录 ./config.ini（命令行可用 setIniPath 覆盖）
 // ==============================
+static QString& iniPathOverride()
+{
+    static QString path;
+    return path;
+}
+
 static QString iniPath()
 {
+    if (!iniPathOverride().isEmpty())
+        return iniPathOverride();
     const QString dir = QCoreApplication::applicationDirPath();
     return QDir(dir).filePath("config.ini");
 }
@@ -45,6 +53,15 @@ namespace Keys
     static const char* kSerialParity  = "serial/parity";
     static const char* kSerialStopBits= "serial/stopBits";
     static const char* kSerialAuto    = "serial/autoSetup";
+    static const char* kSerialThreaded= "serial/threadedIo";
+    static const char* kSerialTxInFlight = "serial/txInFlightBytes";
+    static const char* kSerialTxCoalesce = "serial/txCoalesceBytes";
+    static const char* kSerialBinary  = "serial/binaryFraming";
+    static const char* kSerialVoiceDict  = "serial/voiceDictionary";
+    static const char* kSerialPrefetch   = "serial/prefetch";
+    static const char* kSerialAckWindow  = "serial/ackWindow";
+    static const char* kSerialAckTimeout = "serial/ackTimeoutMs";
+    static const char* kSerialAckRetries = "serial/ackRetries";
 
     // device
     static const char* kDevOnMs       = "device/onMs";
@@ -53,6 +70,18 @@ namespace Keys
     static const char* kDevBrightness = "device/brightness";
     static const char* kDevBuzzFreq   = "device/buzzFreq";
     static const char* kDevBuzzDur    = "device/buzzDur";
+
+    // run
+    static const char* kRunAutoplayGap = "run/autoplayGapMs";
+    static const char* kRunLogFlush    = "run/logFlush";
+    static const char* kRunLogFlushMs  = "run/logFlushIntervalMs";
+    static const char* kRunLogFormat   = "run/logFormat";
+    static const char* kRunTimingPct   = "run/timingTolerancePct";
+    static const char* kRunTimingSlack = "run/timingSlackMs";
+    // station
+    static const char* kStationExtraPorts = "station/extraPorts";
+    static const char* kStationMode       = "station/mode";
+
     // voice1
     static const char* kVoice1Announcer  = "voice1/announcer";
     static const char* kVoice1Style      = "voice1/style";
@@ -108,6 +137,11 @@ static int keySequenceToCode(const QKeySequence& seq)
     return seq.count() > 0 ? seq[0] : 0;
 }
 
+void AppSettings::setIniPath(const QString& path)
+{
+    iniPathOverride() = path;
+}
+
 // ==============================
 // 全量读取
 // ==============================
@@ -145,6 +179,15 @@ SettingsData AppSettings::load()
     d.serial.parity    = s.value(Keys::kSerialParity, "None").toString();
     d.serial.stopBits  = s.value(Keys::kSerialStopBits, 1).toInt();
     d.serial.autoSetup = s.value(Keys::kSerialAuto, false).toBool();
+    d.serial.threadedIo= s.value(Keys::kSerialThreaded, true).toBool();
+    d.serial.txInFlightBytes = s.value(Keys::kSerialTxInFlight, 4096).toInt();
+    d.serial.txCoalesceBytes = s.value(Keys::kSerialTxCoalesce, 512).toInt();
+    d.serial.binaryFraming = s.value(Keys::kSerialBinary, false).toBool();
+    d.serial.voiceDictionary = s.value(Keys::kSerialVoiceDict, false).toBool();
+    d.serial.prefetch = s.value(Keys::kSerialPrefetch, false).toBool();
+    d.serial.ackWindow = s.value(Keys::kSerialAckWindow, 0).toInt();
+    d.serial.ackTimeoutMs = s.value(Keys::kSerialAckTimeout, 300).toInt();
+    d.serial.ackRetries = s.value(Keys::kSerialAckRetries, 3).toInt();
 
     // device
     d.device.onMs     = s.value(Keys::kDevOnMs, 350).toInt();
@@ -154,6 +197,18 @@ SettingsData AppSettings::load()
     d.device.buzzerFreq = s.value(Keys::kDevBuzzFreq, 1500).toInt();
     d.device.buzzerDurMs= s.value(Keys::kDevBuzzDur, 500).toInt();
 
+    // run
+    d.run.autoplayGapMs = s.value(Keys::kRunAutoplayGap, 500).toInt();
+    d.run.logFlush = s.value(Keys::kRunLogFlush, QStringLiteral("timed")).toString();
+    d.run.logFlushIntervalMs = s.value(Keys::kRunLogFlushMs, 200).toInt();
+    d.run.logFormat = s.value(Keys::kRunLogFormat, QStringLiteral("both")).toString();
+    d.run.timingTolerancePct = s.value(Keys::kRunTimingPct, 20).toInt();
+    d.run.timingSlackMs = s.value(Keys::kRunTimingSlack, 50).toInt();
+
+    // station
+    d.station.extraPorts = s.value(Keys::kStationExtraPorts).toStringList();
+    d.station.mode = s.value(Keys::kStationMode, QStringLiteral("broadcast")).toString();
+
     d.voice1.announcer   = s.value(Keys::kVoice1Announcer, 0).toInt();
     d.voice1.voiceStyle  = s.value(Keys::kVoice1Style, 1).toInt();
     d.voice1.voiceSpeed  = s.value(Keys::kVoice1Speed, 5).toInt();
@@ -262,6 +317,15 @@ void AppSettings::save(const SettingsData &data)
     s.setValue(Keys::kSerialParity, data.serial.parity);
     s.setValue(Keys::kSerialStopBits, data.serial.stopBits);
     s.setValue(Keys::kSerialAuto, data.serial.autoSetup);
+    s.setValue(Keys::kSerialThreaded, data.serial.threadedIo);
+    s.setValue(Keys::kSerialTxInFlight, data.serial.txInFlightBytes);
+    s.setValue(Keys::kSerialTxCoalesce, data.serial.txCoalesceBytes);
+    s.setValue(Keys::kSerialBinary, data.serial.binaryFraming);
+    s.setValue(Keys::kSerialVoiceDict, data.serial.voiceDictionary);
+    s.setValue(Keys::kSerialPrefetch, data.serial.prefetch);
+    s.setValue(Keys::kSerialAckWindow, data.serial.ackWindow);
+    s.setValue(Keys::kSerialAckTimeout, data.serial.ackTimeoutMs);
+    s.setValue(Keys::kSerialAckRetries, data.serial.ackRetries);
 
     // device
     s.setValue(Keys::kDevOnMs, data.device.onMs);
@@ -271,6 +335,16 @@ void AppSettings::save(const SettingsData &data)
     s.setValue(Keys::kDevBuzzFreq, data.device.buzzerFreq);
     s.setValue(Keys::kDevBuzzDur, data.device.buzzerDurMs);
 
+    // run
+    s.setValue(Keys::kRunAutoplayGap, data.run.autoplayGapMs);
+    s.setValue(Keys::kRunLogFlush, data.run.logFlush);
+    s.setValue(Keys::kRunLogFlushMs, data.run.logFlushIntervalMs);
+    s.setValue(Keys::kRunLogFormat, data.run.logFormat);
+    s.setValue(Keys::kRunTimingPct, data.run.timingTolerancePct);
+    s.setValue(Keys::kRunTimingSlack, data.run.timingSlackMs);
+    s.setValue(Keys::kStationExtraPorts, data.station.extraPorts);
+    s.setValue(Keys::kStationMode, data.station.mode);
+
     s.setValue(Keys::kVoice1Announcer, data.voice1.announcer);
     s.setValue(Keys::kVoice1Style, data.voice1.voiceStyle);
     s.setValue(Keys::kVoice1Speed, data.voice1.voiceSpeed);
@@ -441,6 +515,15 @@ void AppSettings::saveSerial(const SerialConfig &serial)
     s.setValue(Keys::kSerialParity, serial.parity);
     s.setValue(Keys::kSerialStopBits, serial.stopBits);
     s.setValue(Keys::kSerialAuto, serial.autoSetup);
+    s.setValue(Keys::kSerialThreaded, serial.threadedIo);
+    s.setValue(Keys::kSerialTxInFlight, serial.txInFlightBytes);
+    s.setValue(Keys::kSerialTxCoalesce, serial.txCoalesceBytes);
+    s.setValue(Keys::kSerialBinary, serial.binaryFraming);
+    s.setValue(Keys::kSerialVoiceDict, serial.voiceDictionary);
+    s.setValue(Keys::kSerialPrefetch, serial.prefetch);
+    s.setValue(Keys::kSerialAckWindow, serial.ackWindow);
+    s.setValue(Keys::kSerialAckTimeout, serial.ackTimeoutMs);
+    s.setValue(Keys::kSerialAckRetries, serial.ackRetries);
 
     s.sync();
 }
@@ -37,6 +37,15 @@ struct SerialConfig
     QString parity = "None";   ///< "None"/"Even"/"Odd"
     int stopBits = 1;          ///< 1/2
     bool autoSetup = false;    ///< 自动设置（截图里有）
+    bool threadedIo = true;    ///< 串口 I/O 运行在独立线程（SerialService::setThreadedIo）
+    int txInFlightBytes = 4096;///< TX 在途字节上限（背压）
+    int txCoalesceBytes = 512; ///< 小帧合并写上限（0=不合并）
+    bool binaryFraming = false;///< 握手协商二进制 WORK/LEDSET（设备不支持时回落文本）
+    bool voiceDictionary = false;///< 握手协商语音短语字典（VOICEDEF，设备需声明 DICT）
+    bool prefetch = false;     ///< 预取下一段到设备暂存区，触发时只发 GO（设备需声明 STAGE）
+    int ackWindow = 0;         ///< 序号/确认窗口（在途帧数，0=不用；设备需声明 SEQ）
+    int ackTimeoutMs = 300;    ///< 写出后等待 ACK 的超时
+    int ackRetries = 3;        ///< 超时/NAK 重发次数上限
 };
 
 /**
@@ -55,6 +64,28 @@ struct DeviceProps
     int buzzerDurMs = 500;     ///< ms
 };
 
+/**
+ * @brief 运行参数
+ */
+struct RunConfig
+{
+    int autoplayGapMs = 500;   ///< 自动连播：上一段完成到下一段下发的间隔
+    QString logFlush = QStringLiteral("timed"); ///< Run 日志刷新策略：line / timed / segment（RunLogWriter）
+    int logFlushIntervalMs = 200;              ///< timed 策略的写出周期
+    QString logFormat = QStringLiteral("both"); ///< 每次 Run 写的日志：text / binary / both
+    int timingTolerancePct = 20;  ///< 步时长超出预测的百分比容差（超出即标记慢步）
+    int timingSlackMs = 50;       ///< 同上，另加的绝对余量
+};
+
+/**
+ * @brief 多治具（FixtureStation）：主端口之外的治具与分配方式
+ */
+struct StationConfig
+{
+    QStringList extraPorts;               ///< 治具 1..N-1 的端口（与主端口同一格式），空 = 单治具
+    QString mode = QStringLiteral("broadcast"); ///< broadcast=每路执行全部段；shard=段轮流分给各路
+};
+
 /**
  * @brief 语音参数（VOICESET1/VOICESET2）
  */
@@ -115,6 +146,8 @@ struct SettingsData
 
     SerialConfig serial;
     DeviceProps device;
+    RunConfig run;
+    StationConfig station;
     VoiceProps voice1;
     VoiceProps voice2;
     HotkeyConfig hotkeys;
@@ -134,6 +167,7 @@ class AppSettings
 {
 public:
     // ---- 全量读写 ----
+    static void setIniPath(const QString& path); ///< 改用指定 ini（命令行 --config）；空 = 程序目录 ./config.ini
     static SettingsData load();
     static void save(const SettingsData& data);
 
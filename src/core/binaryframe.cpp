@@ -0,0 +1,142 @@
+#include "binaryframe.h"
+
+#include <array>
+
+namespace
+{
+constexpr std::array<quint16, 256> makeCrcTable()
+{
+    std::array<quint16, 256> t{};
+    for (int i = 0; i < 256; ++i)
+    {
+        quint16 c = quint16(i << 8);
+        for (int k = 0; k < 8; ++k)
+            c = (c & 0x8000) ? quint16((c << 1) ^ 0x1021) : quint16(c << 1);
+        t[size_t(i)] = c;
+    }
+    return t;
+}
+
+constexpr std::array<quint16, 256> kCrcTable = makeCrcTable();
+
+// CRC-32 (IEEE 802.3, reflected, poly 0xEDB88320)
+constexpr std::array<quint32, 256> makeCrc32Table()
+{
+    std::array<quint32, 256> t{};
+    for (quint32 i = 0; i < 256; ++i)
+    {
+        quint32 c = i;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? ((c >> 1) ^ 0xEDB88320u) : (c >> 1);
+        t[i] = c;
+    }
+    return t;
+}
+
+constexpr std::array<quint32, 256> kCrc32Table = makeCrc32Table();
+}
+
+namespace Protocol
+{
+quint16 crc16Ccitt(QByteArrayView data)
+{
+    quint16 crc = 0xFFFF;
+    const auto* p = reinterpret_cast<const quint8*>(data.data());
+    for (qsizetype i = 0; i < data.size(); ++i)
+        crc = quint16((crc << 8) ^ kCrcTable[size_t(((crc >> 8) ^ p[i]) & 0xFF)]);
+    return crc;
+}
+
+quint32 crc32(QByteArrayView data)
+{
+    quint32 crc = 0xFFFFFFFFu;
+    const auto* p = reinterpret_cast<const quint8*>(data.data());
+    for (qsizetype i = 0; i < data.size(); ++i)
+        crc = (crc >> 8) ^ kCrc32Table[(crc ^ p[i]) & 0xFF];
+    return crc ^ 0xFFFFFFFFu;
+}
+
+qsizetype beginBinaryFrame(FrameWriter& w, BinaryType type)
+{
+    const qsizetype pos = w.size();
+    w.put(char(kBinarySync)).put(char(type)).putU16LE(0);
+    return pos;
+}
+
+bool endBinaryFrame(FrameWriter& w, qsizetype headerPos, qsizetype maxPayload)
+{
+    const qsizetype payloadLen = w.size() - headerPos - kBinaryHeaderBytes;
+    if (payloadLen < 0 || payloadLen > qMin(maxPayload, kMaxBinaryPayloadBytes))
+    {
+        w.truncate(headerPos);
+        return false;
+    }
+    w.patchU16LE(headerPos + 2, quint16(payloadLen));
+    const QByteArrayView covered = QByteArrayView(w.bytes()).sliced(headerPos + 1);
+    w.putU16LE(crc16Ccitt(covered));
+    return true;
+}
+
+BinaryDecode decodeBinaryFrame(QByteArrayView buf, BinaryFrame& out, qsizetype& consumed)
+{
+    consumed = 0;
+    if (buf.size() < kBinaryHeaderBytes)
+        return BinaryDecode::NeedMore;
+
+    const auto* p = reinterpret_cast<const quint8*>(buf.data());
+    const qsizetype len = qsizetype(p[2]) | (qsizetype(p[3]) << 8);
+    const qsizetype total = kBinaryOverheadBytes + len;
+    if (buf.size() < total)
+        return BinaryDecode::NeedMore;
+
+    const quint16 want = quint16(p[total - 2]) | quint16(p[total - 1] << 8);
+    if (crc16Ccitt(buf.sliced(1, kBinaryHeaderBytes - 1 + len)) != want)
+    {
+        consumed = 1;
+        return BinaryDecode::BadCrc;
+    }
+
+    out.type = p[1];
+    out.payload = buf.sliced(kBinaryHeaderBytes, len);
+    consumed = total;
+    return BinaryDecode::Ok;
+}
+
+quint64 BinaryReader::varUInt()
+{
+    quint64 v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (m_pos >= m_data.size())
+            break;
+        const quint8 b = quint8(m_data[m_pos++]);
+        v |= quint64(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+            return v;
+    }
+    m_ok = false;
+    return 0;
+}
+
+quint8 BinaryReader::u8()
+{
+    if (m_pos >= m_data.size())
+    {
+        m_ok = false;
+        return 0;
+    }
+    return quint8(m_data[m_pos++]);
+}
+
+QByteArrayView BinaryReader::bytes(qsizetype n)
+{
+    if (n < 0 || m_pos + n > m_data.size())
+    {
+        m_ok = false;
+        return {};
+    }
+    const QByteArrayView v = m_data.sliced(m_pos, n);
+    m_pos += n;
+    return v;
+}
+} // namespace Protocol
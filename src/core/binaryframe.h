@@ -0,0 +1,110 @@
+#pragma once
+/**
+ * @file binaryframe.h
+ * @brief Optional compact binary framing (host -> device), negotiated per session.
+ *
+ * Frame layout:
+ *   0xA5 | type (u8) | payloadLen (u16 LE) | payload | CRC-16/CCITT-FALSE (u16 LE)
+ * The CRC covers type, length and payload. 0xA5 never starts an ASCII frame, so a
+ * device can accept text and binary frames on the same link.
+ *
+ * Integers in payloads are unsigned LEB128 varints (see FrameWriter::putVarUInt);
+ * voice text is raw GB2312 bytes. Payloads per type are documented in protocol.h.
+ *
+ * Device replies (STEPRUN, VER) stay ASCII/CRLF.
+ */
+
+#include <QByteArrayView>
+
+#include "framewriter.h"
+
+namespace Protocol
+{
+constexpr quint8 kBinarySync = 0xA5;
+constexpr qsizetype kBinaryHeaderBytes = 4;   ///< sync + type + len16
+constexpr qsizetype kBinaryOverheadBytes = 6; ///< header + crc16
+constexpr qsizetype kMaxBinaryPayloadBytes = 0xFFFF; ///< u16 length field
+
+/**
+ * @brief Room kept free in WORK/VOICEDEF payloads so STAGE (varint id) and the
+ *        sequenced wrapper (u16 seq) can still carry them.
+ */
+constexpr qsizetype kBinaryWrapBytes = 5;
+
+enum class BinaryType : quint8
+{
+    LedSet   = 0x01,
+    Work     = 0x02,
+    VoiceDef = 0x03,
+    Stage    = 0x04,
+};
+
+/**
+ * @brief Set on `type` when the payload starts with a u16 LE sequence number (see protocol.h).
+ */
+constexpr quint8 kBinarySeqFlag = 0x80;
+
+enum class BinaryAction : quint8
+{
+    Led      = 1,
+    Delay    = 2,
+    Voice    = 3,
+    Beep     = 4,
+    VoiceRef = 5,
+};
+
+quint16 crc16Ccitt(QByteArrayView data);
+quint32 crc32(QByteArrayView data); ///< IEEE 802.3 (zlib), "123456789" -> 0xCBF43926
+
+/**
+ * @brief Start a binary frame; returns the header offset to pass to endBinaryFrame().
+ */
+qsizetype beginBinaryFrame(FrameWriter& w, BinaryType type);
+
+/**
+ * @brief Back-patch the length and append the CRC.
+ * @return false if the payload exceeds maxPayload; the frame is then removed from `w`
+ *         (everything from headerPos on), so the caller can fall back to a text frame.
+ */
+bool endBinaryFrame(FrameWriter& w, qsizetype headerPos, qsizetype maxPayload = kMaxBinaryPayloadBytes);
+
+struct BinaryFrame
+{
+    quint8 type = 0;
+    QByteArrayView payload;   ///< points into the decoded buffer
+};
+
+enum class BinaryDecode
+{
+    Ok,         ///< `out` valid, `consumed` bytes used
+    NeedMore,   ///< incomplete frame
+    BadCrc,     ///< CRC mismatch; skip `consumed` bytes (the sync byte)
+};
+
+/**
+ * @brief Decode one frame from `buf`, which must start with kBinarySync.
+ */
+BinaryDecode decodeBinaryFrame(QByteArrayView buf, BinaryFrame& out, qsizetype& consumed);
+
+/**
+ * @brief Sequential reader over a binary payload; any overrun sets ok() to false.
+ */
+class BinaryReader
+{
+public:
+    explicit BinaryReader(QByteArrayView data) : m_data(data) {}
+
+    quint64 varUInt();
+    quint8 u8();
+    QByteArrayView bytes(qsizetype n);
+    QByteArrayView rest() const { return m_data.sliced(qMin(m_pos, m_data.size())); }
+
+    bool ok() const { return m_ok; }
+    bool atEnd() const { return m_pos >= m_data.size(); }
+
+private:
+    QByteArrayView m_data;
+    qsizetype m_pos = 0;
+    bool m_ok = true;
+};
+} // namespace Protocol
@@ -0,0 +1,425 @@
+#include "binaryrunlog.h"
+
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace RunLog
+{
+namespace
+{
+constexpr qint64 kInitialIndexBytes = 256 * 1024;    ///< ~6500 条记录
+constexpr qint64 kInitialPayloadBytes = 1024 * 1024;
+constexpr qint64 kMaxGrowBytes = 64 * 1024 * 1024;   ///< 单次扩大上限，避免周级 Run 时一次翻倍几个 GB
+constexpr int kMaxIndexedSegments = 1 << 20;         ///< 更大的段号不进段索引（导出时顺序扫描）
+
+QString segmentIndexPath(const QString& basePath)
+{
+    return basePath + QStringLiteral(".rlogs");
+}
+} // namespace
+
+QLatin1String directionName(Direction d)
+{
+    return d == Direction::Rx ? QLatin1String("RX") : QLatin1String("TX");
+}
+
+QLatin1String typeName(Type t)
+{
+    switch (t)
+    {
+    case Type::Config:  return QLatin1String("CONFIG");
+    case Type::Work:    return QLatin1String("WORK");
+    case Type::Test:    return QLatin1String("TEST");
+    case Type::Error:   return QLatin1String("ERROR");
+    case Type::Unknown: break;
+    }
+    return QLatin1String("UNKNOWN");
+}
+
+QString formatLine(qint64 deviceMs, Direction d, Type t, int segment, QStringView raw)
+{
+    // One allocation instead of five arg() passes; this runs for every TX and RX line.
+    QString line;
+    line.reserve(raw.size() + 48);
+    line += QLatin1Char('[');
+    line += QString::number(deviceMs);
+    line += QLatin1String("] [");
+    line += directionName(d);
+    line += QLatin1String("] [");
+    line += typeName(t);
+    line += QLatin1String("] [");
+    line += QString::number(segment);
+    line += QLatin1String("] [");
+    line += raw;
+    line += QLatin1Char(']');
+    return line;
+}
+
+// ---------------------------------------------------------------------------
+// BinaryWriter
+
+bool BinaryWriter::MappedFile::open(const QString& path, qint64 initialBytes, bool keep)
+{
+    file.setFileName(path);
+    QIODevice::OpenMode mode = QIODevice::ReadWrite;
+    if (!keep)
+        mode |= QIODevice::Truncate;
+    if (!file.open(mode))
+        return false;
+    const qint64 bytes = keep ? qMax(file.size(), initialBytes) : initialBytes;
+    if (!file.resize(bytes))
+        return false;
+    base = file.map(0, bytes);
+    if (!base)
+        return false;
+    capacity = bytes;
+    used = 0;
+    return true;
+}
+
+bool BinaryWriter::MappedFile::reserve(qint64 extra)
+{
+    if (used + extra <= capacity)
+        return true;
+
+    qint64 newCapacity = capacity + qMin(capacity, kMaxGrowBytes);
+    while (newCapacity < used + extra)
+        newCapacity += kMaxGrowBytes;
+
+    file.unmap(base);
+    base = nullptr;
+    if (!file.resize(newCapacity))
+        return false;
+    base = file.map(0, newCapacity);
+    if (!base)
+        return false;
+    capacity = newCapacity;
+    return true;
+}
+
+void BinaryWriter::MappedFile::sync()
+{
+    if (!base)
+        return;
+#ifdef Q_OS_WIN
+    ::FlushViewOfFile(base, SIZE_T(used));
+    ::FlushFileBuffers(reinterpret_cast<HANDLE>(::_get_osfhandle(file.handle())));
+#else
+    ::msync(base, size_t(used), MS_SYNC);
+    ::fsync(file.handle());
+#endif
+}
+
+void BinaryWriter::MappedFile::close()
+{
+    if (base)
+        file.unmap(base);
+    base = nullptr;
+    if (file.isOpen())
+    {
+        file.resize(used); // drop the zero-filled tail
+        file.close();
+    }
+    capacity = 0;
+    used = 0;
+}
+
+bool BinaryWriter::open(const QString& basePath, qint64 startHostNs, qint64 startUnixMs, QString& err)
+{
+    close();
+
+    const QString indexPath = basePath + QStringLiteral(".rlog");
+    const QString payloadPath = basePath + QStringLiteral(".rlogd");
+    if (!m_index.open(indexPath, kInitialIndexBytes))
+    {
+        err = QStringLiteral("%1: %2").arg(indexPath, m_index.file.errorString());
+        close();
+        return false;
+    }
+    if (!m_payload.open(payloadPath, kInitialPayloadBytes))
+    {
+        err = QStringLiteral("%1: %2").arg(payloadPath, m_payload.file.errorString());
+        close();
+        return false;
+    }
+
+    FileHeader* h = header();
+    std::memset(h, 0, sizeof(FileHeader));
+    h->magic = kMagic;
+    h->version = kVersion;
+    h->recordSize = quint16(sizeof(Record));
+    h->headerSize = quint32(sizeof(FileHeader));
+    h->startHostNs = startHostNs;
+    h->startUnixMs = startUnixMs;
+    m_index.used = qint64(sizeof(FileHeader));
+    m_records = 0;
+    m_hostShiftNs = 0;
+    m_basePath = basePath;
+    m_segmentSpans.clear();
+    QFile::remove(segmentIndexPath(basePath)); // stale from an earlier run with the same name
+    return true;
+}
+
+bool BinaryWriter::reopen(const QString& basePath, qint64 nowHostNs, qint64 nowUnixMs, QString& err)
+{
+    close();
+
+    const QString indexPath = basePath + QStringLiteral(".rlog");
+    const QString payloadPath = basePath + QStringLiteral(".rlogd");
+    if (!m_index.open(indexPath, kInitialIndexBytes, true))
+    {
+        err = QStringLiteral("%1: %2").arg(indexPath, m_index.file.errorString());
+        close();
+        return false;
+    }
+    if (!m_payload.open(payloadPath, kInitialPayloadBytes, true))
+    {
+        err = QStringLiteral("%1: %2").arg(payloadPath, m_payload.file.errorString());
+        close();
+        return false;
+    }
+
+    const FileHeader* h = header();
+    if (h->magic != kMagic || h->version != kVersion || h->recordSize != sizeof(Record)
+        || h->headerSize != sizeof(FileHeader))
+    {
+        err = QStringLiteral("%1: not a run log").arg(indexPath);
+        close();
+        return false;
+    }
+    // Same bounds as BinaryReader::open: the header is published after each record.
+    const quint64 fits = quint64(m_index.capacity - qint64(sizeof(FileHeader))) / sizeof(Record);
+    m_records = qMin(h->recordCount, fits);
+    m_index.used = qint64(sizeof(FileHeader) + m_records * sizeof(Record));
+    m_payload.used = qint64(qMin(h->payloadBytes, quint64(m_payload.capacity)));
+
+    // The .rlogs on disk may predate the crash: rebuild it from the records themselves.
+    m_basePath = basePath;
+    m_segmentSpans.clear();
+    const quint64 records = m_records;
+    const Record* recs = reinterpret_cast<const Record*>(m_index.base + sizeof(FileHeader));
+    for (m_records = 0; m_records < records; ++m_records)
+        noteSegment(recs[m_records].segment);
+
+    qint64 shift = h->startHostNs + (nowUnixMs - h->startUnixMs) * 1000000 - nowHostNs;
+    if (m_records > 0)
+    {
+        const Record* last = reinterpret_cast<const Record*>(m_index.base + m_index.used) - 1;
+        shift = qMax(shift, last->hostNs - nowHostNs); // wall clock stepped back: keep hostNs sorted
+    }
+    m_hostShiftNs = shift;
+    return true;
+}
+
+bool BinaryWriter::append(qint64 hostNs, qint64 deviceMs, Direction d, Type t, int segment, int action,
+                          QByteArrayView payload)
+{
+    if (!isOpen())
+        return false;
+    if (!m_index.reserve(qint64(sizeof(Record))) || !m_payload.reserve(payload.size()))
+    {
+        close();
+        return false;
+    }
+
+    Record r;
+    std::memset(&r, 0, sizeof(r));
+    r.hostNs = hostNs + m_hostShiftNs;
+    r.deviceMs = deviceMs;
+    r.payloadOffset = quint64(m_payload.used);
+    r.payloadLen = quint32(payload.size());
+    r.segment = qint32(segment);
+    r.action = qint16(qBound(-1, action, 0x7FFF));
+    r.direction = quint8(d);
+    r.type = quint8(t);
+
+    if (!payload.isEmpty())
+        std::memcpy(m_payload.base + m_payload.used, payload.data(), size_t(payload.size()));
+    std::memcpy(m_index.base + m_index.used, &r, sizeof(r));
+    m_payload.used += payload.size();
+    m_index.used += qint64(sizeof(r));
+    noteSegment(segment);
+    ++m_records;
+
+    // Publish only after the record and its payload are in place.
+    FileHeader* h = header();
+    h->payloadBytes = quint64(m_payload.used);
+    h->recordCount = m_records;
+    return true;
+}
+
+void BinaryWriter::noteSegment(int segment)
+{
+    if (segment < 0 || segment >= kMaxIndexedSegments)
+        return;
+    if (segment >= m_segmentSpans.size())
+        m_segmentSpans.resize(segment + 1, SegmentSpan{0, 0});
+    SegmentSpan& s = m_segmentSpans[segment];
+    if (s.end == 0)
+        s.first = m_records;
+    s.end = m_records + 1;
+}
+
+void BinaryWriter::writeSegmentIndex()
+{
+    QFile f(segmentIndexPath(m_basePath));
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return; // optional: runlog_dump falls back to a sequential scan
+    SegmentIndexHeader h;
+    std::memset(&h, 0, sizeof(h));
+    h.magic = kSegmentIndexMagic;
+    h.version = kSegmentIndexVersion;
+    h.recordCount = m_records;
+    h.segmentCount = quint64(m_segmentSpans.size());
+    f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    f.write(reinterpret_cast<const char*>(m_segmentSpans.constData()),
+            qint64(m_segmentSpans.size()) * qint64(sizeof(SegmentSpan)));
+}
+
+void BinaryWriter::sync()
+{
+    m_payload.sync();
+    m_index.sync();
+    if (isOpen())
+        writeSegmentIndex();
+}
+
+void BinaryWriter::close()
+{
+    if (isOpen())
+        sync();
+    m_payload.close();
+    m_index.close();
+}
+
+// ---------------------------------------------------------------------------
+// BinaryReader
+
+bool BinaryReader::open(const QString& indexPath, QString& err)
+{
+    close();
+
+    m_indexFile.setFileName(indexPath);
+    if (!m_indexFile.open(QIODevice::ReadOnly))
+    {
+        err = QStringLiteral("%1: %2").arg(indexPath, m_indexFile.errorString());
+        return false;
+    }
+    const qint64 indexSize = m_indexFile.size();
+    if (indexSize < qint64(sizeof(FileHeader)) || !(m_indexBase = m_indexFile.map(0, indexSize)))
+    {
+        err = QStringLiteral("%1: not a run log").arg(indexPath);
+        close();
+        return false;
+    }
+
+    const FileHeader& h = header();
+    if (h.magic != kMagic || h.version != kVersion || h.recordSize != sizeof(Record)
+        || h.headerSize != sizeof(FileHeader))
+    {
+        err = QStringLiteral("%1: unsupported run log (magic %2, version %3)")
+                  .arg(indexPath)
+                  .arg(h.magic, 8, 16, QLatin1Char('0'))
+                  .arg(h.version);
+        close();
+        return false;
+    }
+    // A crash after a grow but before close leaves a zero tail: trust the header, bounded by the file.
+    m_records = qMin(h.recordCount, quint64(indexSize - qint64(sizeof(FileHeader))) / sizeof(Record));
+
+    QString payloadPath = indexPath;
+    if (payloadPath.endsWith(QStringLiteral(".rlog")))
+        payloadPath += QLatin1Char('d');
+    else
+        payloadPath += QStringLiteral(".rlogd");
+    m_payloadFile.setFileName(payloadPath);
+    if (m_payloadFile.open(QIODevice::ReadOnly))
+    {
+        m_payloadSize = m_payloadFile.size();
+        if (m_payloadSize > 0)
+            m_payloadBase = m_payloadFile.map(0, m_payloadSize);
+        if (!m_payloadBase)
+            m_payloadSize = 0;
+    }
+
+    // Segment index: only if it was written for exactly these records.
+    QFile segFile(payloadPath.chopped(1) + QLatin1Char('s'));
+    SegmentIndexHeader sh;
+    if (segFile.open(QIODevice::ReadOnly)
+        && segFile.read(reinterpret_cast<char*>(&sh), sizeof(sh)) == qint64(sizeof(sh))
+        && sh.magic == kSegmentIndexMagic && sh.version == kSegmentIndexVersion
+        && sh.recordCount == m_records && sh.segmentCount <= quint64(kMaxIndexedSegments))
+    {
+        m_segmentSpans.resize(qsizetype(sh.segmentCount));
+        const qint64 bytes = qint64(sh.segmentCount) * qint64(sizeof(SegmentSpan));
+        m_segmentIndexValid = segFile.read(reinterpret_cast<char*>(m_segmentSpans.data()), bytes) == bytes;
+        if (!m_segmentIndexValid)
+            m_segmentSpans.clear();
+    }
+    return true;
+}
+
+void BinaryReader::close()
+{
+    if (m_indexBase)
+        m_indexFile.unmap(const_cast<uchar*>(m_indexBase));
+    if (m_payloadBase)
+        m_payloadFile.unmap(const_cast<uchar*>(m_payloadBase));
+    m_indexBase = nullptr;
+    m_payloadBase = nullptr;
+    m_payloadSize = 0;
+    m_records = 0;
+    m_segmentSpans.clear();
+    m_segmentIndexValid = false;
+    m_indexFile.close();
+    m_payloadFile.close();
+}
+
+const Record& BinaryReader::at(quint64 i) const
+{
+    return reinterpret_cast<const Record*>(m_indexBase + sizeof(FileHeader))[i];
+}
+
+QByteArrayView BinaryReader::payload(const Record& r) const
+{
+    if (r.payloadOffset > quint64(m_payloadSize) || r.payloadLen > quint64(m_payloadSize) - r.payloadOffset)
+        return {};
+    return QByteArrayView(reinterpret_cast<const char*>(m_payloadBase + r.payloadOffset), qsizetype(r.payloadLen));
+}
+
+bool BinaryReader::segmentRange(int segment, quint64& first, quint64& end) const
+{
+    if (!m_segmentIndexValid)
+        return false;
+    first = end = 0;
+    if (segment >= 0 && segment < m_segmentSpans.size())
+    {
+        const SegmentSpan& s = m_segmentSpans[segment];
+        first = qMin(s.first, m_records);
+        end = qMin(s.end, m_records);
+    }
+    return true;
+}
+
+quint64 BinaryReader::lowerBoundHostNs(qint64 hostNs) const
+{
+    quint64 lo = 0;
+    quint64 hi = m_records;
+    while (lo < hi)
+    {
+        const quint64 mid = lo + (hi - lo) / 2;
+        if (at(mid).hostNs < hostNs)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+} // namespace RunLog
@@ -0,0 +1,223 @@
+#pragma once
+/**
+ * @file binaryrunlog.h
+ * @brief 定长记录的二进制 Run 日志（logs/<run>.rlog + logs/<run>.rlogd），写入与读取都走内存映射
+ *
+ * 文件：
+ * - `.rlog`  ：FileHeader（64 B）后紧跟 Record（40 B）数组，按追加顺序即 hostNs 升序
+ * - `.rlogd` ：payload 区，原始行的 UTF-8 字节首尾相接（无分隔符），Record 用偏移 + 长度引用
+ * - `.rlogs` ：段索引，每段第一条与最后一条记录的下标（SegmentIndexHeader + SegmentSpan 数组），
+ *              sync()/close() 时整体重写；记录数与 .rlog 不符（崩溃前未 sync）时读取端不使用它
+ *
+ * 写入只做 memcpy；映射区用完时扩大文件（翻倍，单次最多 64 MiB）并重新映射。FileHeader 的 recordCount/payloadBytes
+ * 在记录写完之后才更新，进程中途崩溃时最后半条记录不计入，已计入的记录都完整。
+ * close() 把两个文件截到实际长度；sync() 额外 msync + fsync。
+ *
+ * 所有整数按主机字节序存放（受支持的平台均为小端）。
+ * 文本导出（formatLine）与 `logs/<run>.log` 的行格式完全一致，见 tools/runlogdump。
+ */
+
+#include <QByteArrayView>
+#include <QFile>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+#error "binary run log records are stored little-endian"
+#endif
+
+namespace RunLog
+{
+enum class Direction : quint8
+{
+    Tx = 0,
+    Rx = 1,
+};
+
+enum class Type : quint8
+{
+    Config  = 0,
+    Work    = 1,
+    Test    = 2,
+    Error   = 3,
+    Unknown = 4,
+};
+
+QLatin1String directionName(Direction d); ///< "TX" / "RX"
+QLatin1String typeName(Type t);           ///< "CONFIG" / "WORK" / "TEST" / "ERROR" / "UNKNOWN"
+
+/**
+ * @brief 文本日志行：`[device_ms] [TX/RX] [type] [segmentIndex] [rawLine]`
+ */
+QString formatLine(qint64 deviceMs, Direction d, Type t, int segment, QStringView raw);
+
+constexpr quint32 kMagic = 0x474C5246; ///< "FRLG"
+constexpr quint16 kVersion = 1;
+
+struct FileHeader
+{
+    quint32 magic;
+    quint16 version;
+    quint16 recordSize;
+    quint32 headerSize;
+    quint32 reserved0;
+    quint64 recordCount;   ///< 已完整写入的记录数
+    quint64 payloadBytes;  ///< .rlogd 中已使用的字节数
+    qint64 startHostNs;    ///< Run 开始时的 HostClock::nowNs()
+    qint64 startUnixMs;    ///< Run 开始时的墙钟（UTC ms）
+    quint8 reserved[16];
+};
+static_assert(sizeof(FileHeader) == 64, "FileHeader layout");
+
+struct Record
+{
+    qint64 hostNs;         ///< HostClock::nowNs()
+    qint64 deviceMs;       ///< 映射后的设备时间；首个 STEPRUN 前为 -1
+    quint64 payloadOffset; ///< 在 .rlogd 中的偏移
+    quint32 payloadLen;
+    qint32 segment;        ///< 段下标；-1 表示与段无关
+    qint16 action;         ///< 段内动作（STEPRUN 步号，从 1 开始）；-1 表示无
+    quint8 direction;      ///< Direction
+    quint8 type;           ///< Type
+    quint8 reserved[4];
+};
+static_assert(sizeof(Record) == 40, "Record layout");
+
+constexpr quint32 kSegmentIndexMagic = 0x534C5246; ///< "FRLS"
+constexpr quint16 kSegmentIndexVersion = 1;
+
+struct SegmentIndexHeader
+{
+    quint32 magic;
+    quint16 version;
+    quint16 reserved0;
+    quint64 recordCount;   ///< 写索引时 .rlog 的记录数
+    quint64 segmentCount;  ///< 其后 SegmentSpan 的个数（下标即段号）
+};
+static_assert(sizeof(SegmentIndexHeader) == 24, "SegmentIndexHeader layout");
+
+/**
+ * @brief 段的记录范围 [first, end)；重做的记录也在其中，中间夹着其他段的记录。end == 0 表示该段无记录
+ */
+struct SegmentSpan
+{
+    quint64 first;
+    quint64 end;
+};
+static_assert(sizeof(SegmentSpan) == 16, "SegmentSpan layout");
+
+/**
+ * @brief 追加写入端（单线程使用）
+ */
+class BinaryWriter
+{
+public:
+    BinaryWriter() = default;
+    ~BinaryWriter() { close(); }
+
+    BinaryWriter(const BinaryWriter&) = delete;
+    BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+    /**
+     * @param basePath 不带扩展名（例如 logs/20240101_120000_000），创建 basePath.rlog / basePath.rlogd
+     */
+    bool open(const QString& basePath, qint64 startHostNs, qint64 startUnixMs, QString& err);
+
+    /**
+     * @brief 续写已有的 basePath.rlog / .rlogd（从断点恢复同一次 Run），从文件头记录的条数之后接着写
+     *
+     * 新进程的 HostClock 纪元与写文件时不同：按墙钟把之后记录的 hostNs 接到文件原有的时间轴上
+     * （不早于最后一条记录），runlog_dump 的 --from-ms/--to-ms 仍然有效。
+     */
+    bool reopen(const QString& basePath, qint64 nowHostNs, qint64 nowUnixMs, QString& err);
+
+    /**
+     * @return false 表示扩大映射失败（之后不再写入，直到重新 open）
+     */
+    bool append(qint64 hostNs, qint64 deviceMs, Direction d, Type t, int segment, int action,
+                QByteArrayView payload);
+
+    void sync();
+    void close();
+
+    bool isOpen() const { return m_index.base != nullptr; }
+    quint64 recordCount() const { return m_records; }
+
+private:
+    void noteSegment(int segment);
+    void writeSegmentIndex();
+
+    struct MappedFile
+    {
+        QFile file;
+        uchar* base = nullptr;
+        qint64 capacity = 0;
+        qint64 used = 0;
+
+        bool open(const QString& path, qint64 initialBytes, bool keep = false); ///< keep: 不截断，映射现有内容
+        bool reserve(qint64 extra);
+        void sync();
+        void close();
+    };
+
+    FileHeader* header() { return reinterpret_cast<FileHeader*>(m_index.base); }
+
+    MappedFile m_index;
+    MappedFile m_payload;
+    QString m_basePath;
+    QVector<SegmentSpan> m_segmentSpans;
+    quint64 m_records = 0;
+    qint64 m_hostShiftNs = 0; ///< reopen 后加到 hostNs 上
+};
+
+/**
+ * @brief 只读端：映射整个文件，随机访问记录
+ */
+class BinaryReader
+{
+public:
+    BinaryReader() = default;
+    ~BinaryReader() { close(); }
+
+    BinaryReader(const BinaryReader&) = delete;
+    BinaryReader& operator=(const BinaryReader&) = delete;
+
+    /**
+     * @param indexPath `.rlog` 文件；payload 文件为同名 `.rlogd`
+     */
+    bool open(const QString& indexPath, QString& err);
+    void close();
+
+    const FileHeader& header() const { return *reinterpret_cast<const FileHeader*>(m_indexBase); }
+    quint64 size() const { return m_records; }
+    const Record& at(quint64 i) const;
+
+    /**
+     * @brief 记录的原始行；越界（文件被截断）时返回空
+     */
+    QByteArrayView payload(const Record& r) const;
+
+    /**
+     * @brief 第一条 hostNs >= hostNs 的记录下标（二分查找；不存在时返回 size()）
+     */
+    quint64 lowerBoundHostNs(qint64 hostNs) const;
+
+    /**
+     * @brief 从 .rlogs 段索引取段的记录范围 [first, end)
+     * @return false 表示没有可用的段索引（文件缺失或已过期），调用方只能顺序扫描
+     */
+    bool hasSegmentIndex() const { return m_segmentIndexValid; }
+    bool segmentRange(int segment, quint64& first, quint64& end) const;
+
+private:
+    QFile m_indexFile;
+    QFile m_payloadFile;
+    const uchar* m_indexBase = nullptr;
+    const uchar* m_payloadBase = nullptr;
+    qint64 m_payloadSize = 0;
+    quint64 m_records = 0;
+    QVector<SegmentSpan> m_segmentSpans;
+    bool m_segmentIndexValid = false;
+};
+} // namespace RunLog
@@ -0,0 +1,133 @@
+#include "clocksync.h"
+
+#include <cmath>
+
+ClockSync::ClockSync(int window)
+    : m_ring(std::size_t(qMax(kMinFitSamples, window)))
+{
+}
+
+void ClockSync::reset()
+{
+    m_head = 0;
+    m_count = 0;
+    m_originNs = 0;
+    m_offset = 0.0;
+    m_skew = 0.0;
+    m_rmsMs = 0.0;
+    m_consecutiveRejects = 0;
+    m_accepted = 0;
+    m_rejected = 0;
+    m_resets = 0;
+}
+
+void ClockSync::restart(qint64 hostNs, qint64 deviceMs)
+{
+    m_head = 0;
+    m_count = 0;
+    m_originNs = hostNs;
+    m_skew = 0.0;
+    m_rmsMs = 0.0;
+    m_consecutiveRejects = 0;
+    push(0.0, double(deviceMs));
+    refit();
+}
+
+bool ClockSync::addSample(qint64 hostNs, qint64 deviceMs)
+{
+    if (m_count == 0)
+    {
+        restart(hostNs, deviceMs);
+        ++m_accepted;
+        return true;
+    }
+
+    const double x = double(hostNs - m_originNs) / 1e6;
+    const double y = double(deviceMs);
+    if (m_count >= kMinFitSamples)
+    {
+        const double limit = qMax(kMinRejectMs, kRejectSigma * m_rmsMs);
+        if (std::abs(y - predict(x)) > limit)
+        {
+            ++m_rejected;
+            if (++m_consecutiveRejects < kMaxConsecutiveRejects)
+                return false;
+            // The device clock jumped: start over from here.
+            ++m_resets;
+            restart(hostNs, deviceMs);
+            ++m_accepted;
+            return true;
+        }
+    }
+
+    m_consecutiveRejects = 0;
+    push(x, y);
+    refit();
+    ++m_accepted;
+    return true;
+}
+
+void ClockSync::push(double hostMs, double deviceMs)
+{
+    m_ring[std::size_t(m_head)] = Sample{hostMs, deviceMs};
+    m_head = (m_head + 1) % int(m_ring.size());
+    if (m_count < int(m_ring.size()))
+        ++m_count;
+}
+
+void ClockSync::refit()
+{
+    const int cap = int(m_ring.size());
+    const int first = (m_head - m_count + cap) % cap;
+
+    double sx = 0.0, sy = 0.0;
+    double minX = 0.0, maxX = 0.0;
+    for (int i = 0; i < m_count; ++i)
+    {
+        const Sample& s = m_ring[std::size_t((first + i) % cap)];
+        sx += s.hostMs;
+        sy += s.deviceMs - s.hostMs; // fit the residual device-host, skew is tiny
+        if (i == 0 || s.hostMs < minX)
+            minX = s.hostMs;
+        if (i == 0 || s.hostMs > maxX)
+            maxX = s.hostMs;
+    }
+    const double mx = sx / m_count;
+    const double md = sy / m_count;
+
+    double skew = 0.0;
+    if (m_count >= kMinFitSamples && maxX - minX >= kMinSpanMs)
+    {
+        double sxx = 0.0, sxd = 0.0;
+        for (int i = 0; i < m_count; ++i)
+        {
+            const Sample& s = m_ring[std::size_t((first + i) % cap)];
+            const double dx = s.hostMs - mx;
+            sxx += dx * dx;
+            sxd += dx * ((s.deviceMs - s.hostMs) - md);
+        }
+        if (sxx > 0.0)
+            skew = sxd / sxx;
+        if (std::abs(skew) * 1e6 > kMaxSkewPpm)
+            skew = 0.0;
+    }
+
+    m_skew = skew;
+    m_offset = md - skew * mx;
+
+    double ss = 0.0;
+    for (int i = 0; i < m_count; ++i)
+    {
+        const Sample& s = m_ring[std::size_t((first + i) % cap)];
+        const double r = s.deviceMs - predict(s.hostMs);
+        ss += r * r;
+    }
+    m_rmsMs = std::sqrt(ss / m_count);
+}
+
+qint64 ClockSync::deviceMsAt(qint64 hostNs) const
+{
+    if (m_count == 0)
+        return -1;
+    return qint64(std::llround(predict(double(hostNs - m_originNs) / 1e6)));
+}
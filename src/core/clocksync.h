@@ -0,0 +1,85 @@
+#pragma once
+/**
+ * @file clocksync.h
+ * @brief Host -> device clock model: offset + skew fitted over the most recent STEPRUN samples.
+ *
+ * Each sample pairs a host time (HostClock ns) with the device time (ms) of the same instant.
+ * deviceMs = offset + (1 + skew) * hostMs is fitted by least squares over a sliding window, so
+ * crystal drift stays compensated over multi-hour runs and a single late report cannot shift
+ * the timeline. A sample whose residual exceeds max(kMinRejectMs, kRejectSigma * RMS) is
+ * rejected; after kMaxConsecutiveRejects rejections in a row the device clock is assumed to
+ * have jumped (reset/reboot) and the model restarts from the current sample.
+ *
+ * Until the window spans kMinSpanMs the skew is taken as 0 (offset only).
+ */
+
+#include <QtGlobal>
+
+#include <vector>
+
+class ClockSync
+{
+public:
+    static constexpr int kDefaultWindow = 256;
+    static constexpr int kMinFitSamples = 4;        ///< below this no sample is rejected
+    static constexpr double kMinRejectMs = 20.0;
+    static constexpr double kRejectSigma = 4.0;
+    static constexpr int kMaxConsecutiveRejects = 8;
+    static constexpr double kMinSpanMs = 2000.0;
+    static constexpr double kMaxSkewPpm = 2000.0;   ///< fits beyond this fall back to offset only
+
+    explicit ClockSync(int window = kDefaultWindow);
+
+    void reset();
+
+    /**
+     * @return false if the sample was rejected as an outlier
+     */
+    bool addSample(qint64 hostNs, qint64 deviceMs);
+
+    bool isValid() const { return m_count > 0; }
+
+    /**
+     * @brief Device time at hostNs; -1 before the first sample.
+     */
+    qint64 deviceMsAt(qint64 hostNs) const;
+
+    double skewPpm() const { return m_skew * 1e6; }
+
+    /**
+     * @brief Current error estimate: RMS residual of the samples in the window (ms).
+     */
+    double errorMs() const { return m_rmsMs; }
+
+    int sampleCount() const { return m_count; }
+    quint64 acceptedTotal() const { return m_accepted; }
+    quint64 rejectedTotal() const { return m_rejected; }
+    quint64 resets() const { return m_resets; }
+
+private:
+    struct Sample
+    {
+        double hostMs = 0.0;   ///< relative to m_originNs
+        double deviceMs = 0.0;
+    };
+
+    double predict(double hostMs) const { return m_offset + (1.0 + m_skew) * hostMs; }
+    void restart(qint64 hostNs, qint64 deviceMs);
+    void push(double hostMs, double deviceMs);
+    void refit();
+
+private:
+    std::vector<Sample> m_ring;
+    int m_head = 0;     ///< next slot to write
+    int m_count = 0;
+
+    qint64 m_originNs = 0;
+    double m_offset = 0.0;  ///< device ms at m_originNs
+    double m_skew = 0.0;    ///< (device rate / host rate) - 1
+    double m_rmsMs = 0.0;
+    int m_consecutiveRejects = 0;
+
+    quint64 m_accepted = 0;
+    quint64 m_rejected = 0;
+    quint64 m_resets = 0;
+};
@@ -0,0 +1,193 @@
+#include "fixturestation.h"
+
+#include "runcheckpoint.h"
+#include "workflowengine.h"
+#include "../services/serialservice.h"
+
+FixtureStation::FixtureStation(WorkflowEngine* primary, QObject* parent)
+    : QObject(parent)
+    , m_primary(primary)
+{
+}
+
+FixtureStation::~FixtureStation()
+{
+    closeFixtures();
+}
+
+FixtureStation::Mode FixtureStation::modeFromString(const QString& s)
+{
+    return s.trimmed().compare(QLatin1String("shard"), Qt::CaseInsensitive) == 0 ? Mode::Shard : Mode::Broadcast;
+}
+
+WorkflowEngine* FixtureStation::engine(int fixture) const
+{
+    if (fixture == 0)
+        return m_primary;
+    if (fixture < 1 || fixture > m_extra.size())
+        return nullptr;
+    return m_extra[fixture - 1].engine;
+}
+
+void FixtureStation::openFixtures(const QStringList& ports, const SettingsData& settings)
+{
+    closeFixtures();
+
+    for (const QString& rawPort : ports)
+    {
+        const QString port = rawPort.trimmed();
+        if (port.isEmpty())
+            continue;
+
+        const int index = fixtureCount();
+        Fixture f;
+        f.port = port;
+        f.serial = new SerialService(this);
+        f.engine = new WorkflowEngine(this);
+        f.engine->setSerialService(f.serial);
+        f.engine->setRunLogTag(QStringLiteral("dev%1").arg(index));
+        f.engine->setCheckpointPath(RunCheckpoint::defaultPath(QStringLiteral("dev%1").arg(index)));
+        f.engine->applySerialSettings(settings.serial);
+
+        // Each fixture gets its own I/O thread so one slow link cannot hold up the others.
+        f.serial->setThreadedIo(true);
+        f.serial->setTxLimits(settings.serial.txInFlightBytes, settings.serial.txCoalesceBytes);
+
+        connect(f.serial, &SerialService::rxLine, f.engine, &WorkflowEngine::onSerialLine);
+        connect(f.serial, &SerialService::opened, this, [this, index](bool ok, const QString& err) {
+            emit fixtureOpened(index, ok, err);
+        });
+        connect(f.engine, &WorkflowEngine::logLine, this, [this, index](const QString& line) {
+            emit fixtureLog(index, line);
+        });
+        connect(f.engine, &WorkflowEngine::segmentStarted, this,
+                [this, index](const QString& name, int startRow, int endRow) {
+                    emit fixtureSegmentStarted(index, name, startRow, endRow);
+                });
+        connect(f.engine, &WorkflowEngine::progressUpdated, this, [this, index](int step, qint64 deviceMs) {
+            emit fixtureProgress(index, step, deviceMs);
+        });
+        connect(f.engine, &WorkflowEngine::stepTimingSlow, this,
+                [this, index](const QString& flow, int step, qint64 predictedMs, qint64 actualMs) {
+                    emit fixtureStepSlow(index, flow, step, predictedMs, actualMs);
+                });
+
+        m_extra.push_back(f);
+        f.serial->openPort(port, settings.serial.baud, settings.serial.dataBits, settings.serial.parity,
+                           settings.serial.stopBits);
+    }
+}
+
+void FixtureStation::closeFixtures()
+{
+    for (Fixture& f : m_extra)
+    {
+        f.engine->finishRun();
+        f.serial->closePort();
+        delete f.engine;
+        delete f.serial; // joins its I/O thread
+    }
+    m_extra.clear();
+}
+
+void FixtureStation::applyRunSettings(const SettingsData& settings)
+{
+    for (Fixture& f : m_extra)
+        f.engine->applyRunSettings(settings);
+}
+
+QVector<ActionItem> FixtureStation::shardFor(const QVector<ActionItem>& actions, int fixture) const
+{
+    if (m_mode == Mode::Broadcast)
+        return actions;
+
+    // Segments are runs of consecutive actions with the same flow (WorkflowEngine::rebuildSegments).
+    const int n = fixtureCount();
+    QVector<ActionItem> out;
+    int segment = -1;
+    for (int i = 0; i < actions.size(); ++i)
+    {
+        if (i == 0 || actions[i].flowName != actions[i - 1].flowName)
+            ++segment;
+        if (segment % n == fixture)
+            out.push_back(actions[i]);
+    }
+    return out;
+}
+
+void FixtureStation::loadPlan(const QVector<ActionItem>& actions, quint32 seed)
+{
+    m_primary->loadPlan(shardFor(actions, 0), seed);
+    const quint32 shared = m_primary->planSeed();
+    for (int i = 0; i < m_extra.size(); ++i)
+        m_extra[i].engine->loadPlan(shardFor(actions, i + 1), shared);
+}
+
+void FixtureStation::beginRun()
+{
+    for (Fixture& f : m_extra)
+        f.engine->beginRun();
+}
+
+void FixtureStation::sendConfigs()
+{
+    for (Fixture& f : m_extra)
+        f.engine->sendConfigs();
+}
+
+void FixtureStation::runNextSegment()
+{
+    for (Fixture& f : m_extra)
+    {
+        if (f.engine->isAutoplay() && f.engine->isAwaitingSegment())
+            continue; // chains itself on STEPRUN
+        f.engine->noteTrigger();
+        f.engine->runNextSegment();
+    }
+}
+
+void FixtureStation::finishRun()
+{
+    for (Fixture& f : m_extra)
+        f.engine->finishRun();
+}
+
+void FixtureStation::resetRun()
+{
+    for (Fixture& f : m_extra)
+        f.engine->resetRun();
+}
+
+bool FixtureStation::resumeRun(QString& errMsg)
+{
+    QStringList errors;
+    for (int i = 0; i < m_extra.size(); ++i)
+    {
+        const int index = i + 1;
+        RunCheckpoint::Checkpoint cp;
+        QString err;
+        if (!RunCheckpoint::load(RunCheckpoint::defaultPath(QStringLiteral("dev%1").arg(index)), cp, err)
+            || !m_extra[i].engine->resumeRun(cp, err))
+            errors << QStringLiteral("治具 #%1：%2").arg(index).arg(err);
+    }
+    errMsg = errors.join(QStringLiteral("；"));
+    return errors.isEmpty();
+}
+
+void FixtureStation::discardCheckpoints()
+{
+    for (Fixture& f : m_extra)
+        f.engine->discardCheckpoint();
+}
+
+void FixtureStation::markCurrentOrPreviousSegmentForRerun()
+{
+    for (Fixture& f : m_extra)
+        f.engine->markCurrentOrPreviousSegmentForRerun();
+}
+
+void FixtureStation::setAutoplay(bool on)
+{
+    for (Fixture& f : m_extra)
+        f.engine->setAutoplay(on);
+}
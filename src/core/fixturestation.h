@@ -0,0 +1,99 @@
+#pragma once
+/**
+ * @file fixturestation.h
+ * @brief 一台电脑带多个治具：同一计划驱动 N 路串口，每路独立的 SerialService + WorkflowEngine
+ *
+ * - 治具 0 是 MainWindow 原有的 m_engine/m_serial（界面、热键照旧）；1..N-1 由本类按
+ *   station/extraPorts 创建，beginRun/sendConfigs/runNextSegment/finishRun/resetRun/setAutoplay/
+ *   markCurrentOrPreviousSegmentForRerun 由 MainWindow 在操作治具 0 的同时转给本类，镜像到其余治具
+ * - 每路的串口 I/O 在各自线程上（SerialService 线程模式），下发互不排队；
+ *   设备时钟模型、进度、Run 日志（logs/<ts>_dev<n>.*）也各自独立
+ * - Broadcast：每路执行全部段（RAND 使用同一种子，颜色一致）
+ *   Shard：段按顺序轮流分给各路（第 j 段 -> 治具 j % N），各路只执行自己的段
+ */
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+#include "models.h"
+#include "../config/appsettings.h"
+
+class SerialService;
+class WorkflowEngine;
+
+class FixtureStation : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Mode
+    {
+        Broadcast,
+        Shard,
+    };
+
+    explicit FixtureStation(WorkflowEngine* primary, QObject* parent = nullptr);
+    ~FixtureStation() override;
+
+    void setMode(Mode mode) { m_mode = mode; }
+    Mode mode() const { return m_mode; }
+    static Mode modeFromString(const QString& s); ///< "shard" / 其他 = Broadcast
+
+    /**
+     * @brief 为每个端口创建一路并异步打开；已有的治具先关闭
+     * @param ports 治具 1..N-1 的传输描述（与主端口同一格式）
+     */
+    void openFixtures(const QStringList& ports, const SettingsData& settings);
+    void closeFixtures();
+
+    int fixtureCount() const { return 1 + int(m_extra.size()); } ///< 含治具 0
+    WorkflowEngine* engine(int fixture) const;
+
+    /**
+     * @brief 把运行参数（设备属性、颜色、语音、Run 配置）同步到治具 1..N-1
+     */
+    void applyRunSettings(const SettingsData& settings);
+
+    /**
+     * @brief 按模式给所有治具（含治具 0）载入计划；各路共用治具 0 的种子
+     */
+    void loadPlan(const QVector<ActionItem>& actions, quint32 seed = 0);
+
+    // 镜像到治具 1..N-1
+    void beginRun();
+    void sendConfigs();
+    void runNextSegment();
+    void finishRun();
+    void resetRun();
+    void setAutoplay(bool on);
+    void markCurrentOrPreviousSegmentForRerun(); ///< 各治具标记自己当前（或上一）段
+
+    /**
+     * @brief 治具 1..N-1 各自从 logs/checkpoint_dev<n>.ckpt 恢复（治具 0 由 MainWindow 恢复）
+     * @return 有治具恢复失败时 false，errMsg 列出失败的治具；成功的治具照常继续
+     */
+    bool resumeRun(QString& errMsg);
+    void discardCheckpoints();
+
+signals:
+    void fixtureOpened(int fixture, bool ok, const QString& err);
+    void fixtureLog(int fixture, const QString& line);
+    void fixtureSegmentStarted(int fixture, const QString& segmentName, int startRow, int endRow);
+    void fixtureProgress(int fixture, int currentStep, qint64 deviceMs);
+    void fixtureStepSlow(int fixture, const QString& flowName, int step, qint64 predictedMs, qint64 actualMs);
+
+private:
+    struct Fixture
+    {
+        QString port;
+        SerialService* serial = nullptr;
+        WorkflowEngine* engine = nullptr;
+    };
+
+    QVector<ActionItem> shardFor(const QVector<ActionItem>& actions, int fixture) const;
+
+private:
+    WorkflowEngine* m_primary = nullptr;
+    QVector<Fixture> m_extra;
+    Mode m_mode = Mode::Broadcast;
+};
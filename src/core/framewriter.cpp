@@ -0,0 +1,144 @@
+#include "framewriter.h"
+
+#include "spacedhex.h"
+
+#include <cstring>
+
+namespace
+{
+const char kHexDigits[] = "0123456789ABCDEF";
+}
+
+namespace Protocol
+{
+FrameWriter::FrameWriter(qsizetype reserveBytes)
+{
+    m_buf.reserve(reserveBytes);
+}
+
+void FrameWriter::clear()
+{
+    if (m_buf.isDetached())
+    {
+        m_buf.truncate(0);
+        return;
+    }
+
+    // The previous frame is still referenced (e.g. queued for TX): start a fresh buffer
+    // of the same size instead of detaching into a small one.
+    const qsizetype cap = m_buf.capacity();
+    m_buf = QByteArray();
+    m_buf.reserve(cap);
+}
+
+char* FrameWriter::grow(qsizetype n)
+{
+    const qsizetype old = m_buf.size();
+    if (old + n > m_buf.capacity())
+        m_buf.reserve(qMax(old + n, m_buf.capacity() * 2));
+    m_buf.resize(old + n);
+    return m_buf.data() + old;
+}
+
+FrameWriter& FrameWriter::put(char c)
+{
+    *grow(1) = c;
+    return *this;
+}
+
+FrameWriter& FrameWriter::put(const char* ascii)
+{
+    return put(QByteArrayView(ascii, qsizetype(std::strlen(ascii))));
+}
+
+FrameWriter& FrameWriter::put(QByteArrayView bytes)
+{
+    if (!bytes.isEmpty())
+        std::memcpy(grow(bytes.size()), bytes.data(), size_t(bytes.size()));
+    return *this;
+}
+
+FrameWriter& FrameWriter::putInt(qint64 v)
+{
+    char tmp[24];
+    char* end = tmp + sizeof(tmp);
+    char* p = end;
+    quint64 u = (v < 0) ? (quint64(0) - quint64(v)) : quint64(v);
+    do
+    {
+        *--p = char('0' + (u % 10));
+        u /= 10;
+    } while (u != 0);
+    if (v < 0)
+        *--p = '-';
+    return put(QByteArrayView(p, end - p));
+}
+
+FrameWriter& FrameWriter::putIntList(const int* vals, qsizetype count, char sep)
+{
+    for (qsizetype i = 0; i < count; ++i)
+    {
+        if (i > 0)
+            put(sep);
+        putInt(vals[i]);
+    }
+    return *this;
+}
+
+FrameWriter& FrameWriter::putHex2(quint8 b)
+{
+    char* out = grow(2);
+    out[0] = kHexDigits[b >> 4];
+    out[1] = kHexDigits[b & 0x0F];
+    return *this;
+}
+
+FrameWriter& FrameWriter::putColorHex6(const QColor& c)
+{
+    putHex2(quint8(c.red()));
+    putHex2(quint8(c.green()));
+    putHex2(quint8(c.blue()));
+    return *this;
+}
+
+FrameWriter& FrameWriter::putSpacedHex(QByteArrayView bytes)
+{
+    const qsizetype n = bytes.size();
+    if (n == 0)
+        return *this;
+
+    encodeSpacedHex(bytes.data(), n, grow(spacedHexSize(n)));
+    return *this;
+}
+
+FrameWriter& FrameWriter::putVarUInt(quint64 v)
+{
+    char tmp[10];
+    int n = 0;
+    do
+    {
+        quint8 b = quint8(v & 0x7F);
+        v >>= 7;
+        if (v != 0)
+            b |= 0x80;
+        tmp[n++] = char(b);
+    } while (v != 0);
+    return put(QByteArrayView(tmp, n));
+}
+
+FrameWriter& FrameWriter::putU16LE(quint16 v)
+{
+    char* out = grow(2);
+    out[0] = char(v & 0xFF);
+    out[1] = char(v >> 8);
+    return *this;
+}
+
+void FrameWriter::patchU16LE(qsizetype pos, quint16 v)
+{
+    Q_ASSERT(pos >= 0 && pos + 2 <= m_buf.size());
+    char* out = m_buf.data() + pos;
+    out[0] = char(v & 0xFF);
+    out[1] = char(v >> 8);
+}
+} // namespace Protocol
@@ -0,0 +1,82 @@
+#pragma once
+/**
+ * @file framewriter.h
+ * @brief Allocation-free frame builder for the serial protocol (ASCII and binary).
+ *
+ * A FrameWriter owns one QByteArray that is reserved up front and reused across
+ * frames: clear() keeps the capacity, integers and hex are formatted in place,
+ * so packing a frame does not allocate once the buffer has grown to the working
+ * size. bytes() is the finished frame (callers add "\r\n" via endFrame()).
+ */
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QColor>
+
+namespace Protocol
+{
+class FrameWriter
+{
+public:
+    explicit FrameWriter(qsizetype reserveBytes = 512);
+
+    /**
+     * @brief Start a new frame; capacity is kept.
+     */
+    void clear();
+
+    /**
+     * @brief Drop everything from `size` on (abandon a partly written frame).
+     */
+    void truncate(qsizetype size) { m_buf.truncate(size); }
+
+    FrameWriter& put(char c);
+    FrameWriter& put(const char* ascii);
+    FrameWriter& put(QByteArrayView bytes);
+
+    FrameWriter& putInt(qint64 v);
+    FrameWriter& putIntList(const int* vals, qsizetype count, char sep = ',');
+
+    /**
+     * @brief Two uppercase hex digits, e.g. 0x0A -> "0A".
+     */
+    FrameWriter& putHex2(quint8 b);
+
+    /**
+     * @brief RRGGBB uppercase hex, e.g. "FF00AA".
+     */
+    FrameWriter& putColorHex6(const QColor& c);
+
+    /**
+     * @brief Space-separated uppercase hex bytes, e.g. "D6 D0 CE C4" (SIMD, see spacedhex.h).
+     */
+    FrameWriter& putSpacedHex(QByteArrayView bytes);
+
+    // ---- binary framing (see binaryframe.h) ----
+
+    /**
+     * @brief Unsigned LEB128: 7 bits per byte, high bit = more.
+     */
+    FrameWriter& putVarUInt(quint64 v);
+    FrameWriter& putU16LE(quint16 v);
+
+    /**
+     * @brief Overwrite two bytes already written at `pos` (length/CRC back-patching).
+     */
+    void patchU16LE(qsizetype pos, quint16 v);
+
+    /**
+     * @brief Terminate the frame with CRLF.
+     */
+    FrameWriter& endFrame() { return put("\r\n"); }
+
+    const QByteArray& bytes() const { return m_buf; }
+    qsizetype size() const { return m_buf.size(); }
+    bool isEmpty() const { return m_buf.isEmpty(); }
+
+private:
+    char* grow(qsizetype n); ///< extend size by n, return pointer to the new bytes
+
+    QByteArray m_buf;
+};
+} // namespace Protocol
@@ -0,0 +1,62 @@
+#include "gbkcodec.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+#include "gbktable.inc"
+
+constexpr char kUnmapped = '?';
+}
+
+namespace Gbk
+{
+quint16 codeFor(char16_t u)
+{
+    if (u >= kGbkCjkFirst && u <= kGbkCjkLast)
+        return kGbkCjk[u - kGbkCjkFirst];
+
+    const auto* end = std::end(kGbkOther);
+    const auto* it = std::lower_bound(std::begin(kGbkOther), end, u,
+                                      [](const GbkPair& p, char16_t v) { return p.unicode < v; });
+    return (it != end && it->unicode == u) ? it->code : 0;
+}
+
+void encodeAppend(QStringView text, QByteArray& out)
+{
+    out.reserve(out.size() + text.size() * 2);
+    const qsizetype n = text.size();
+    for (qsizetype i = 0; i < n; ++i)
+    {
+        const char16_t u = text[i].unicode();
+        if (u < 0x80)
+        {
+            out.append(char(u));
+            continue;
+        }
+        if (QChar::isHighSurrogate(u) && i + 1 < n && QChar::isLowSurrogate(text[i + 1].unicode()))
+        {
+            ++i; // one replacement per code point, not per code unit
+            out.append(kUnmapped);
+            continue;
+        }
+
+        const quint16 code = codeFor(u);
+        if (code == 0)
+        {
+            out.append(kUnmapped);
+            continue;
+        }
+        out.append(char(code >> 8));
+        out.append(char(code & 0xFF));
+    }
+}
+
+QByteArray encode(QStringView text)
+{
+    QByteArray out;
+    encodeAppend(text, out);
+    return out;
+}
+} // namespace Gbk
@@ -0,0 +1,31 @@
+#pragma once
+/**
+ * @file gbkcodec.h
+ * @brief Self-contained Unicode -> GBK (GB2312 superset, CP936) encoder.
+ *
+ * The mapping table is compiled in (gbktable.inc, generated by
+ * tools/gbktable/gen_gbk_table.py), so encoding behaves the same on every
+ * platform without QTextCodec / Qt5Compat or WideCharToMultiByte.
+ *
+ * - ASCII is copied through as one byte
+ * - CJK U+4E00..U+9FA5 is a direct table lookup; other symbols use a binary search
+ * - Characters GBK cannot represent (incl. non-BMP) become '?', like CP936 on Windows
+ */
+
+#include <QByteArray>
+#include <QStringView>
+
+namespace Gbk
+{
+    /**
+     * @brief Double-byte code (high byte first) for one BMP code unit; 0 if unmapped.
+     */
+    quint16 codeFor(char16_t u);
+
+    /**
+     * @brief Append the GBK bytes of `text` to `out`.
+     */
+    void encodeAppend(QStringView text, QByteArray& out);
+
+    QByteArray encode(QStringView text);
+}
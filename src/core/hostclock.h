@@ -0,0 +1,26 @@
+#pragma once
+/**
+ * @file hostclock.h
+ * @brief Monotonic host clock shared by the serial I/O thread, the engine and the logs.
+ *
+ * All host-side timestamps (TX enqueue / write, RX read) are taken from this one
+ * clock so they can be compared across threads.
+ */
+
+#include <QtGlobal>
+
+#include <chrono>
+
+namespace HostClock
+{
+    /**
+     * @brief Current monotonic time in nanoseconds (arbitrary epoch, never goes backwards).
+     */
+    inline qint64 nowNs()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    inline qint64 nsToMs(qint64 ns) { return ns / 1000000; }
+}
@@ -0,0 +1,204 @@
+#include "latencystats.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QtAlgorithms>
+
+#include <cmath>
+
+namespace
+{
+double toUs(qint64 ns) { return double(ns) / 1000.0; }
+
+const double kReportPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+}
+
+// ---------------------------------------------------------------------------
+// LatencyHistogram
+
+void LatencyHistogram::reset()
+{
+    m_counts.fill(0);
+    m_count = 0;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0;
+}
+
+int LatencyHistogram::indexFor(quint64 v)
+{
+    if (v < quint64(kSubBucketCount))
+        return int(v);
+    const int msb = 63 - int(qCountLeadingZeroBits(v));
+    const int shift = msb - (kSubBucketBits - 1); // keeps sub in [32, 63]
+    const int sub = int(v >> shift);
+    return kSubBucketCount + (shift - 1) * kSubBucketHalf + (sub - kSubBucketHalf);
+}
+
+quint64 LatencyHistogram::lowestValueAt(int index)
+{
+    if (index < kSubBucketCount)
+        return quint64(index);
+    const int k = index - kSubBucketCount;
+    const int shift = k / kSubBucketHalf + 1;
+    const quint64 sub = quint64(k % kSubBucketHalf + kSubBucketHalf);
+    return sub << shift;
+}
+
+quint64 LatencyHistogram::highestValueAt(int index)
+{
+    if (index < kSubBucketCount)
+        return quint64(index);
+    const int shift = (index - kSubBucketCount) / kSubBucketHalf + 1;
+    return lowestValueAt(index) + ((quint64(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(qint64 ns)
+{
+    if (ns < 0)
+        ns = 0;
+    ++m_counts[size_t(indexFor(quint64(ns)))];
+    if (m_count == 0 || ns < m_min)
+        m_min = ns;
+    if (ns > m_max)
+        m_max = ns;
+    ++m_count;
+    m_sum += ns;
+}
+
+qint64 LatencyHistogram::valueAtPercentile(double percentile) const
+{
+    if (m_count == 0)
+        return 0;
+    const double p = qBound(0.0, percentile, 100.0);
+    const quint64 target = qMax<quint64>(1, quint64(std::ceil(p / 100.0 * double(m_count))));
+
+    quint64 seen = 0;
+    for (int i = 0; i < kBucketCount; ++i)
+    {
+        seen += m_counts[size_t(i)];
+        if (seen >= target)
+            return qMin(qint64(highestValueAt(i)), m_max);
+    }
+    return m_max;
+}
+
+// ---------------------------------------------------------------------------
+// LatencyStats
+
+const char* LatencyStats::stageName(Stage s)
+{
+    switch (s)
+    {
+    case TriggerToEngine:    return "trigger_to_engine";
+    case EngineToPacked:     return "engine_to_packed";
+    case PackedToQueued:     return "packed_to_queued";
+    case QueuedToWritten:    return "queued_to_written";
+    case WrittenToFirstStep: return "written_to_first_step";
+    case StepToStep:         return "step_to_step";
+    case TriggerToFirstStep: return "trigger_to_first_step";
+    case StageCount:         break;
+    }
+    return "unknown";
+}
+
+void LatencyStats::reset()
+{
+    for (auto& h : m_hist)
+        h.reset();
+}
+
+bool LatencyStats::isEmpty() const
+{
+    for (const auto& h : m_hist)
+    {
+        if (h.count() > 0)
+            return false;
+    }
+    return true;
+}
+
+bool LatencyStats::exportCsv(const QString& path, QString& errMsg) const
+{
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        errMsg = f.errorString();
+        return false;
+    }
+
+    QByteArray out("stage,count,min_us,p50_us,p90_us,p99_us,p999_us,max_us,mean_us\n");
+    for (int s = 0; s < StageCount; ++s)
+    {
+        const LatencyHistogram& h = m_hist[size_t(s)];
+        out += stageName(Stage(s));
+        out += ',' + QByteArray::number(h.count());
+        out += ',' + QByteArray::number(toUs(h.min()), 'f', 1);
+        for (double p : kReportPercentiles)
+            out += ',' + QByteArray::number(toUs(h.valueAtPercentile(p)), 'f', 1);
+        out += ',' + QByteArray::number(toUs(h.max()), 'f', 1);
+        out += ',' + QByteArray::number(h.mean() / 1000.0, 'f', 1);
+        out += '\n';
+    }
+
+    f.write(out);
+    if (!f.commit())
+    {
+        errMsg = f.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool LatencyStats::exportJson(const QString& path, QString& errMsg) const
+{
+    QJsonArray stages;
+    for (int s = 0; s < StageCount; ++s)
+    {
+        const LatencyHistogram& h = m_hist[size_t(s)];
+        QJsonObject o;
+        o.insert(QStringLiteral("name"), QString::fromLatin1(stageName(Stage(s))));
+        o.insert(QStringLiteral("count"), double(h.count()));
+        o.insert(QStringLiteral("min"), toUs(h.min()));
+        o.insert(QStringLiteral("p50"), toUs(h.valueAtPercentile(50.0)));
+        o.insert(QStringLiteral("p90"), toUs(h.valueAtPercentile(90.0)));
+        o.insert(QStringLiteral("p99"), toUs(h.valueAtPercentile(99.0)));
+        o.insert(QStringLiteral("p999"), toUs(h.valueAtPercentile(99.9)));
+        o.insert(QStringLiteral("max"), toUs(h.max()));
+        o.insert(QStringLiteral("mean"), h.mean() / 1000.0);
+
+        // Only non-empty buckets: [lowUs, highUs, count]
+        QJsonArray buckets;
+        for (int i = 0; i < LatencyHistogram::kBucketCount; ++i)
+        {
+            const quint64 c = h.countAt(i);
+            if (c == 0)
+                continue;
+            buckets.append(QJsonArray{toUs(qint64(LatencyHistogram::lowestValueAt(i))),
+                                      toUs(qint64(LatencyHistogram::highestValueAt(i))),
+                                      double(c)});
+        }
+        o.insert(QStringLiteral("buckets"), buckets);
+        stages.append(o);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("unit"), QStringLiteral("us"));
+    root.insert(QStringLiteral("stages"), stages);
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+    {
+        errMsg = f.errorString();
+        return false;
+    }
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    if (!f.commit())
+    {
+        errMsg = f.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+/**
+ * @file latencystats.h
+ * @brief Per-stage latency histograms for the Next -> WORK -> STEPRUN round trip.
+ *
+ * LatencyHistogram is HDR-style: values (ns) fall into log-linear buckets with
+ * 64 sub-buckets per power of two, so any recorded value is reported within
+ * ~1.6% of its true size over the whole range (1 ns .. hours). Storage is a
+ * fixed array; record() never allocates and is cheap enough for the GUI thread.
+ *
+ * LatencyStats holds one histogram per Stage and exports a summary at the end
+ * of a run as CSV (one row per stage) or JSON (summary + non-empty buckets).
+ */
+
+#include <QString>
+#include <QtGlobal>
+
+#include <array>
+
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBucketBits = 6;
+    static constexpr int kSubBucketCount = 1 << kSubBucketBits;       ///< 64
+    static constexpr int kSubBucketHalf = kSubBucketCount / 2;        ///< 32
+    static constexpr int kBucketCount = kSubBucketCount + (64 - kSubBucketBits) * kSubBucketHalf;
+
+    void reset();
+
+    /**
+     * @brief Record one sample; negative values are clamped to 0.
+     */
+    void record(qint64 ns);
+
+    quint64 count() const { return m_count; }
+    qint64 min() const { return m_count ? m_min : 0; }
+    qint64 max() const { return m_max; }
+    double mean() const { return m_count ? double(m_sum) / double(m_count) : 0.0; }
+
+    /**
+     * @brief Smallest bucket upper bound covering `percentile` (0..100) of the samples.
+     */
+    qint64 valueAtPercentile(double percentile) const;
+
+    /**
+     * @brief Bucket helpers (exposed for export).
+     */
+    static int indexFor(quint64 v);
+    static quint64 lowestValueAt(int index);
+    static quint64 highestValueAt(int index);
+    quint64 countAt(int index) const { return m_counts[size_t(index)]; }
+
+private:
+    std::array<quint64, kBucketCount> m_counts{};
+    quint64 m_count = 0;
+    qint64 m_min = 0;
+    qint64 m_max = 0;
+    long double m_sum = 0;
+};
+
+class LatencyStats
+{
+public:
+    /**
+     * @brief Stages of one segment, in the order they happen.
+     */
+    enum Stage
+    {
+        TriggerToEngine = 0, ///< hotkey / onNext() -> runNextSegment()
+        EngineToPacked,      ///< runNextSegment() -> WORK frame ready (compiled-plan lookup)
+        PackedToQueued,      ///< packed -> SerialService::sendBytes/sendBinary returned
+        QueuedToWritten,     ///< queued -> OS write complete (txCompleted)
+        WrittenToFirstStep,  ///< write complete -> first STEPRUN received
+        StepToStep,          ///< STEPRUN k-1 -> STEPRUN k (same segment)
+        TriggerToFirstStep,  ///< end to end: trigger -> first STEPRUN
+        StageCount
+    };
+
+    static const char* stageName(Stage s);
+
+    void reset();
+    void record(Stage s, qint64 ns) { m_hist[size_t(s)].record(ns); }
+    const LatencyHistogram& histogram(Stage s) const { return m_hist[size_t(s)]; }
+    bool isEmpty() const;
+
+    /**
+     * @brief stage,count,min_us,p50_us,p90_us,p99_us,p999_us,max_us,mean_us
+     */
+    bool exportCsv(const QString& path, QString& errMsg) const;
+
+    /**
+     * @brief {"unit":"us","stages":[{name,count,min,p50,...,buckets:[[lo,hi,count],...]}]}
+     */
+    bool exportJson(const QString& path, QString& errMsg) const;
+
+private:
+    std::array<LatencyHistogram, StageCount> m_hist;
+};
@@ -1,68 +1,88 @@
 #include "protocol.h"
-#include "protocol.h"
+
+#include "gbkcodec.h"
 
 #include <algorithm>
+#include <QHash>
+#include <QMutex>
 #include <QRandomGenerator>
-
-#ifdef _WIN32
-    #include <windows.h>
-#else
-    #if __has_include(<QTextCodec>)
-        #include <QTextCodec>
-    #endif
-#endif
+#include <QVarLengthArray>
 
 namespace
 {
-QString joinInts(const QVector<int>& vals)
+/**
+ * @brief 语音文本编码结果：GBK 原始字节（二进制帧）与空格分隔的十六进制（文本帧）
+ */
+struct EncodedVoice
+{
+    QByteArray gbk;
+    QByteArray spacedHex;
+};
+
+constexpr qsizetype kVoiceMemoMaxEntries = 4096;
+
+/**
+ * @brief 按文本记忆编码结果：同一句提示在几百行里反复出现，只编码一次
+ * @note 超过上限直接清空（计划里的不同文本通常只有几十条）
+ */
+EncodedVoice encodeVoiceText(const QString& text)
 {
-    QStringList parts;
-    parts.reserve(vals.size());
-    for (int v : vals) parts << QString::number(v);
-    return parts.join(",");
+    static QMutex mutex;
+    static QHash<QString, EncodedVoice> memo;
+
+    QMutexLocker lock(&mutex);
+    const auto it = memo.constFind(text);
+    if (it != memo.constEnd())
+        return it.value();
+
+    EncodedVoice v;
+    v.gbk = Gbk::encode(text);
+    Protocol::FrameWriter hex(v.gbk.size() * 3);
+    hex.putSpacedHex(v.gbk);
+    v.spacedHex = hex.bytes();
+
+    if (memo.size() >= kVoiceMemoMaxEntries)
+        memo.clear();
+    memo.insert(text, v);
+    return v;
 }
 
-QString toHex6(const QColor& c)
+QString frameToString(const Protocol::FrameWriter& w)
 {
-    return QString("%1%2%3")
-        .arg(c.red(),   2, 16, QChar('0'))
-        .arg(c.green(), 2, 16, QChar('0'))
-        .arg(c.blue(),  2, 16, QChar('0'))
-        .toUpper();
+    return QString::fromLatin1(w.bytes());
 }
 
-QString bytesToSpacedHex(const QByteArray& bytes)
+using OrderBuffer = QVarLengthArray<int, 16>;
+
+void buildOrders(const QString& mode, int ledCount, OrderBuffer& orders, QRandomGenerator* rng)
 {
-    QStringList parts;
-    parts.reserve(bytes.size());
-    for (unsigned char b : bytes)
-        parts << QString::number(b, 16).rightJustified(2, QChar('0')).toUpper();
-    return parts.join(' ');
+    orders.resize(ledCount);
+    const QString u = mode.trimmed().toUpper();
+    if (u == QStringLiteral("RAND"))
+    {
+        for (int i = 0; i < ledCount; ++i)
+            orders[i] = i + 1;
+        std::shuffle(orders.begin(), orders.end(), rng ? *rng : *QRandomGenerator::global());
+    }
+    else if (u == QStringLiteral("SEQ"))
+    {
+        for (int i = 0; i < ledCount; ++i)
+            orders[i] = i + 1;
+    }
+    else
+    {
+        for (int i = 0; i < ledCount; ++i)
+            orders[i] = 0;
+    }
 }
 
-QByteArray toGb2312Bytes(const QString& text)
+void writeVoiceSetBody(Protocol::FrameWriter& w, const VoiceProps& v)
 {
-#ifdef _WIN32
-    if (text.isEmpty())
-        return QByteArray();
-    const int wideLen = text.size();
-    const wchar_t* wide = reinterpret_cast<const wchar_t*>(text.utf16());
-    int len = WideCharToMultiByte(936, 0, wide, wideLen, nullptr, 0, nullptr, nullptr);
-    if (len <= 0)
-        return QByteArray();
-    QByteArray out;
-    out.resize(len);
-    WideCharToMultiByte(936, 0, wide, wideLen, out.data(), len, nullptr, nullptr);
-    return out;
-#else
-    #if __has_include(<QTextCodec>)
-    if (auto* codec = QTextCodec::codecForName("GB2312"))
-        return codec->fromUnicode(text);
-    if (auto* codec = QTextCodec::codecForName("GBK"))
-        return codec->fromUnicode(text);
-    #endif
-    return text.toUtf8();
-#endif
+    w.putInt(v.announcer).put(',')
+     .putInt(v.voiceStyle).put(',')
+     .putInt(v.voiceSpeed).put(',')
+     .putInt(v.voicePitch).put(',')
+     .putInt(v.voiceVolume);
 }
 }
 
@@ -84,160 +104,485 @@ QString escapeVoiceText(const QString &text)
     return out;
 }
 
-QString packLedConfig(const DeviceProps &dev, const QVector<ColorItem> &colors)
+void writeLedConfig(FrameWriter &w, const DeviceProps &dev, const QVector<ColorItem> &colors)
 {
-    QString out = QStringLiteral("LEDSET:%1,%2,%3,%4,%5")
-                      .arg(dev.ledCount)
-                      .arg(dev.onMs)
-                      .arg(dev.gapMs)
-                      .arg(dev.brightness)
-                      .arg(colors.size());
+    w.put("LEDSET:")
+     .putInt(dev.ledCount).put(',')
+     .putInt(dev.onMs).put(',')
+     .putInt(dev.gapMs).put(',')
+     .putInt(dev.brightness).put(',')
+     .putInt(colors.size());
 
     for (const auto& c : colors)
-        out += QStringLiteral(",%1").arg(toHex6(c.rgb));
+        w.put(',').putColorHex6(c.rgb);
 
-    return out + "\r\n";
+    w.endFrame();
 }
 
-QString packVoiceConfig1(const VoiceProps &v)
+void writeVoiceConfig(FrameWriter &w, int setIndex, const VoiceProps &v)
 {
-    return QStringLiteral("VOICESET1:%1,%2,%3,%4,%5\r\n")
-        .arg(v.announcer)
-        .arg(v.voiceStyle)
-        .arg(v.voiceSpeed)
-        .arg(v.voicePitch)
-        .arg(v.voiceVolume);
+    w.put(setIndex == 2 ? "VOICESET2:" : "VOICESET1:");
+    writeVoiceSetBody(w, v);
+    w.endFrame();
 }
 
-QString packVoiceConfig2(const VoiceProps &v)
+void writeBeepConfig(FrameWriter &w, const DeviceProps &dev)
 {
-    return QStringLiteral("VOICESET2:%1,%2,%3,%4,%5\r\n")
-        .arg(v.announcer)
-        .arg(v.voiceStyle)
-        .arg(v.voiceSpeed)
-        .arg(v.voicePitch)
-        .arg(v.voiceVolume);
+    w.put("BEEPSET:").putInt(dev.buzzerDurMs).put(',').putInt(dev.buzzerFreq).endFrame();
 }
 
-QString packBeepConfig(const DeviceProps &dev)
+void writeVoiceTest(FrameWriter &w, const QString &text, int style)
 {
-    return QStringLiteral("BEEPSET:%1,%2\r\n")
-        .arg(dev.buzzerDurMs)
-        .arg(dev.buzzerFreq);
+    w.put("VOICETEST:").put(QByteArrayView(encodeVoiceText(text).spacedHex)).put(',').putInt(style).endFrame();
 }
 
-QString packBeepTest(const DeviceProps &dev)
+void VoiceDictionary::clear()
 {
-    Q_UNUSED(dev);
-    return QStringLiteral("BEEPTEST\r\n");
+    m_ids.clear();
+    m_texts.clear();
 }
 
-QString packTestSolid(int colorIndex)
+void VoiceDictionary::build(const ActionItem *actions, qsizetype count)
 {
-    return QStringLiteral("LEDTEST:%1\r\n").arg(colorIndex);
+    clear();
+
+    struct Candidate
+    {
+        QString text;
+        qsizetype bytes = 0;
+        int uses = 0;
+    };
+    QHash<QString, int> index;
+    QVector<Candidate> candidates;
+    for (qsizetype i = 0; i < count; ++i)
+    {
+        const ActionItem& a = actions[i];
+        if (a.type != ActionType::V || a.voiceText.isEmpty())
+            continue;
+        const auto it = index.constFind(a.voiceText);
+        if (it != index.constEnd())
+        {
+            ++candidates[it.value()].uses;
+            continue;
+        }
+        Candidate c;
+        c.text = a.voiceText;
+        c.bytes = encodeVoiceText(a.voiceText).gbk.size();
+        c.uses = 1;
+        index.insert(c.text, int(candidates.size()));
+        candidates.push_back(c);
+    }
+
+    // Most bytes saved first; ties keep plan order so ids are stable for the same script.
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return qint64(a.uses) * a.bytes > qint64(b.uses) * b.bytes;
+    });
+
+    qsizetype budget = kMaxVoiceDefBytes;
+    for (const Candidate& c : candidates)
+    {
+        if (m_texts.size() >= kMaxVoiceDefs)
+            break;
+        // "#<id>" (2..4 chars) must beat the inline spaced hex (3 * bytes - 1 chars).
+        if (c.bytes < 2 || c.bytes > budget)
+            continue;
+        budget -= c.bytes;
+        m_texts << c.text;
+        m_ids.insert(c.text, int(m_texts.size()));
+    }
 }
 
-QString packTestAllOff()
+void writeVoiceDef(FrameWriter &w, int id, const QString &text)
 {
-    return QStringLiteral("LEDTEST:-1\r\n");
+    w.put("VOICEDEF:").putInt(id).put(',').put(QByteArrayView(encodeVoiceText(text).spacedHex)).endFrame();
 }
 
-QString packVoiceTest(const QString &text, int style)
+bool writeVoiceDefBinary(FrameWriter &w, int id, const QString &text)
 {
-    const QString hex = bytesToSpacedHex(toGb2312Bytes(text));
-    return QStringLiteral("VOICETEST:%1,%2\r\n").arg(hex).arg(style);
+    const QByteArray bytes = encodeVoiceText(text).gbk;
+    const qsizetype h = beginBinaryFrame(w, BinaryType::VoiceDef);
+    w.putVarUInt(quint64(qMax(0, id))).putVarUInt(quint64(bytes.size())).put(QByteArrayView(bytes));
+    return endBinaryFrame(w, h, kMaxBinaryPayloadBytes - kBinaryWrapBytes);
 }
 
-static QVector<int> buildOrders(const QString& mode, int ledCount)
+void writeStepRun(FrameWriter &w, int currentStep, qint64 startTimeMs)
 {
-    QVector<int> orders;
-    orders.resize(ledCount);
-    const QString u = mode.trimmed().toUpper();
-    if (u == QStringLiteral("RAND"))
-    {
-        QVector<int> indices;
-        indices.reserve(ledCount);
-        for (int i = 1; i <= ledCount; ++i)
-            indices.push_back(i);
-        std::shuffle(indices.begin(), indices.end(), *QRandomGenerator::global());
-        orders = indices;
-    }
-    else if (u == QStringLiteral("SEQ"))
-    {
-        for (int i = 0; i < ledCount; ++i)
-            orders[i] = i + 1;
-    }
-    else
-    {
-        for (int i = 0; i < ledCount; ++i)
-            orders[i] = 0;
-    }
-    return orders;
+    w.put("STEPRUN:").putInt(currentStep).put(',').putInt(startTimeMs).endFrame();
 }
 
-QString packWork(const QVector<ActionItem> &actions, const DeviceProps &dev)
+void writeWork(FrameWriter &w, const ActionItem *actions, qsizetype count, const DeviceProps &dev,
+               QRandomGenerator *rng, const VoiceDictionary *dict)
 {
-    QStringList parts;
+    const int ledCount = qMax(0, dev.ledCount);
+    OrderBuffer orders;
+    QVarLengthArray<int, 16> colors;
+
+    w.put("WORK:");
+    bool first = true;
 
     // assume actions already follow header order
-    for (const auto& a : actions)
+    for (qsizetype i = 0; i < count; ++i)
     {
+        const ActionItem& a = actions[i];
+        if (a.type == ActionType::Unknown)
+            continue;
+        if (!first)
+            w.put(';');
+        first = false;
+
         if (a.type == ActionType::L)
         {
-            const int ledCount = dev.ledCount;
-            QVector<int> colors = a.ledColors;
-            if (colors.size() < ledCount)
-                colors.resize(ledCount, 0);
-            else if (colors.size() > ledCount)
-                colors.resize(ledCount);
-
-            const QVector<int> orders = buildOrders(a.ledMode, ledCount);
-            QStringList ledFields;
-            ledFields << QStringLiteral("LED")
-                      << joinInts(orders)
-                      << joinInts(colors);
-            parts << ledFields.join(',');
+            colors.resize(ledCount);
+            for (int k = 0; k < ledCount; ++k)
+                colors[k] = (k < a.ledColors.size()) ? a.ledColors[k] : 0;
+
+            buildOrders(a.ledMode, ledCount, orders, rng);
+            w.put("LED,")
+             .putIntList(orders.constData(), orders.size())
+             .put(',')
+             .putIntList(colors.constData(), colors.size());
         }
         else if (a.type == ActionType::D)
         {
-            parts << QStringLiteral("DELAY,%1").arg(a.delayMs);
+            w.put("DELAY,").putInt(a.delayMs);
         }
         else if (a.type == ActionType::V)
         {
             const int style = (a.voiceSet == 2) ? 2 : 1;
-            const QString hex = bytesToSpacedHex(toGb2312Bytes(a.voiceText));
-            parts << QStringLiteral("VOICE,%1,%2").arg(hex).arg(style);
+            const int id = dict ? dict->idFor(a.voiceText) : 0;
+            if (id > 0)
+                w.put("VOICE,#").putInt(id).put(',').putInt(style);
+            else
+                w.put("VOICE,").put(QByteArrayView(encodeVoiceText(a.voiceText).spacedHex)).put(',').putInt(style);
         }
         else if (a.type == ActionType::B)
         {
-            parts << QStringLiteral("BEEP");
+            w.put("BEEP");
         }
     }
 
-    return QStringLiteral("WORK:%1;\r\n").arg(parts.join(';'));
+    w.put(';').endFrame();
 }
 
-SetpRun parseSetpRun(const QString &line)
+bool writeLedConfigBinary(FrameWriter &w, const DeviceProps &dev, const QVector<ColorItem> &colors)
 {
-    SetpRun r;
-    const QString trimmed = line.trimmed();
-    if (!trimmed.startsWith(QStringLiteral("STEPRUN:")))
+    const qsizetype h = beginBinaryFrame(w, BinaryType::LedSet);
+    w.putVarUInt(quint64(qMax(0, dev.ledCount)))
+     .putVarUInt(quint64(qMax(0, dev.onMs)))
+     .putVarUInt(quint64(qMax(0, dev.gapMs)))
+     .putVarUInt(quint64(qMax(0, dev.brightness)))
+     .putVarUInt(quint64(colors.size()));
+    for (const auto& c : colors)
+        w.put(char(c.rgb.red())).put(char(c.rgb.green())).put(char(c.rgb.blue()));
+    return endBinaryFrame(w, h, kMaxBinaryPayloadBytes - kBinaryWrapBytes);
+}
+
+bool writeWorkBinary(FrameWriter &w, const ActionItem *actions, qsizetype count, const DeviceProps &dev,
+                     QRandomGenerator *rng, const VoiceDictionary *dict)
+{
+    const int ledCount = qMax(0, dev.ledCount);
+    OrderBuffer orders;
+
+    qsizetype known = 0;
+    for (qsizetype i = 0; i < count; ++i)
+        known += (actions[i].type != ActionType::Unknown) ? 1 : 0;
+
+    const qsizetype h = beginBinaryFrame(w, BinaryType::Work);
+    w.putVarUInt(quint64(known));
+
+    for (qsizetype i = 0; i < count; ++i)
+    {
+        const ActionItem& a = actions[i];
+        switch (a.type)
+        {
+        case ActionType::L:
+            buildOrders(a.ledMode, ledCount, orders, rng);
+            w.put(char(BinaryAction::Led)).putVarUInt(quint64(ledCount));
+            for (int k = 0; k < ledCount; ++k)
+                w.putVarUInt(quint64(orders[k]));
+            for (int k = 0; k < ledCount; ++k)
+                w.putVarUInt(quint64(qMax(0, (k < a.ledColors.size()) ? a.ledColors[k] : 0)));
+            break;
+        case ActionType::D:
+            w.put(char(BinaryAction::Delay)).putVarUInt(quint64(qMax(0, a.delayMs)));
+            break;
+        case ActionType::V:
+        {
+            const int id = dict ? dict->idFor(a.voiceText) : 0;
+            if (id > 0)
+            {
+                w.put(char(BinaryAction::VoiceRef)).putVarUInt((a.voiceSet == 2) ? 2 : 1).putVarUInt(quint64(id));
+                break;
+            }
+            const QByteArray text = encodeVoiceText(a.voiceText).gbk;
+            w.put(char(BinaryAction::Voice))
+             .putVarUInt((a.voiceSet == 2) ? 2 : 1)
+             .putVarUInt(quint64(text.size()))
+             .put(QByteArrayView(text));
+            break;
+        }
+        case ActionType::B:
+            w.put(char(BinaryAction::Beep));
+            break;
+        case ActionType::Unknown:
+            break;
+        }
+    }
+
+    return endBinaryFrame(w, h, kMaxBinaryPayloadBytes - kBinaryWrapBytes);
+}
+
+void writeVersionQuery(FrameWriter &w)
+{
+    w.put("VER?").endFrame();
+}
+
+void writeVersionReply(FrameWriter &w, int version, bool binary, bool sequenced, bool dictionary, bool staging)
+{
+    w.put("VER:").putInt(version);
+    if (binary)
+        w.put(",BIN");
+    if (sequenced)
+        w.put(",SEQ");
+    if (dictionary)
+        w.put(",DICT");
+    if (staging)
+        w.put(",STAGE");
+    w.endFrame();
+}
+
+VersionInfo parseVersionReply(const QString &line)
+{
+    VersionInfo r;
+    RxMessage m;
+    const QByteArray bytes = line.toLatin1();
+    if (decodeRx(bytes, m) != RxKind::Version)
         return r;
+    r.ok = true;
+    r.version = m.version;
+    r.binary = m.binary;
+    r.sequenced = m.sequenced;
+    r.dictionary = m.dictionary;
+    r.staging = m.staging;
+    return r;
+}
+
+bool writeStageWork(FrameWriter &w, quint16 stageId, QByteArrayView workFrame, bool binary)
+{
+    if (binary)
+    {
+        BinaryFrame f;
+        qsizetype used = 0;
+        const BinaryDecode r = decodeBinaryFrame(workFrame, f, used);
+        Q_ASSERT(r == BinaryDecode::Ok && f.type == quint8(BinaryType::Work));
+        Q_UNUSED(r);
+        const qsizetype h = beginBinaryFrame(w, BinaryType::Stage);
+        w.putVarUInt(stageId).put(f.payload);
+        return endBinaryFrame(w, h, kMaxBinaryPayloadBytes - 2); // still fits the sequenced wrapper
+    }
+
+    while (workFrame.endsWith('\n') || workFrame.endsWith('\r'))
+        workFrame.chop(1);
+    w.put("STAGE:").putInt(stageId).put(',').put(workFrame).endFrame();
+    return true;
+}
+
+void writeGo(FrameWriter &w, quint16 stageId)
+{
+    w.put("GO:").putInt(stageId).endFrame();
+}
+
+bool writeSequencedFrame(FrameWriter &w, quint16 seq, QByteArrayView frame, bool binary)
+{
+    if (binary)
+    {
+        BinaryFrame f;
+        qsizetype used = 0;
+        const BinaryDecode r = decodeBinaryFrame(frame, f, used);
+        Q_ASSERT(r == BinaryDecode::Ok);
+        Q_UNUSED(r);
+        const qsizetype h = beginBinaryFrame(w, BinaryType(f.type | kBinarySeqFlag));
+        w.putU16LE(seq).put(f.payload);
+        return endBinaryFrame(w, h);
+    }
+
+    while (frame.endsWith('\n') || frame.endsWith('\r'))
+        frame.chop(1);
+    w.put('@');
+    const qsizetype from = w.size();
+    w.putInt(seq).put(':').put(frame);
+    const quint16 crc = crc16Ccitt(QByteArrayView(w.bytes()).sliced(from));
+    w.put('*').putHex2(quint8(crc >> 8)).putHex2(quint8(crc & 0xFF)).endFrame();
+    return true;
+}
 
-    const QString body = trimmed.mid(QStringLiteral("STEPRUN:").length());
-    const QStringList parts = body.split(',', Qt::KeepEmptyParts);
-    if (parts.size() < 2)
+AckInfo parseAck(const QString &line)
+{
+    AckInfo r;
+    RxMessage m;
+    const QByteArray bytes = line.toLatin1();
+    const RxKind kind = decodeRx(bytes, m);
+    if (kind != RxKind::Ack && kind != RxKind::Nak)
         return r;
+    r.ok = true;
+    r.nak = (kind == RxKind::Nak);
+    r.seq = m.seq;
+    return r;
+}
+
+void writeAck(FrameWriter &w, quint16 seq, bool nak)
+{
+    w.put(nak ? "NAK:" : "ACK:").putInt(seq).endFrame();
+}
 
-    bool ok1=false, ok2=false;
-    const int step = parts[0].toInt(&ok1);
-    const qint64 ts = parts[1].toLongLong(&ok2);
-    if (ok1 && ok2)
+const char* configBlockName(ConfigBlock b)
+{
+    switch (b)
     {
-        r.ok = true;
-        r.currentStep = step;
-        r.startTimeMs = ts;
+    case ConfigBlock::LedSet:    return "LEDSET";
+    case ConfigBlock::VoiceSet1: return "VOICESET1";
+    case ConfigBlock::VoiceSet2: return "VOICESET2";
+    case ConfigBlock::BeepSet:   return "BEEPSET";
     }
+    return "?";
+}
+
+quint32 configHash(QByteArrayView content)
+{
+    const quint32 h = crc32(content);
+    return h ? h : 1;
+}
+
+quint32 configFrameHash(QByteArrayView frame, bool binary)
+{
+    if (binary)
+    {
+        if (frame.size() < kBinaryOverheadBytes)
+            return configHash(frame);
+        return configHash(frame.sliced(kBinaryHeaderBytes, frame.size() - kBinaryOverheadBytes));
+    }
+    while (frame.endsWith('\n') || frame.endsWith('\r'))
+        frame.chop(1);
+    return configHash(frame);
+}
+
+void writeConfigHashQuery(FrameWriter &w)
+{
+    w.put("CFGHASH?").endFrame();
+}
+
+void writeConfigHashReply(FrameWriter &w, const quint32 (&hashes)[kConfigBlockCount])
+{
+    w.put("CFGHASH:");
+    for (int i = 0; i < kConfigBlockCount; ++i)
+    {
+        if (i > 0)
+            w.put(',');
+        const quint32 h = hashes[i];
+        w.putHex2(quint8(h >> 24)).putHex2(quint8(h >> 16)).putHex2(quint8(h >> 8)).putHex2(quint8(h));
+    }
+    w.endFrame();
+}
+
+void writeDeviceReport(FrameWriter &w, bool fault, int code, QByteArrayView detail)
+{
+    w.put(fault ? "FAULT:" : "ERR:").putInt(code);
+    if (!detail.isEmpty())
+        w.put(',').put(detail);
+    w.endFrame();
+}
+
+bool unwrapSequencedText(QByteArrayView line, quint16 &seq, QByteArrayView &body, bool &crcOk)
+{
+    crcOk = false;
+    if (!line.startsWith('@'))
+        return false;
+
+    const qsizetype star = line.lastIndexOf('*');
+    const qsizetype colon = line.indexOf(':');
+    if (star < 0 || colon < 0 || colon > star || line.size() - star - 1 != 4)
+        return true;
+
+    bool seqOk = false, crcParsed = false;
+    const uint s = line.sliced(1, colon - 1).toUInt(&seqOk);
+    const uint crc = line.sliced(star + 1).toUInt(&crcParsed, 16);
+    if (!seqOk || !crcParsed || s > 0xFFFF)
+        return true;
+
+    seq = quint16(s);
+    body = line.sliced(colon + 1, star - colon - 1);
+    crcOk = (crc16Ccitt(line.sliced(1, star - 1)) == crc);
+    return true;
+}
+
+QString packLedConfig(const DeviceProps &dev, const QVector<ColorItem> &colors)
+{
+    FrameWriter w;
+    writeLedConfig(w, dev, colors);
+    return frameToString(w);
+}
+
+QString packVoiceConfig1(const VoiceProps &v)
+{
+    FrameWriter w;
+    writeVoiceConfig(w, 1, v);
+    return frameToString(w);
+}
+
+QString packVoiceConfig2(const VoiceProps &v)
+{
+    FrameWriter w;
+    writeVoiceConfig(w, 2, v);
+    return frameToString(w);
+}
+
+QString packBeepConfig(const DeviceProps &dev)
+{
+    FrameWriter w;
+    writeBeepConfig(w, dev);
+    return frameToString(w);
+}
+
+QString packBeepTest(const DeviceProps &dev)
+{
+    Q_UNUSED(dev);
+    return QStringLiteral("BEEPTEST\r\n");
+}
+
+QString packTestSolid(int colorIndex)
+{
+    return QStringLiteral("LEDTEST:%1\r\n").arg(colorIndex);
+}
+
+QString packTestAllOff()
+{
+    return QStringLiteral("LEDTEST:-1\r\n");
+}
+
+QString packVoiceTest(const QString &text, int style)
+{
+    FrameWriter w;
+    writeVoiceTest(w, text, style);
+    return frameToString(w);
+}
+
+QString packWork(const QVector<ActionItem> &actions, const DeviceProps &dev)
+{
+    FrameWriter w;
+    writeWork(w, actions.constData(), actions.size(), dev);
+    return frameToString(w);
+}
+
+SetpRun parseSetpRun(const QString &line)
+{
+    SetpRun r;
+    RxMessage m;
+    const QByteArray bytes = line.toLatin1();
+    if (decodeRx(bytes, m) != RxKind::StepRun)
+        return r;
+    r.ok = true;
+    r.currentStep = m.step;
+    r.startTimeMs = m.startTimeMs;
     return r;
 }
 
@@ -12,22 +12,185 @@
  *   * LED action: LED,<order1..N>,<color1..N> (order zeros for ALL/SEQ; shuffled for RAND)
  *   * DELAY action: DELAY,<ms>
  *   * VOICE action: VOICE,<gb2312_hex_bytes_with_spaces>,<style>
+ *     or VOICE,#<id>,<style> referencing a VOICEDEF entry (dictionary mode)
  *   * BEEP action: BEEP
- * - RX progress: SETPRUN:<currentStep>,<startTimeMs>\r\n
+ * - RX progress: STEPRUN:<currentStep>,<startTimeMs>\r\n (SETPRUN: accepted as an alias)
  * - VOICETEST:<gb2312_hex_bytes_with_spaces>,<style>\r\n
+ * - Handshake: host VER?\r\n -> device VER:<version>[,BIN][,SEQ][,DICT][,STAGE]\r\n
+ * - Phrase dictionary (after the device advertised DICT): VOICEDEF:<id>,<gb2312_hex_bytes_with_spaces>\r\n
+ *   stores a voice text under id 1..kMaxVoiceDefs; sent once per run before the first WORK.
+ *   A later VOICEDEF with the same id replaces the entry; VER? clears the table.
+ * - Prefetch (after the device advertised STAGE): STAGE:<id>,WORK:...\r\n loads a WORK frame into the
+ *   device's single staging buffer (replacing whatever was there) without running it; GO:<id>\r\n
+ *   queues the staged frame for execution exactly like a WORK arriving at that moment. GO with an
+ *   id that is not staged is answered with ERR:2. VER? empties the buffer.
+ * - Config fingerprints: host CFGHASH?\r\n -> device CFGHASH:<led>,<voice1>,<voice2>,<beep>\r\n
+ *   8 hex digits each: configHash() of the last block the device accepted, 00000000 = never configured
+ * - RX errors: ERR:<code>[,<detail>]\r\n (frame/action rejected), FAULT:<code>[,<detail>]\r\n (device fault)
+ *
+ * Device reports are decoded without allocation by rxdecoder.h; the QString parse*
+ * helpers below are thin wrappers kept for callers that already hold a QString.
+ *
+ * Sequenced delivery (after the device advertised SEQ; VER? resets the device to expect seq 1):
+ * - text:   @<seq>:<frame without CRLF>*<CRC-16 of "<seq>:<frame>", 4 uppercase hex>\r\n
+ * - binary: type | kBinarySeqFlag, payload prefixed with seq (u16 LE)
+ * - device: ACK:<seq>\r\n  cumulative, everything up to seq executed (duplicates are re-ACKed)
+ *           NAK:<seq>\r\n  frame seq missing/corrupt, resend from seq (go-back-N)
+ *
+ * Binary mode (after the device advertised BIN; framing in binaryframe.h):
+ * - LedSet payload: ledCount, onMs, intervalMs, brightness, colorCount, then colorCount x RGB (3 raw bytes)
+ * - Work payload: actionCount, then per action a kind byte (BinaryAction) followed by
+ *   * Led:   n, order1..n, color1..n
+ *   * Delay: ms
+ *   * Voice: style, byteLen, raw GB2312 bytes
+ *   * Beep:  (nothing)
+ *   * VoiceRef: style, id (dictionary mode)
+ * - VoiceDef payload: id, byteLen, raw GB2312 bytes
+ * - Stage payload: id, then a Work payload
+ *   Numbers are varints; negative values are sent as 0.
  */
 
+#include <QHash>
 #include <QString>
 #include <QStringList>
 #include <QVector>
 
 #include "../config/appsettings.h"
+#include "binaryframe.h"
+#include "framewriter.h"
 #include "models.h"
+#include "rxdecoder.h"
+
+class QRandomGenerator;
 
 namespace Protocol
 {
     QString escapeVoiceText(const QString& text);
 
+    constexpr int kMaxVoiceDefs = 255;           ///< device table entries
+    constexpr qsizetype kMaxVoiceDefBytes = 8192; ///< device table size (GB2312 bytes)
+
+    /**
+     * @brief 语音短语字典：计划里的不同 VOICE 文本各分配一个 id，每次 Run 用 VOICEDEF 下发一次，
+     *        WORK 里只带 VOICE,#id,style
+     *
+     * 超出设备容量时按“出现次数 x 字节数”优先收录，其余文本仍内联；
+     * 内联不比引用长的极短文本不收录。
+     */
+    class VoiceDictionary
+    {
+    public:
+        void clear();
+        void build(const ActionItem* actions, qsizetype count);
+
+        bool isEmpty() const { return m_texts.isEmpty(); }
+        int size() const { return int(m_texts.size()); }
+        int idFor(const QString& text) const { return m_ids.value(text, 0); } ///< 0 = inline
+        const QString& textFor(int id) const { return m_texts[id - 1]; }    ///< id 1..size()
+
+    private:
+        QHash<QString, int> m_ids;
+        QStringList m_texts;
+    };
+
+    void writeVoiceDef(FrameWriter& w, int id, const QString& text);
+    bool writeVoiceDefBinary(FrameWriter& w, int id, const QString& text); ///< false: too long, nothing written
+
+    // Byte-native packers: append one complete frame (incl. CRLF) to `w` without
+    // going through QString. The QString pack* functions below wrap these.
+    void writeLedConfig(FrameWriter& w, const DeviceProps& dev, const QVector<ColorItem>& colors);
+    void writeVoiceConfig(FrameWriter& w, int setIndex, const VoiceProps& v); ///< setIndex 1/2
+    void writeBeepConfig(FrameWriter& w, const DeviceProps& dev);
+    /**
+     * @brief WORK frame; RAND orders are drawn from `rng` (nullptr = QRandomGenerator::global())
+     * @param dict voice texts found here are sent as VOICE,#id (nullptr = always inline)
+     */
+    void writeWork(FrameWriter& w, const ActionItem* actions, qsizetype count, const DeviceProps& dev,
+                   QRandomGenerator* rng = nullptr, const VoiceDictionary* dict = nullptr);
+    void writeVoiceTest(FrameWriter& w, const QString& text, int style);
+
+    // Binary counterparts (same action semantics as the text frames). They return false and
+    // write nothing when the payload would not fit the u16 length field (minus kBinaryWrapBytes);
+    // the caller then sends the text frame instead.
+    bool writeLedConfigBinary(FrameWriter& w, const DeviceProps& dev, const QVector<ColorItem>& colors);
+    bool writeWorkBinary(FrameWriter& w, const ActionItem* actions, qsizetype count, const DeviceProps& dev,
+                         QRandomGenerator* rng = nullptr, const VoiceDictionary* dict = nullptr);
+
+    // Version handshake
+    constexpr int kProtocolVersion = 2;
+    void writeVersionQuery(FrameWriter& w);
+    void writeVersionReply(FrameWriter& w, int version, bool binary, bool sequenced,
+                           bool dictionary = false, bool staging = false); ///< device side
+
+    struct VersionInfo
+    {
+        bool ok = false;
+        int version = 0;
+        bool binary = false;
+        bool sequenced = false;
+        bool dictionary = false;
+        bool staging = false;
+    };
+    VersionInfo parseVersionReply(const QString& line);
+
+    // Prefetch
+    constexpr int kErrNotStaged = 2; ///< device: GO for an id that is not in the staging buffer
+
+    /**
+     * @brief Wrap a complete WORK frame (text or binary, as compiled) into a STAGE frame
+     * @return false (nothing written) if the binary STAGE payload would not fit
+     */
+    bool writeStageWork(FrameWriter& w, quint16 stageId, QByteArrayView workFrame, bool binary);
+    void writeGo(FrameWriter& w, quint16 stageId);
+
+    // Config fingerprints
+    enum class ConfigBlock : quint8
+    {
+        LedSet = 0,
+        VoiceSet1,
+        VoiceSet2,
+        BeepSet,
+    };
+    const char* configBlockName(ConfigBlock b);
+
+    /**
+     * @brief CRC-32 of a config block's content (text: frame without CRLF; binary: payload only)
+     * @note Never returns 0, which CFGHASH reserves for "not configured".
+     */
+    quint32 configHash(QByteArrayView content);
+
+    /**
+     * @brief configHash() of a complete frame as produced by the write* functions (host side).
+     */
+    quint32 configFrameHash(QByteArrayView frame, bool binary);
+
+    void writeConfigHashQuery(FrameWriter& w);
+    void writeConfigHashReply(FrameWriter& w, const quint32 (&hashes)[kConfigBlockCount]); ///< device side
+
+    // Sequenced delivery
+    bool writeSequencedFrame(FrameWriter& w, quint16 seq, QByteArrayView frame, bool binary); ///< false: binary payload too long
+
+    struct AckInfo
+    {
+        bool ok = false;
+        bool nak = false;
+        quint16 seq = 0;
+    };
+    AckInfo parseAck(const QString& line);
+
+    // Device side
+    void writeAck(FrameWriter& w, quint16 seq, bool nak);
+    void writeDeviceReport(FrameWriter& w, bool fault, int code, QByteArrayView detail); ///< ERR:/FAULT:
+
+    /**
+     * @brief Unwrap "@<seq>:<body>*<crc>"; returns false if the line is not sequenced.
+     * @param crcOk set to false when the CRC (or the seq field) does not check out
+     */
+    bool unwrapSequencedText(QByteArrayView line, quint16& seq, QByteArrayView& body, bool& crcOk);
+
+    // Device side (firmware simulator): STEPRUN:<step>,<startTimeMs>
+    void writeStepRun(FrameWriter& w, int currentStep, qint64 startTimeMs);
+
     QString packLedConfig(const DeviceProps& dev, const QVector<ColorItem>& colors);
     QString packVoiceConfig1(const VoiceProps& v);
     QString packVoiceConfig2(const VoiceProps& v);
@@ -0,0 +1,167 @@
+#include "runcheckpoint.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+
+namespace RunCheckpoint
+{
+namespace
+{
+constexpr quint32 kMagic = 0x4652434B; // "FRCK" (QDataStream is big-endian)
+constexpr quint16 kVersion = 2; ///< 2: segmentInFlight, Display::actions
+constexpr auto kStreamVersion = QDataStream::Qt_6_5;
+constexpr qint32 kMaxItems = 1 << 20; ///< sanity bound on element counts read back
+
+// Written element by element: ActionItem/ExcelTableRow live in the global namespace, where
+// Qt's container streaming would not find operators declared here.
+void writeAction(QDataStream& s, const ActionItem& a)
+{
+    s << a.flowName << qint32(a.type) << a.rawParamText << qint32(a.delayMs) << qint32(a.beepFreqHz)
+      << qint32(a.beepDurMs) << qint32(a.voiceMs) << a.voiceText << qint32(a.voiceSet) << a.ledMode
+      << a.ledColors << a.markedForRerun;
+}
+
+void readAction(QDataStream& s, ActionItem& a)
+{
+    qint32 type = 0, delayMs = 0, beepFreqHz = 0, beepDurMs = 0, voiceMs = 0, voiceSet = 1;
+    s >> a.flowName >> type >> a.rawParamText >> delayMs >> beepFreqHz >> beepDurMs >> voiceMs >> a.voiceText
+      >> voiceSet >> a.ledMode >> a.ledColors >> a.markedForRerun;
+    a.type = ActionType(type);
+    a.delayMs = delayMs;
+    a.beepFreqHz = beepFreqHz;
+    a.beepDurMs = beepDurMs;
+    a.voiceMs = voiceMs;
+    a.voiceSet = voiceSet;
+}
+
+void writeRow(QDataStream& s, const ExcelTableRow& r)
+{
+    s << r.isHeader << qint32(r.excelRow) << r.flowName << r.cells << r.ledColumns << r.timeColumns;
+}
+
+void readRow(QDataStream& s, ExcelTableRow& r)
+{
+    qint32 excelRow = 0;
+    s >> r.isHeader >> excelRow >> r.flowName >> r.cells >> r.ledColumns >> r.timeColumns;
+    r.excelRow = excelRow;
+}
+
+template <typename T, typename Write>
+void writeList(QDataStream& s, const QVector<T>& items, Write write)
+{
+    s << qint32(items.size());
+    for (const T& item : items)
+        write(s, item);
+}
+
+template <typename T, typename Read>
+void readList(QDataStream& s, QVector<T>& items, Read read)
+{
+    qint32 n = 0;
+    s >> n;
+    if (n < 0 || n > kMaxItems)
+    {
+        s.setStatus(QDataStream::ReadCorruptData);
+        return;
+    }
+    items.resize(n);
+    for (T& item : items)
+    {
+        if (s.status() != QDataStream::Ok)
+            return;
+        read(s, item);
+    }
+}
+} // namespace
+
+QString defaultPath(const QString& tag)
+{
+    const QDir d(QCoreApplication::applicationDirPath());
+    return d.filePath(tag.isEmpty() ? QStringLiteral("logs/checkpoint.ckpt")
+                                    : QStringLiteral("logs/checkpoint_%1.ckpt").arg(tag));
+}
+
+QByteArray encodePlan(const Checkpoint& cp)
+{
+    QByteArray out;
+    QDataStream s(&out, QIODevice::WriteOnly);
+    s.setVersion(kStreamVersion);
+    s << cp.seed << qint32(cp.ledCount) << cp.runLogBase << cp.display.excelPath
+      << qint32(cp.display.tableColumnStart) << qint32(cp.display.tableColumnCount);
+    writeList(s, cp.display.tableRows, writeRow);
+    writeList(s, cp.display.actions, writeAction);
+    writeList(s, cp.actions, writeAction);
+    return out;
+}
+
+QByteArray encode(int currentSegment, bool segmentInFlight, int markedRerunSegment, const QByteArray& plan)
+{
+    QByteArray out;
+    out.reserve(plan.size() + 32);
+    QDataStream s(&out, QIODevice::WriteOnly);
+    s.setVersion(kStreamVersion);
+    s << kMagic << kVersion << qint32(currentSegment) << segmentInFlight << qint32(markedRerunSegment)
+      << quint32(plan.size());
+    out.append(plan);
+    return out;
+}
+
+bool decode(const QByteArray& bytes, Checkpoint& cp, QString& errMsg)
+{
+    QDataStream s(bytes);
+    s.setVersion(kStreamVersion);
+
+    quint32 magic = 0, planSize = 0;
+    quint16 version = 0;
+    qint32 current = -1, rerun = -1;
+    bool inFlight = false;
+    s >> magic >> version;
+    if (s.status() != QDataStream::Ok || magic != kMagic)
+    {
+        errMsg = QStringLiteral("不是断点文件");
+        return false;
+    }
+    if (version != kVersion)
+    {
+        errMsg = QStringLiteral("断点文件版本 %1 不支持").arg(version);
+        return false;
+    }
+    s >> current >> inFlight >> rerun >> planSize;
+    if (s.status() != QDataStream::Ok || qint64(planSize) != bytes.size() - s.device()->pos())
+    {
+        errMsg = QStringLiteral("断点文件不完整");
+        return false;
+    }
+
+    qint32 ledCount = 0, columnStart = 1, columnCount = 0;
+    s >> cp.seed >> ledCount >> cp.runLogBase >> cp.display.excelPath >> columnStart >> columnCount;
+    readList(s, cp.display.tableRows, readRow);
+    readList(s, cp.display.actions, readAction);
+    readList(s, cp.actions, readAction);
+    if (s.status() != QDataStream::Ok)
+    {
+        errMsg = QStringLiteral("断点文件损坏");
+        return false;
+    }
+    cp.ledCount = ledCount;
+    cp.display.tableColumnStart = columnStart;
+    cp.display.tableColumnCount = columnCount;
+    cp.currentSegment = current;
+    cp.segmentInFlight = inFlight;
+    cp.markedRerunSegment = rerun;
+    return true;
+}
+
+bool load(const QString& path, Checkpoint& cp, QString& errMsg)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+    {
+        errMsg = QStringLiteral("%1: %2").arg(path, f.errorString());
+        return false;
+    }
+    return decode(f.readAll(), cp, errMsg);
+}
+} // namespace RunCheckpoint
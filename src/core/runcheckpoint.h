@@ -0,0 +1,65 @@
+#pragma once
+/**
+ * @file runcheckpoint.h
+ * @brief Run 断点：程序崩溃/被关掉后，不重新导入 Excel、不重新解析随机颜色，回到原来的段继续
+ *
+ * 文件（logs/checkpoint[_<tag>].ckpt）= 状态头 + 计划块：
+ * - 计划块每次 Run 固定：已解析颜色的动作列表、RAND 种子、LED 数、Run 日志路径、队列表显示内容，
+ *   loadPlan 时编码一次（encodePlan）
+ * - 状态头：当前段、该段是否仍在执行、重做标记；下发一段、该段执行完（末步 STEPRUN / 自动连播判定完成）、
+ *   标记重做时和计划块一起整体重写（encode）。恢复时仍在执行的段从头再执行一次，不会被跳过
+ *
+ * 写入由 RunLogWriter 的写线程用 QSaveFile 原子替换完成：任何时刻崩溃，文件要么是上一个边界，要么是这一个。
+ * Run 正常结束（无下一段）或重置后删除。
+ */
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "excelimporter.h"
+#include "models.h"
+
+namespace RunCheckpoint
+{
+/**
+ * @brief 恢复队列表所需的显示内容（来自 ExcelImporter，恢复时不再读 Excel）
+ */
+struct Display
+{
+    QString excelPath;
+    QVector<ExcelTableRow> tableRows;
+    QVector<ActionItem> actions;   ///< 队列表显示的完整计划；空 = 与 Checkpoint::actions 相同（Shard 模式下后者只是本治具的段）
+    int tableColumnStart = 1;
+    int tableColumnCount = 0;
+};
+
+struct Checkpoint
+{
+    // 每次 Run 固定
+    QVector<ActionItem> actions;   ///< RandomColorResolver::resolveAll 之后的计划
+    quint32 seed = 0;              ///< WorkflowEngine::planSeed()
+    int ledCount = 0;              ///< 编译计划时的 LED 数（Excel 可覆盖设置页）
+    QString runLogBase;            ///< logs/<ts>[_<tag>]，恢复后续写同一份日志
+    Display display;
+
+    // 段边界更新
+    int currentSegment = -1;       ///< 最近一次下发的段，-1 = 尚未发段
+    bool segmentInFlight = false;  ///< currentSegment 已下发但未确认执行完
+    int markedRerunSegment = -1;   ///< 待重做的段，-1 = 无
+};
+
+/**
+ * @brief 程序目录 logs/checkpoint.ckpt；tag 非空时为 logs/checkpoint_<tag>.ckpt
+ */
+QString defaultPath(const QString& tag = QString());
+
+QByteArray encodePlan(const Checkpoint& cp);
+QByteArray encode(int currentSegment, bool segmentInFlight, int markedRerunSegment, const QByteArray& plan);
+
+/**
+ * @return false 时 errMsg 为原因（格式/版本不符、文件截断）
+ */
+bool decode(const QByteArray& bytes, Checkpoint& cp, QString& errMsg);
+bool load(const QString& path, Checkpoint& cp, QString& errMsg);
+} // namespace RunCheckpoint
@@ -0,0 +1,285 @@
+#include "runlogwriter.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QObject>
+#include <QSaveFile>
+#include <QThread>
+#include <QTimer>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+constexpr qsizetype kMaxBatchBytes = 64 * 1024; ///< 攒批上限，超过即写出（与策略无关）
+constexpr int kBackpressureYields = 64;         ///< 队列满时最多让出 CPU 的次数，之后丢弃
+} // namespace
+
+/**
+ * @brief 运行在 RunLog 线程：取队列、攒批、写文件；QFile 只在这个线程访问
+ */
+class RunLogWorker : public QObject
+{
+public:
+    explicit RunLogWorker(RunLogWriter* owner) : m_owner(owner) {}
+    ~RunLogWorker() override { closeFile(); }
+
+    bool openFile(const QString& path, RunLogWriter::FlushPolicy policy, int intervalMs, bool append, QString& err)
+    {
+        closeFile();
+
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::WriteOnly | (append ? QIODevice::Append : QIODevice::Truncate) | QIODevice::Text))
+        {
+            err = m_file.errorString();
+            return false;
+        }
+
+        m_policy = policy;
+        m_batch.clear();
+        m_batch.reserve(kMaxBatchBytes);
+        m_batchLines = 0;
+
+        if (m_policy == RunLogWriter::FlushPolicy::Timed)
+        {
+            if (!m_timer)
+            {
+                m_timer = new QTimer(this);
+                QObject::connect(m_timer, &QTimer::timeout, this, [this]() {
+                    drain();
+                    writeBatch();
+                });
+            }
+            m_timer->start(qMax(1, intervalMs));
+        }
+        return true;
+    }
+
+    void drain()
+    {
+        m_owner->m_wake.store(false, std::memory_order_release);
+
+        QString line;
+        while (m_owner->m_queue.pop(line))
+        {
+            m_batch += line.toUtf8();
+            m_batch += '\n';
+            ++m_batchLines;
+        }
+        const bool boundary = m_owner->m_boundary.exchange(false, std::memory_order_acq_rel);
+
+        switch (m_policy)
+        {
+        case RunLogWriter::FlushPolicy::PerLine:
+            writeBatch();
+            break;
+        case RunLogWriter::FlushPolicy::Timed:
+            if (m_batch.size() >= kMaxBatchBytes)
+                writeBatch();
+            break;
+        case RunLogWriter::FlushPolicy::SegmentBoundary:
+            if (boundary || m_batch.size() >= kMaxBatchBytes)
+                writeBatch();
+            break;
+        }
+    }
+
+    void syncFile()
+    {
+        if (!m_file.isOpen())
+            return;
+        drain();
+        writeBatch();
+#ifdef Q_OS_WIN
+        ::_commit(m_file.handle());
+#else
+        ::fsync(m_file.handle());
+#endif
+    }
+
+    void closeFile()
+    {
+        if (m_timer)
+            m_timer->stop();
+        if (!m_file.isOpen())
+            return;
+        syncFile();
+        m_file.close();
+    }
+
+private:
+    void writeBatch()
+    {
+        if (m_batch.isEmpty() || !m_file.isOpen())
+            return;
+        m_file.write(m_batch);
+        m_file.flush();
+        m_batch.truncate(0); // keeps capacity
+        m_owner->m_written.fetch_add(m_batchLines, std::memory_order_relaxed);
+        m_owner->m_flushes.fetch_add(1, std::memory_order_relaxed);
+        m_batchLines = 0;
+    }
+
+private:
+    RunLogWriter* m_owner = nullptr;
+    RunLogWriter::FlushPolicy m_policy = RunLogWriter::FlushPolicy::Timed;
+    QFile m_file;
+    QByteArray m_batch;
+    quint64 m_batchLines = 0;
+    QTimer* m_timer = nullptr;
+};
+
+RunLogWriter::RunLogWriter(std::size_t queueCapacity)
+    : m_queue(queueCapacity)
+{
+    m_worker = new RunLogWorker(this);
+    m_thread = new QThread();
+    m_thread->setObjectName(QStringLiteral("RunLog"));
+    m_worker->moveToThread(m_thread);
+    QObject::connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread->start(QThread::LowPriority);
+}
+
+RunLogWriter::~RunLogWriter()
+{
+    close();
+    // Queued side-file jobs (writeFileAtomic/removeFile) run before this returns.
+    QMetaObject::invokeMethod(m_worker, []() {}, Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait(); // worker is deleted via QThread::finished -> deleteLater
+    delete m_thread;
+}
+
+void RunLogWriter::setFlushPolicy(FlushPolicy policy, int intervalMs)
+{
+    m_policy = policy;
+    m_intervalMs = intervalMs;
+}
+
+bool RunLogWriter::open(const QString& path, QString& err, bool append)
+{
+    close();
+
+    m_written.store(0, std::memory_order_relaxed);
+    m_dropped.store(0, std::memory_order_relaxed);
+    m_backpressure.store(0, std::memory_order_relaxed);
+    m_flushes.store(0, std::memory_order_relaxed);
+
+    bool ok = false;
+    const FlushPolicy policy = m_policy;
+    const int intervalMs = m_intervalMs;
+    QMetaObject::invokeMethod(
+        m_worker, [&]() { ok = m_worker->openFile(path, policy, intervalMs, append, err); },
+        Qt::BlockingQueuedConnection);
+    m_open = ok;
+    return ok;
+}
+
+void RunLogWriter::sync()
+{
+    if (!m_open)
+        return;
+    QMetaObject::invokeMethod(m_worker, [this]() { m_worker->syncFile(); }, Qt::BlockingQueuedConnection);
+}
+
+void RunLogWriter::close()
+{
+    if (!m_open)
+        return;
+    m_open = false;
+    QMetaObject::invokeMethod(m_worker, [this]() { m_worker->closeFile(); }, Qt::BlockingQueuedConnection);
+}
+
+void RunLogWriter::append(const QString& line)
+{
+    if (!m_open)
+        return;
+
+    QString item = line;
+    if (!m_queue.push(std::move(item)))
+    {
+        m_backpressure.fetch_add(1, std::memory_order_relaxed);
+        bool queued = false;
+        for (int i = 0; i < kBackpressureYields && !queued; ++i)
+        {
+            wake();
+            QThread::yieldCurrentThread();
+            queued = m_queue.push(std::move(item));
+        }
+        if (!queued)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    wake();
+}
+
+void RunLogWriter::markSegmentBoundary()
+{
+    if (!m_open || m_policy != FlushPolicy::SegmentBoundary)
+        return;
+    m_boundary.store(true, std::memory_order_release);
+    wake();
+}
+
+void RunLogWriter::wake()
+{
+    if (!m_wake.exchange(true, std::memory_order_acq_rel))
+        QMetaObject::invokeMethod(m_worker, [this]() { m_worker->drain(); }, Qt::QueuedConnection);
+}
+
+void RunLogWriter::writeFileAtomic(const QString& path, const QByteArray& bytes)
+{
+    QMetaObject::invokeMethod(
+        m_worker,
+        [path, bytes]() {
+            QSaveFile f(path);
+            if (f.open(QIODevice::WriteOnly) && f.write(bytes) == bytes.size())
+                f.commit();
+        },
+        Qt::QueuedConnection);
+}
+
+void RunLogWriter::removeFile(const QString& path)
+{
+    QMetaObject::invokeMethod(m_worker, [path]() { QFile::remove(path); }, Qt::QueuedConnection);
+}
+
+RunLogWriter::Counters RunLogWriter::counters() const
+{
+    Counters c;
+    c.written = m_written.load(std::memory_order_relaxed);
+    c.dropped = m_dropped.load(std::memory_order_relaxed);
+    c.backpressure = m_backpressure.load(std::memory_order_relaxed);
+    c.flushes = m_flushes.load(std::memory_order_relaxed);
+    return c;
+}
+
+RunLogWriter::FlushPolicy RunLogWriter::policyFromString(const QString& s)
+{
+    const QString key = s.trimmed().toLower();
+    if (key == QLatin1String("line"))
+        return FlushPolicy::PerLine;
+    if (key == QLatin1String("segment"))
+        return FlushPolicy::SegmentBoundary;
+    return FlushPolicy::Timed;
+}
+
+QString RunLogWriter::policyName(FlushPolicy p)
+{
+    switch (p)
+    {
+    case FlushPolicy::PerLine:
+        return QStringLiteral("line");
+    case FlushPolicy::SegmentBoundary:
+        return QStringLiteral("segment");
+    case FlushPolicy::Timed:
+        break;
+    }
+    return QStringLiteral("timed");
+}
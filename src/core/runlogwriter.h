@@ -0,0 +1,117 @@
+#pragma once
+/**
+ * @file runlogwriter.h
+ * @brief Run 日志后台写入：调用方只把行放进 SPSC 环形队列，UTF-8 编码、写文件、flush 都在 "RunLog" 线程完成
+ *
+ * - 刷新策略见 FlushPolicy；sync()/close() 总是写出并 fsync，之后进程崩溃也不会丢已记录的行
+ * - 队列满时 append() 先让出 CPU 等写线程追上（计入 backpressure），仍满则丢弃该行（计入 dropped），
+ *   调用线程不会因为磁盘慢而长时间阻塞
+ * - append()/markSegmentBoundary() 是 SPSC 的生产者端，只能在一个线程调用；open()/sync()/close() 同一线程
+ */
+
+#include <QByteArray>
+#include <QString>
+
+#include <atomic>
+
+#include "../services/spscqueue.h"
+
+class QThread;
+class RunLogWorker;
+
+class RunLogWriter
+{
+public:
+    enum class FlushPolicy
+    {
+        PerLine,          ///< 每次被唤醒就写出并 flush（与旧的逐行 flush 等价，最安全）
+        Timed,            ///< 攒批，每 flushIntervalMs 写出一次
+        SegmentBoundary,  ///< 攒批，在段边界（markSegmentBoundary）写出
+    };
+
+    struct Counters
+    {
+        quint64 written = 0;       ///< 已写出到文件的行数
+        quint64 dropped = 0;       ///< 队列满被丢弃的行数
+        quint64 backpressure = 0;  ///< append 遇到队列满的次数
+        quint64 flushes = 0;       ///< 写出（write + flush）次数
+    };
+
+    explicit RunLogWriter(std::size_t queueCapacity = 4096);
+    ~RunLogWriter();
+
+    RunLogWriter(const RunLogWriter&) = delete;
+    RunLogWriter& operator=(const RunLogWriter&) = delete;
+
+    /**
+     * @brief 下一次 open() 起生效
+     * @param intervalMs Timed 的写出周期；另两种策略忽略
+     */
+    void setFlushPolicy(FlushPolicy policy, int intervalMs);
+    FlushPolicy flushPolicy() const { return m_policy; }
+
+    /**
+     * @brief 打开（截断）日志文件并清零计数；已打开时先 close()
+     * @param append true = 续写已有文件（从断点恢复同一次 Run）
+     */
+    bool open(const QString& path, QString& err, bool append = false);
+
+    /**
+     * @brief 写出队列中的全部行并 fsync，文件保持打开（阻塞到落盘）
+     */
+    void sync();
+
+    /**
+     * @brief sync() 后关闭文件
+     */
+    void close();
+
+    bool isOpen() const { return m_open; }
+
+    /**
+     * @brief 追加一行（不含换行）；QString 隐式共享入队，不做拷贝
+     */
+    void append(const QString& line);
+
+    /**
+     * @brief SegmentBoundary 策略下请求写出已排队的行；其他策略下无作用
+     */
+    void markSegmentBoundary();
+
+    /**
+     * @brief 在写线程上用 QSaveFile 原子替换 path（Run 断点），调用方不等磁盘；与日志文件是否打开无关
+     *
+     * 与 removeFile 按调用顺序执行；析构前排队的都会完成。
+     */
+    void writeFileAtomic(const QString& path, const QByteArray& bytes);
+    void removeFile(const QString& path);
+
+    Counters counters() const;
+
+    /**
+     * @brief "line" / "timed" / "segment"，无法识别时返回 Timed
+     */
+    static FlushPolicy policyFromString(const QString& s);
+    static QString policyName(FlushPolicy p);
+
+private:
+    friend class RunLogWorker;
+
+    void wake();
+
+    SpscQueue<QString> m_queue;
+    std::atomic<bool> m_wake{false};
+    std::atomic<bool> m_boundary{false};
+
+    std::atomic<quint64> m_written{0};
+    std::atomic<quint64> m_dropped{0};
+    std::atomic<quint64> m_backpressure{0};
+    std::atomic<quint64> m_flushes{0};
+
+    FlushPolicy m_policy = FlushPolicy::Timed;
+    int m_intervalMs = 200;
+    bool m_open = false;
+
+    RunLogWorker* m_worker = nullptr;
+    QThread* m_thread = nullptr;
+};
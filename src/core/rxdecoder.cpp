@@ -0,0 +1,249 @@
+#include "rxdecoder.h"
+
+#include <cstring>
+#include <limits>
+
+namespace
+{
+using Protocol::RxKind;
+using Protocol::RxMessage;
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+QByteArrayView trimmed(QByteArrayView v)
+{
+    qsizetype b = 0;
+    qsizetype e = v.size();
+    while (b < e && isSpace(v[b]))
+        ++b;
+    while (e > b && isSpace(v[e - 1]))
+        --e;
+    return v.sliced(b, e - b);
+}
+
+/**
+ * @brief Take the next ','-separated field (trimmed) and advance `rest` past the comma.
+ */
+QByteArrayView takeField(QByteArrayView& rest)
+{
+    const qsizetype comma = rest.indexOf(',');
+    QByteArrayView field;
+    if (comma < 0)
+    {
+        field = rest;
+        rest = QByteArrayView();
+    }
+    else
+    {
+        field = rest.first(comma);
+        rest = rest.sliced(comma + 1);
+    }
+    return trimmed(field);
+}
+
+/**
+ * @brief Whole field must be an optionally signed decimal that fits in qint64.
+ */
+bool parseInt(QByteArrayView f, qint64& out)
+{
+    if (f.isEmpty())
+        return false;
+    qsizetype i = 0;
+    const bool neg = (f[0] == '-');
+    if (neg || f[0] == '+')
+        ++i;
+    if (i == f.size())
+        return false;
+
+    quint64 v = 0;
+    for (; i < f.size(); ++i)
+    {
+        const char c = f[i];
+        if (c < '0' || c > '9')
+            return false;
+        const quint64 d = quint64(c - '0');
+        if (v > (quint64(std::numeric_limits<qint64>::max()) - d) / 10)
+            return false;
+        v = v * 10 + d;
+    }
+    out = neg ? -qint64(v) : qint64(v);
+    return true;
+}
+
+bool equalsIgnoreCase(QByteArrayView a, const char* b)
+{
+    const qsizetype n = qsizetype(std::strlen(b));
+    if (a.size() != n)
+        return false;
+    for (qsizetype i = 0; i < n; ++i)
+    {
+        char c = a[i];
+        if (c >= 'a' && c <= 'z')
+            c = char(c - 'a' + 'A');
+        if (c != b[i])
+            return false;
+    }
+    return true;
+}
+
+bool parseStepRun(QByteArrayView body, RxMessage& m)
+{
+    qint64 step = 0;
+    qint64 ts = 0;
+    if (!parseInt(takeField(body), step) || !parseInt(takeField(body), ts))
+        return false;
+    if (!body.isEmpty())
+        return false; // extra fields: not a report this host understands
+    if (step < std::numeric_limits<int>::min() || step > std::numeric_limits<int>::max())
+        return false;
+    m.step = int(step);
+    m.startTimeMs = ts;
+    return true;
+}
+
+bool parseReport(QByteArrayView body, RxMessage& m)
+{
+    qint64 code = 0;
+    if (!parseInt(takeField(body), code) || code < 0 || code > std::numeric_limits<int>::max())
+        return false;
+    m.code = int(code);
+    m.detail = trimmed(body);
+    return true;
+}
+
+bool parseSeq(QByteArrayView body, RxMessage& m)
+{
+    qint64 seq = 0;
+    if (!parseInt(takeField(body), seq) || seq < 0 || seq > 0xFFFF)
+        return false;
+    m.seq = quint16(seq);
+    return true;
+}
+
+bool parseVersion(QByteArrayView body, RxMessage& m)
+{
+    qint64 version = 0;
+    QByteArrayView field = takeField(body);
+    while (field.isEmpty() && !body.isEmpty()) // tolerate "VER:,2"
+        field = takeField(body);
+    if (!parseInt(field, version) || version < 0 || version > std::numeric_limits<int>::max())
+        return false;
+    m.version = int(version);
+    while (!body.isEmpty())
+    {
+        const QByteArrayView feature = takeField(body);
+        if (equalsIgnoreCase(feature, "BIN"))
+            m.binary = true;
+        else if (equalsIgnoreCase(feature, "SEQ"))
+            m.sequenced = true;
+        else if (equalsIgnoreCase(feature, "DICT"))
+            m.dictionary = true;
+        else if (equalsIgnoreCase(feature, "STAGE"))
+            m.staging = true;
+    }
+    return true;
+}
+
+bool parseHex32(QByteArrayView f, quint32& out)
+{
+    if (f.isEmpty() || f.size() > 8)
+        return false;
+    quint32 v = 0;
+    for (char c : f)
+    {
+        int d = -1;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        if (d < 0)
+            return false;
+        v = (v << 4) | quint32(d);
+    }
+    out = v;
+    return true;
+}
+
+bool parseConfigHash(QByteArrayView body, RxMessage& m)
+{
+    for (quint32& h : m.configHashes)
+    {
+        if (!parseHex32(takeField(body), h))
+            return false;
+    }
+    return true;
+}
+
+struct RxRoute
+{
+    QByteArrayView prefix;
+    RxKind kind;
+    bool (*parse)(QByteArrayView body, RxMessage& m);
+};
+
+// Ordered by expected frequency: progress reports dominate the stream.
+const RxRoute kRoutes[] = {
+    {"STEPRUN:", RxKind::StepRun, parseStepRun},
+    {"ACK:",     RxKind::Ack,     parseSeq},
+    {"NAK:",     RxKind::Nak,     parseSeq},
+    {"ERR:",     RxKind::Error,   parseReport},
+    {"FAULT:",   RxKind::Fault,   parseReport},
+    {"VER:",     RxKind::Version, parseVersion},
+    {"CFGHASH:", RxKind::ConfigHash, parseConfigHash},
+    {"SETPRUN:", RxKind::StepRun, parseStepRun},
+};
+} // namespace
+
+namespace Protocol
+{
+const char* rxKindName(RxKind kind)
+{
+    switch (kind)
+    {
+    case RxKind::StepRun: return "STEPRUN";
+    case RxKind::Error:   return "ERR";
+    case RxKind::Fault:   return "FAULT";
+    case RxKind::Ack:     return "ACK";
+    case RxKind::Nak:     return "NAK";
+    case RxKind::Version: return "VER";
+    case RxKind::ConfigHash: return "CFGHASH";
+    case RxKind::Unknown:
+    case RxKind::Count:   break;
+    }
+    return "UNKNOWN";
+}
+
+RxKind decodeRx(QByteArrayView line, RxMessage& msg)
+{
+    msg = RxMessage();
+    msg.line = trimmed(line);
+
+    for (const RxRoute& r : kRoutes)
+    {
+        if (!msg.line.startsWith(r.prefix))
+            continue;
+        if (r.parse(msg.line.sliced(r.prefix.size()), msg))
+            msg.kind = r.kind;
+        break;
+    }
+    return msg.kind;
+}
+
+void RxDispatcher::setHandler(RxKind kind, Handler handler)
+{
+    Q_ASSERT(kind != RxKind::Count);
+    m_handlers[size_t(kind)] = std::move(handler);
+}
+
+RxKind RxDispatcher::dispatch(QByteArrayView line, qint64 hostNs) const
+{
+    RxMessage msg;
+    const RxKind kind = decodeRx(line, msg);
+    const Handler& h = m_handlers[size_t(kind)];
+    if (h)
+        h(msg, hostNs);
+    return kind;
+}
+} // namespace Protocol
@@ -0,0 +1,99 @@
+#pragma once
+/**
+ * @file rxdecoder.h
+ * @brief Allocation-free decoder for device reports plus a prefix-keyed dispatch table.
+ *
+ * Lines are decoded straight from the RX bytes: fields are sliced as views and
+ * integers are parsed in place, so nothing is allocated per line. Recognised reports:
+ * - STEPRUN:<step>,<startTimeMs>   (SETPRUN: is accepted as an alias, as in the original spec;
+ *                                   lines with further fields are rejected as Unknown)
+ * - ERR:<code>[,<detail>]          action failed on the device
+ * - FAULT:<code>[,<detail>]        device-level fault (e.g. driver, power)
+ * - ACK:<seq> / NAK:<seq>          sequenced delivery, see protocol.h
+ * - VER:<version>[,BIN][,SEQ][,DICT][,STAGE]
+ *                                  handshake reply; features in any order, case-insensitive,
+ *                                  unknown features are ignored
+ * - CFGHASH:<h1>,<h2>,<h3>,<h4>    config fingerprints, hex (order of Protocol::ConfigBlock)
+ *
+ * Views in RxMessage point into the decoded line and are only valid during dispatch.
+ */
+
+#include <QByteArrayView>
+#include <QtGlobal>
+
+#include <array>
+#include <functional>
+
+namespace Protocol
+{
+    enum class RxKind : quint8
+    {
+        Unknown = 0,
+        StepRun,
+        Error,
+        Fault,
+        Ack,
+        Nak,
+        Version,
+        ConfigHash,
+        Count
+    };
+
+    const char* rxKindName(RxKind kind);
+
+    constexpr int kConfigBlockCount = 4; ///< LEDSET, VOICESET1, VOICESET2, BEEPSET
+
+    struct RxMessage
+    {
+        RxKind kind = RxKind::Unknown;
+        QByteArrayView line;        ///< whole line, whitespace trimmed
+
+        // StepRun
+        int step = -1;
+        qint64 startTimeMs = 0;
+
+        // Error / Fault
+        int code = 0;
+        QByteArrayView detail;
+
+        // Ack / Nak
+        quint16 seq = 0;
+
+        // Version
+        int version = 0;
+        bool binary = false;
+        bool sequenced = false;
+        bool dictionary = false;
+        bool staging = false;
+
+        // ConfigHash (0 = block never configured)
+        quint32 configHashes[kConfigBlockCount] = {};
+    };
+
+    /**
+     * @brief Decode one line; returns RxKind::Unknown when no prefix matches or a field is malformed.
+     */
+    RxKind decodeRx(QByteArrayView line, RxMessage& msg);
+
+    /**
+     * @brief Routes decoded messages to one handler per kind.
+     */
+    class RxDispatcher
+    {
+    public:
+        using Handler = std::function<void(const RxMessage& msg, qint64 hostNs)>;
+
+        /**
+         * @brief Handler for `kind`; RxKind::Unknown receives everything that did not decode.
+         */
+        void setHandler(RxKind kind, Handler handler);
+
+        /**
+         * @brief Decode and route `line`; returns the decoded kind (handled or not).
+         */
+        RxKind dispatch(QByteArrayView line, qint64 hostNs) const;
+
+    private:
+        std::array<Handler, size_t(RxKind::Count)> m_handlers;
+    };
+}
@@ -0,0 +1,140 @@
+#include "spacedhex.h"
+
+#if defined(__SSSE3__)
+    #include <tmmintrin.h>
+    #define FIRST1_SPACEDHEX_SSSE3 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define FIRST1_SPACEDHEX_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define FIRST1_SPACEDHEX_NEON 1
+#endif
+
+namespace
+{
+const char kHexDigits[] = "0123456789ABCDEF";
+
+constexpr qsizetype kBlock = 16;
+
+/**
+ * @brief Scalar tail: bytes [from, n) where `from` > 0 means a space goes before each.
+ */
+void encodeTail(const unsigned char* src, qsizetype from, qsizetype n, char* out)
+{
+    for (qsizetype i = from; i < n; ++i)
+    {
+        if (i > 0)
+            *out++ = ' ';
+        *out++ = kHexDigits[src[i] >> 4];
+        *out++ = kHexDigits[src[i] & 0x0F];
+    }
+}
+
+#if defined(FIRST1_SPACEDHEX_SSSE3) || defined(FIRST1_SPACEDHEX_SSE2)
+// 0..15 -> '0'..'9','A'..'F': add '0', plus 7 more for nibbles above 9.
+inline __m128i nibbleToAscii(__m128i nib)
+{
+    const __m128i gt9 = _mm_cmpgt_epi8(nib, _mm_set1_epi8(9));
+    return _mm_add_epi8(_mm_add_epi8(nib, _mm_set1_epi8('0')), _mm_and_si128(gt9, _mm_set1_epi8(7)));
+}
+
+inline void splitNibbles(const unsigned char* src, __m128i& hi, __m128i& lo)
+{
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    hi = nibbleToAscii(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+    lo = nibbleToAscii(_mm_and_si128(v, mask));
+}
+#endif
+
+#if defined(FIRST1_SPACEDHEX_SSSE3)
+// 8 "HL" pairs (16 bytes) -> 24 bytes "HL HL ... HL " as a 16-byte and an 8-byte store.
+inline void storeTriplets(__m128i pairs, char* out)
+{
+    const char z = char(0x80); // PSHUFB: zero this lane
+    const __m128i shufA = _mm_setr_epi8(0, 1, z, 2, 3, z, 4, 5, z, 6, 7, z, 8, 9, z, 10);
+    const __m128i spaceA = _mm_setr_epi8(0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0);
+    const __m128i shufB = _mm_setr_epi8(11, z, 12, 13, z, 14, 15, z, z, z, z, z, z, z, z, z);
+    const __m128i spaceB = _mm_setr_epi8(0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, 0, 0, 0, 0, 0, 0);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(_mm_shuffle_epi8(pairs, shufA), spaceA));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), _mm_or_si128(_mm_shuffle_epi8(pairs, shufB), spaceB));
+}
+#endif
+} // namespace
+
+namespace Protocol
+{
+void encodeSpacedHexScalar(const char* src, qsizetype n, char* out)
+{
+    encodeTail(reinterpret_cast<const unsigned char*>(src), 0, n, out);
+}
+
+void encodeSpacedHex(const char* src, qsizetype n, char* out)
+{
+    const auto* s = reinterpret_cast<const unsigned char*>(src);
+    qsizetype i = 0;
+
+    // Each block writes 48 bytes ending in a space, so only run it while at least one
+    // byte remains after the block; the tail then writes exactly 3n - 1 bytes in total.
+#if defined(FIRST1_SPACEDHEX_SSSE3)
+    for (; i + kBlock < n; i += kBlock)
+    {
+        __m128i hi, lo;
+        splitNibbles(s + i, hi, lo);
+        char* o = out + i * 3;
+        storeTriplets(_mm_unpacklo_epi8(hi, lo), o);
+        storeTriplets(_mm_unpackhi_epi8(hi, lo), o + 24);
+    }
+#elif defined(FIRST1_SPACEDHEX_SSE2)
+    alignas(16) char h[kBlock];
+    alignas(16) char l[kBlock];
+    for (; i + kBlock < n; i += kBlock)
+    {
+        __m128i hi, lo;
+        splitNibbles(s + i, hi, lo);
+        _mm_store_si128(reinterpret_cast<__m128i*>(h), hi);
+        _mm_store_si128(reinterpret_cast<__m128i*>(l), lo);
+        char* o = out + i * 3;
+        for (int k = 0; k < kBlock; ++k, o += 3)
+        {
+            o[0] = h[k];
+            o[1] = l[k];
+            o[2] = ' ';
+        }
+    }
+#elif defined(FIRST1_SPACEDHEX_NEON)
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+    const uint8x16_t nine = vdupq_n_u8(9);
+    const uint8x16_t zero = vdupq_n_u8('0');
+    const uint8x16_t seven = vdupq_n_u8(7);
+    for (; i + kBlock < n; i += kBlock)
+    {
+        const uint8x16_t v = vld1q_u8(s + i);
+        const uint8x16_t hn = vshrq_n_u8(v, 4);
+        const uint8x16_t ln = vandq_u8(v, mask);
+        uint8x16x3_t t;
+        t.val[0] = vaddq_u8(vaddq_u8(hn, zero), vandq_u8(vcgtq_u8(hn, nine), seven));
+        t.val[1] = vaddq_u8(vaddq_u8(ln, zero), vandq_u8(vcgtq_u8(ln, nine), seven));
+        t.val[2] = vdupq_n_u8(' ');
+        vst3q_u8(reinterpret_cast<uint8_t*>(out + i * 3), t);
+    }
+#endif
+
+    encodeTail(s, i, n, out + (i > 0 ? i * 3 - 1 : 0));
+}
+
+const char* spacedHexImplementation()
+{
+#if defined(FIRST1_SPACEDHEX_SSSE3)
+    return "ssse3";
+#elif defined(FIRST1_SPACEDHEX_SSE2)
+    return "sse2";
+#elif defined(FIRST1_SPACEDHEX_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+} // namespace Protocol
@@ -0,0 +1,33 @@
+#pragma once
+/**
+ * @file spacedhex.h
+ * @brief Space-separated uppercase hex ("D6 D0 CE C4") for VOICE payloads, one pass, no allocation.
+ *
+ * encodeSpacedHex() picks the widest implementation the build targets:
+ * - x86 SSSE3: nibbles -> ASCII and the "HL " interleave with PSHUFB, 16 bytes per step
+ * - x86 SSE2:  nibbles -> ASCII vectorized, interleave with scalar stores
+ * - ARM NEON:  nibbles -> ASCII vectorized, interleave with VST3 (48 output bytes per store)
+ * - otherwise: scalar table lookup
+ * All paths produce identical output; the scalar one is always available for comparison.
+ */
+
+#include <QtGlobal>
+
+namespace Protocol
+{
+    /**
+     * @brief Output size for n input bytes (3n - 1, 0 for n == 0).
+     */
+    constexpr qsizetype spacedHexSize(qsizetype n) { return n > 0 ? n * 3 - 1 : 0; }
+
+    /**
+     * @brief Write spacedHexSize(n) bytes to `out` (no terminator).
+     */
+    void encodeSpacedHex(const char* src, qsizetype n, char* out);
+    void encodeSpacedHexScalar(const char* src, qsizetype n, char* out);
+
+    /**
+     * @brief Name of the implementation encodeSpacedHex() uses ("ssse3", "sse2", "neon", "scalar").
+     */
+    const char* spacedHexImplementation();
+}
@@ -1,44 +1,547 @@
 #include "workflowengine.h"
 
+#include "../services/framesequencer.h"
 #include "../services/serialservice.h"
+#include "hostclock.h"
 #include "protocol.h"
 
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
+#include <QFile>
 #include <QHash>
+#include <QRandomGenerator>
+#include <QStringList>
+
+#include <limits>
 
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
     #include <QStringConverter>
 #endif
 
+namespace
+{
+constexpr int kHandshakeTimeoutMs = 500;
+constexpr int kConfigHashTimeoutMs = 300;
+constexpr quint64 kMaxUnknownRxLogged = 20; ///< per run
+
+// Autoplay fallback when STEPRUNs go missing: the remaining steps' nominal duration
+// x factor + slack (covers TX time, voice engines slower than nominal, host jitter).
+constexpr double kCompletionFallbackFactor = 1.5;
+constexpr int kCompletionFallbackSlackMs = 2000;
+constexpr int kMaxAutoplayReruns = 3; ///< same segment failing more often stops autoplay
+}
+
 WorkflowEngine::WorkflowEngine(QObject* parent)
     : QObject(parent)
 {
+    m_handshakeTimer.setSingleShot(true);
+    m_handshakeTimer.setInterval(kHandshakeTimeoutMs);
+    connect(&m_handshakeTimer, &QTimer::timeout, this, &WorkflowEngine::onHandshakeTimeout);
+
+    m_cfgQueryTimer.setSingleShot(true);
+    m_cfgQueryTimer.setInterval(kConfigHashTimeoutMs);
+    connect(&m_cfgQueryTimer, &QTimer::timeout, this, &WorkflowEngine::onConfigHashTimeout);
+
+    m_autoNextTimer.setSingleShot(true);
+    m_autoNextTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_autoNextTimer, &QTimer::timeout, this, &WorkflowEngine::onAutoplayNext);
+    m_completionTimer.setSingleShot(true);
+    connect(&m_completionTimer, &QTimer::timeout, this, &WorkflowEngine::onCompletionTimeout);
+
+    m_sequencer = new FrameSequencer(this);
+    connect(m_sequencer, &FrameSequencer::transmitted, this, &WorkflowEngine::onTxCompleted);
+    connect(m_sequencer, &FrameSequencer::delivered, this, &WorkflowEngine::onFrameDelivered);
+    connect(m_sequencer, &FrameSequencer::failed, this, &WorkflowEngine::onFrameFailed);
+    connect(m_sequencer, &FrameSequencer::retransmitted, this, [this](quint64 ticket, int attempt) {
+        logStructured(RunLog::Direction::Tx, RunLog::Type::Error, m_unackedWork.value(ticket, -1),
+                      QStringLiteral("Retransmit ticket=%1 attempt=%2").arg(ticket).arg(attempt + 1));
+    });
+    connect(m_sequencer, &FrameSequencer::resyncRequired, this, &WorkflowEngine::startHandshake);
+
+    setupRxRoutes();
+}
+
+void WorkflowEngine::setAckOptions(int window, int timeoutMs, int maxRetries)
+{
+    m_ackWindow = qMax(0, window);
+    m_sequencer->setWindow(qMax(1, m_ackWindow));
+    m_sequencer->setTimeoutMs(timeoutMs);
+    m_sequencer->setMaxRetries(maxRetries);
+    if (m_ackWindow == 0)
+        m_sequencer->setEnabled(false);
+}
+
+bool WorkflowEngine::isSequenced() const
+{
+    return m_sequencer->isEnabled();
 }
 
 void WorkflowEngine::setSerialService(SerialService* s)
 {
+    if (m_serial)
+        disconnect(m_serial, nullptr, this, nullptr);
     m_serial = s;
+    m_sequencer->setSerialService(s);
+    if (m_serial)
+        connect(m_serial, &SerialService::opened, this, &WorkflowEngine::onSerialOpened);
+}
+
+void WorkflowEngine::onSerialOpened(bool ok)
+{
+    // Every session starts in plain text mode; binary/sequenced only after the device says so.
+    m_binaryMode = false;
+    m_dictionaryMode = false;
+    m_prefetchMode = false;
+    m_voiceDefsSent = false;
+    invalidateStaged();
+    m_handshakeTimer.stop();
+    m_sequencer->setEnabled(false);
+    m_sequencer->reset(QStringLiteral("串口重新打开"));
+
+    // Possibly a different (or power-cycled) device: ask again before trusting any fingerprint.
+    m_cfgQueryTimer.stop();
+    m_cfgHashSupport = CfgHashSupport::Unknown;
+    m_configsPending = false;
+    invalidateConfigCache();
+    if (!ok || (!m_preferBinary && !m_preferDictionary && !m_preferPrefetch && m_ackWindow == 0))
+        return;
+
+    startHandshake();
+}
+
+void WorkflowEngine::startHandshake()
+{
+    if (!m_serial || !m_serial->isOpen())
+        return;
+
+    invalidateConfigCache(); // resync: frames in flight may or may not have been applied
+    m_voiceDefsSent = false; // VER? clears the device's phrase table...
+    invalidateStaged();      // ...and its staging buffer
+
+    // VER? also resets the device's expected sequence number to 1.
+    m_txWriter.clear();
+    Protocol::writeVersionQuery(m_txWriter);
+    m_serial->sendBytes(m_txWriter.bytes());
+    m_handshakeTimer.start();
+}
+
+void WorkflowEngine::onHandshakeTimeout()
+{
+    logStructured(RunLog::Direction::Rx, RunLog::Type::Config, -1,
+                  QStringLiteral("No VER reply, using text protocol"));
+    m_binaryMode = false;
+    m_dictionaryMode = false;
+    m_prefetchMode = false;
+    m_sequencer->setEnabled(false);
+    emit protocolNegotiated(0, false, false);
+}
+
+void WorkflowEngine::finishSegmentActions(int segmentIndex, bool ok, const QString& msg)
+{
+    if (segmentIndex < 0 || segmentIndex >= m_segments.size())
+        return;
+    const Segment& seg = m_segments[segmentIndex];
+    for (int i = seg.startIndex; i <= seg.endIndex; ++i)
+        emit actionFinished(i, ok, ok ? 0 : 1, msg);
+}
+
+void WorkflowEngine::onFrameDelivered(quint64 ticket)
+{
+    const auto it = m_unackedWork.constFind(ticket);
+    if (it == m_unackedWork.constEnd())
+        return;
+    const int idx = it.value();
+    m_unackedWork.erase(it);
+    finishSegmentActions(idx, true, QStringLiteral("OK"));
+}
+
+void WorkflowEngine::onFrameFailed(quint64 ticket, const QString& reason)
+{
+    int idx = -1;
+    const auto it = m_unackedWork.constFind(ticket);
+    if (it != m_unackedWork.constEnd())
+    {
+        idx = it.value();
+        m_unackedWork.erase(it);
+    }
+    logStructured(RunLog::Direction::Tx, RunLog::Type::Error, idx,
+                  QStringLiteral("Frame ticket=%1 not acknowledged: %2").arg(ticket).arg(reason));
+    invalidateConfigCache(); // could have been a config block
+    m_voiceDefsSent = false; // ...or a VOICEDEF
+    invalidateStaged();      // ...or a STAGE
+    if (idx < 0)
+        return;
+
+    finishSegmentActions(idx, false, reason);
+    markSegmentForRerun(idx);
+    if (idx == m_awaitSegment)
+        completeSegment(false); // never delivered: autoplay resends it (rerun) after the resync
 }
 
 void WorkflowEngine::beginRun()
 {
+    finishRun();
+    m_latency.reset();
+    m_latencyDirty = false;
     startNewRunLog();
 }
 
-void WorkflowEngine::loadPlan(const QVector<ActionItem>& actions)
+void WorkflowEngine::finishRun()
+{
+    if (m_clock.acceptedTotal() != m_clockReportedSamples)
+    {
+        m_clockReportedSamples = m_clock.acceptedTotal();
+        logStructured(RunLog::Direction::Rx, RunLog::Type::Config, -1,
+                      QStringLiteral("Clock fit samples=%1 rejected=%2 resets=%3 skewPpm=%4 errorMs=%5")
+                          .arg(m_clock.acceptedTotal())
+                          .arg(m_clock.rejectedTotal())
+                          .arg(m_clock.resets())
+                          .arg(m_clock.skewPpm(), 0, 'f', 2)
+                          .arg(m_clock.errorMs(), 0, 'f', 2));
+        if (m_timingAnomalies > 0)
+            logStructured(RunLog::Direction::Rx, RunLog::Type::Work, -1,
+                          QStringLiteral("Timing anomalies this run: %1 (tolerance %2% + %3 ms)")
+                              .arg(m_timingAnomalies)
+                              .arg(m_timingTolerancePct)
+                              .arg(m_timingSlackMs));
+    }
+
+    m_binLog.sync();
+    if (m_runLog.isOpen())
+    {
+        m_runLog.sync();
+        const RunLogWriter::Counters c = m_runLog.counters();
+        if (c.dropped > 0 || c.backpressure > 0)
+            emit logLine(QStringLiteral("运行日志：已写 %1 行，队列满 %2 次，丢弃 %3 行")
+                             .arg(c.written)
+                             .arg(c.backpressure)
+                             .arg(c.dropped));
+    }
+
+    if (!m_latencyDirty || m_runLogBase.isEmpty())
+        return;
+    m_latencyDirty = false;
+
+    QString err;
+    const QString csvPath = m_runLogBase + QStringLiteral(".latency.csv");
+    const QString jsonPath = m_runLogBase + QStringLiteral(".latency.json");
+    if (!m_latency.exportCsv(csvPath, err) || !m_latency.exportJson(jsonPath, err))
+    {
+        emit logLine(QStringLiteral("延迟统计导出失败：%1").arg(err));
+        return;
+    }
+
+    const LatencyHistogram& e2e = m_latency.histogram(LatencyStats::TriggerToFirstStep);
+    emit logLine(QStringLiteral("延迟统计已导出：%1（trigger→STEPRUN n=%2 p50=%3us p99=%4us）")
+                     .arg(csvPath)
+                     .arg(e2e.count())
+                     .arg(e2e.valueAtPercentile(50.0) / 1000)
+                     .arg(e2e.valueAtPercentile(99.0) / 1000));
+}
+
+void WorkflowEngine::noteTrigger(qint64 hostNs)
+{
+    m_pendingTriggerNs = (hostNs > 0) ? hostNs : HostClock::nowNs();
+}
+
+void WorkflowEngine::loadPlan(const QVector<ActionItem>& actions, quint32 seed)
+{
+    installPlan(actions, seed ? seed : QRandomGenerator::global()->generate());
+    sendVoiceDefs(); // off the Next hot path
+    writeCheckpoint();
+}
+
+void WorkflowEngine::installPlan(const QVector<ActionItem>& actions, quint32 seed)
 {
     m_actions = actions;
+    m_planSeed = seed;
     rebuildSegments();
+    compilePlan();
     resetRun();
+
+    m_checkpointPlan.clear();
+    if (m_checkpointPath.isEmpty())
+        return;
+    RunCheckpoint::Checkpoint cp;
+    cp.actions = m_actions;
+    cp.seed = m_planSeed;
+    cp.ledCount = m_device.ledCount;
+    cp.runLogBase = m_runLogBase;
+    cp.display = m_checkpointDisplay;
+    m_checkpointPlan = RunCheckpoint::encodePlan(cp); // fixed for the run; boundaries only rewrite the state head
+}
+
+bool WorkflowEngine::resumeRun(const RunCheckpoint::Checkpoint& cp, QString& errMsg)
+{
+    // Same grouping as rebuildSegments, checked before anything is touched.
+    int segments = cp.actions.isEmpty() ? 0 : 1;
+    for (int i = 1; i < cp.actions.size(); ++i)
+    {
+        if (cp.actions[i].flowName != cp.actions[i - 1].flowName)
+            ++segments;
+    }
+    if (segments == 0)
+    {
+        errMsg = QStringLiteral("断点中没有计划");
+        return false;
+    }
+    if (cp.currentSegment < -1 || cp.currentSegment >= segments || cp.markedRerunSegment < -1
+        || cp.markedRerunSegment >= segments)
+    {
+        errMsg = QStringLiteral("断点中的段号与计划不符");
+        return false;
+    }
+
+    finishRun();
+    m_latency.reset();
+    m_latencyDirty = false;
+    startNewRunLog(cp.runLogBase);
+
+    if (cp.ledCount > 0)
+        m_device.ledCount = cp.ledCount;
+    m_checkpointDisplay = cp.display;
+    installPlan(cp.actions, cp.seed); // same seed + same resolved colours = same frames
+    // A segment that was still executing never finished: step back so it is sent again.
+    m_currentSegmentIndex = (cp.segmentInFlight && cp.currentSegment >= 0) ? cp.currentSegment - 1 : cp.currentSegment;
+    m_markedRerunSegment = cp.markedRerunSegment;
+
+    logStructured(RunLog::Direction::Tx, RunLog::Type::Config, cp.currentSegment,
+                  QStringLiteral("Run resumed from checkpoint segment=%1 inFlight=%2 rerun=%3 seed=%4")
+                      .arg(cp.currentSegment)
+                      .arg(cp.segmentInFlight ? 1 : 0)
+                      .arg(cp.markedRerunSegment)
+                      .arg(m_planSeed));
+    writeCheckpoint();
+    return true;
+}
+
+void WorkflowEngine::writeCheckpoint()
+{
+    if (m_checkpointPath.isEmpty() || m_checkpointPlan.isEmpty())
+        return;
+    // Encoded here (a few KB copy); the file is replaced on the RunLog thread.
+    m_runLog.writeFileAtomic(m_checkpointPath,
+                             RunCheckpoint::encode(m_currentSegmentIndex, m_segmentInFlight, m_markedRerunSegment,
+                                                   m_checkpointPlan));
+}
+
+void WorkflowEngine::noteSegmentDone()
+{
+    if (!m_segmentInFlight)
+        return;
+    m_segmentInFlight = false;
+    writeCheckpoint(); // a crash from here on resumes with the next segment
+}
+
+void WorkflowEngine::discardCheckpoint()
+{
+    m_checkpointPlan.clear();
+    if (!m_checkpointPath.isEmpty())
+        m_runLog.removeFile(m_checkpointPath);
+}
+
+void WorkflowEngine::compilePlan()
+{
+    QRandomGenerator rng(m_planSeed);
+    m_compiledBinary = m_binaryMode;
+    m_compiledDictionary = m_dictionaryMode;
+    m_planArena.clear();
+    m_compiled.clear();
+    m_compiled.reserve(m_segments.size());
+    m_compiledDefs.clear();
+    m_voiceDefsSent = false;
+    invalidateStaged();
+
+    // Phrase dictionary: VOICEDEF frames go first in the arena, WORK frames reference them by id.
+    if (m_compiledDictionary)
+        m_voiceDict.build(m_actions.constData(), m_actions.size());
+    else
+        m_voiceDict.clear();
+    const Protocol::VoiceDictionary* dict = m_voiceDict.isEmpty() ? nullptr : &m_voiceDict;
+    for (int id = 1; id <= m_voiceDict.size(); ++id)
+    {
+        m_txWriter.clear();
+        CompiledFrame f;
+        f.binary = m_compiledBinary && Protocol::writeVoiceDefBinary(m_txWriter, id, m_voiceDict.textFor(id));
+        if (!f.binary)
+            Protocol::writeVoiceDef(m_txWriter, id, m_voiceDict.textFor(id));
+
+        f.offset = m_planArena.size();
+        f.size = m_txWriter.size();
+        m_planArena.append(m_txWriter.bytes());
+        m_compiledDefs.push_back(f);
+    }
+    const qsizetype defBytes = m_planArena.size();
+    int textFallbacks = 0;
+
+    for (const Segment& seg : m_segments)
+    {
+        const ActionItem* segActions = m_actions.constData() + seg.startIndex;
+        const qsizetype segCount = seg.endIndex - seg.startIndex + 1;
+        m_txWriter.clear();
+        CompiledFrame f;
+        if (m_compiledBinary)
+        {
+            const QRandomGenerator rngBefore = rng; // the text frame must draw the same RAND orders
+            f.binary = Protocol::writeWorkBinary(m_txWriter, segActions, segCount, m_device, &rng, dict);
+            if (!f.binary)
+            {
+                rng = rngBefore;
+                ++textFallbacks;
+                logStructured(RunLog::Direction::Tx, RunLog::Type::Error, int(m_compiled.size()),
+                              QStringLiteral("Segment %1 exceeds the binary frame length, sent as text WORK").arg(seg.name));
+            }
+        }
+        if (!f.binary)
+            Protocol::writeWork(m_txWriter, segActions, segCount, m_device, &rng, dict);
+
+        f.offset = m_planArena.size();
+        f.size = m_txWriter.size();
+        m_planArena.append(m_txWriter.bytes());
+        m_compiled.push_back(f);
+    }
+    m_planDirty = false;
+    predictPlanTiming();
+
+    qint64 predictedTotalMs = 0;
+    for (const QVector<qint64>& steps : m_predictedStepMs)
+        for (qint64 ms : steps)
+            predictedTotalMs += ms;
+
+    logStructured(RunLog::Direction::Tx, RunLog::Type::Config, -1,
+                  QStringLiteral("Plan compiled segments=%1 bytes=%2 seed=%3 %4 voiceDefs=%5 (%6 bytes) predictedMs=%7 textFallbacks=%8")
+                      .arg(m_compiled.size())
+                      .arg(m_planArena.size() - defBytes)
+                      .arg(m_planSeed)
+                      .arg(m_compiledBinary ? QStringLiteral("BIN") : QStringLiteral("TEXT"))
+                      .arg(m_compiledDefs.size())
+                      .arg(defBytes)
+                      .arg(predictedTotalMs)
+                      .arg(textFallbacks));
+}
+
+void WorkflowEngine::setVoiceSets(const VoiceProps& v1, const VoiceProps& v2)
+{
+    m_voice1 = v1;
+    m_voice2 = v2;
+    predictPlanTiming(); // speech rate feeds the VOICE predictions; the WORK frames are unaffected
+}
+
+void WorkflowEngine::applyRunSettings(const SettingsData& s)
+{
+    setDeviceProps(s.device);
+    setColors(s.colors);
+    setVoiceSets(s.voice1, s.voice2);
+    setAutoplayGapMs(s.run.autoplayGapMs);
+    setTimingTolerance(s.run.timingTolerancePct, s.run.timingSlackMs);
+    setLogFlushPolicy(RunLogWriter::policyFromString(s.run.logFlush), s.run.logFlushIntervalMs);
+    const QString logFormat = s.run.logFormat.trimmed().toLower();
+    setRunLogFormats(logFormat != QLatin1String("binary"), logFormat != QLatin1String("text"));
+}
+
+void WorkflowEngine::applySerialSettings(const SerialConfig& s)
+{
+    setPreferBinary(s.binaryFraming);
+    setPreferVoiceDictionary(s.voiceDictionary);
+    setPreferPrefetch(s.prefetch);
+    setAckOptions(s.ackWindow, s.ackTimeoutMs, s.ackRetries);
+}
+
+void WorkflowEngine::predictPlanTiming()
+{
+    m_predictedStepMs.clear();
+    m_predictedStepMs.reserve(m_segments.size());
+    for (const Segment& seg : m_segments)
+    {
+        QVector<qint64> steps;
+        for (int i = seg.startIndex; i <= seg.endIndex; ++i)
+        {
+            if (m_actions[i].type != ActionType::Unknown) // one STEPRUN per action the frame carries
+                steps.push_back(predictActionMs(m_actions[i]));
+        }
+        m_predictedStepMs.push_back(steps);
+    }
+}
+
+const QVector<qint64>& WorkflowEngine::predictedStepMs(int segmentIndex) const
+{
+    static const QVector<qint64> kNone;
+    if (segmentIndex < 0 || segmentIndex >= m_predictedStepMs.size())
+        return kNone;
+    return m_predictedStepMs[segmentIndex];
+}
+
+void WorkflowEngine::checkStepTiming(const Protocol::RxMessage& m, qint64 rxNs, int prevStep, qint64 prevStartMs)
+{
+    const int seg = m_currentSegmentIndex;
+    const QVector<qint64>& predicted = predictedStepMs(seg);
+    if (predicted.isEmpty())
+        return;
+
+    // The previous step ended when this one started: both are device timestamps.
+    if (m.step >= 2 && m.step == prevStep + 1 && prevStartMs >= 0)
+        flagIfSlow(seg, prevStep, predicted.value(prevStep - 1, -1), m.startTimeMs - prevStartMs);
+
+    // The last step has no successor; it ended when its report was sent.
+    if (m.step == predicted.size() && m_clock.isValid())
+        flagIfSlow(seg, m.step, predicted.value(m.step - 1, -1), m_clock.deviceMsAt(rxNs) - m.startTimeMs);
+}
+
+void WorkflowEngine::flagIfSlow(int segmentIndex, int step, qint64 predictedMs, qint64 actualMs)
+{
+    if (predictedMs < 0 || actualMs < 0)
+        return;
+    const qint64 limitMs = predictedMs + predictedMs * m_timingTolerancePct / 100 + m_timingSlackMs;
+    if (actualMs <= limitMs)
+        return;
+
+    ++m_timingAnomalies;
+    logStructured(RunLog::Direction::Rx, RunLog::Type::Work, segmentIndex,
+                  QStringLiteral("Timing anomaly step=%1 predictedMs=%2 actualMs=%3 overMs=%4")
+                      .arg(step)
+                      .arg(predictedMs)
+                      .arg(actualMs)
+                      .arg(actualMs - predictedMs),
+                  step);
+    const Segment& seg = m_segments[segmentIndex];
+    emit stepTimingSlow(m_actions[seg.startIndex].flowName, step, predictedMs, actualMs);
+}
+
+void WorkflowEngine::sendVoiceDefs()
+{
+    if (m_voiceDefsSent || !m_serial || !m_serial->isOpen())
+        return;
+    m_voiceDefsSent = true;
+    if (m_compiledDefs.isEmpty())
+        return;
+
+    qsizetype bytes = 0;
+    for (const CompiledFrame& f : m_compiledDefs)
+    {
+        m_sequencer->send(m_planArena.sliced(f.offset, f.size), f.binary);
+        bytes += f.size;
+    }
+    m_sideTxSinceWork = true;
+    logStructured(RunLog::Direction::Tx, RunLog::Type::Config, -1,
+                  QStringLiteral("VOICEDEF x%1 bytes=%2").arg(m_compiledDefs.size()).arg(bytes));
 }
 
 void WorkflowEngine::resetRun()
 {
     m_currentSegmentIndex = -1;
     m_segmentRunning = false;
+    m_segmentInFlight = false;
+    m_sideTxSinceWork = false;
     m_markedRerunSegment = -1;
+    m_unackedWork.clear();
+    m_timing = SegmentTiming{};
+    m_pendingTriggerNs = 0;
+    m_autoNextTimer.stop();
+    m_completionTimer.stop();
+    invalidateStaged(); // whatever is staged is never triggered; the next STAGE overwrites it
+    m_awaitSegment = -1; // autoplay stays on: the next Start + Next resumes it
+    m_autoRerunStreak = 0;
     emit idle();
 }
 
@@ -89,20 +592,29 @@ int WorkflowEngine::pickNextSegmentIndex() const
 
 bool WorkflowEngine::runNextSegment()
 {
+    const qint64 engineNs = HostClock::nowNs();
+    const qint64 triggerNs = m_pendingTriggerNs;
+    m_pendingTriggerNs = 0;
+
     if (m_actions.isEmpty() || m_segments.isEmpty())
         return false;
     if (!m_serial || !m_serial->isOpen())
     {
-        logStructured(QStringLiteral("TX"), QStringLiteral("ERROR"), -1, QStringLiteral("Serial not open"));
+        logStructured(RunLog::Direction::Tx, RunLog::Type::Error, -1, QStringLiteral("Serial not open"));
+        stopAutoplay(QStringLiteral("serial not open"));
         return false;
     }
     if (m_segmentRunning)
         return false;
+    m_runLog.markSegmentBoundary(); // the previous segment's lines go to disk off-thread
 
     const int idx = pickNextSegmentIndex();
     if (idx < 0)
     {
-        logStructured(QStringLiteral("TX"), QStringLiteral("WORK"), -1, QStringLiteral("No next segment"));
+        logStructured(RunLog::Direction::Tx, RunLog::Type::Work, -1, QStringLiteral("No next segment"));
+        stopAutoplay(QStringLiteral("no next segment"));
+        discardCheckpoint(); // run complete: nothing to resume
+        finishRun();
         emit idle();
         return false;
     }
@@ -111,32 +623,108 @@ bool WorkflowEngine::runNextSegment()
         m_markedRerunSegment = -1;
 
     m_currentSegmentIndex = idx;
+    m_segmentInFlight = true;
     const Segment seg = m_segments[idx];
     m_segmentRunning = true;
+    m_sideTxSinceWork = false; // set again if configs or VOICEDEFs go out ahead of this WORK
 
-    emit segmentStarted(seg.name, seg.startIndex, seg.endIndex);
+    if (m_configsPending)
+        flushPendingConfigs(); // CFGHASH? still unanswered: configs must reach the device before WORK
 
-    QVector<ActionItem> segActions;
-    segActions.reserve(seg.endIndex - seg.startIndex + 1);
-    for (int i = seg.startIndex; i <= seg.endIndex; ++i)
-        segActions.push_back(m_actions[i]);
+    if (m_planDirty || m_compiledBinary != m_binaryMode || m_compiledDictionary != m_dictionaryMode)
+        compilePlan(); // slow path: device settings or framing changed since loadPlan
+    sendVoiceDefs();   // no-op unless the device lost them (or never got them)
+    const CompiledFrame cf = m_compiled[idx];
+    const bool fromStage = m_prefetchMode && m_stagedSegment == idx;
+
+    m_timing = SegmentTiming{};
+    m_timing.triggerNs = triggerNs;
+    m_timing.engineNs = engineNs;
+    m_timing.packedNs = HostClock::nowNs();
+
+    // Hot path: lookup + write. The frame is copied out of the arena because the TX
+    // queue / sequencer keep it after this returns and a recompile may replace the arena.
+    m_workQueuedNs = m_timing.packedNs;
+    m_workTxDoneNs = -1;
+    m_lastStep = 0;
+    m_lastStepRxNs = -1;
+    m_lastStepStartMs = -1;
+    m_workFrameSegment = idx;
+    if (fromStage)
+    {
+        // Prefetched while the previous segment ran: only the trigger goes out now.
+        m_txWriter.clear();
+        Protocol::writeGo(m_txWriter, m_stagedId);
+        m_workFrameId = m_sequencer->send(m_txWriter.bytes(), false);
+        invalidateStaged();
+    }
+    else
+    {
+        m_workFrameId = m_sequencer->send(m_planArena.sliced(cf.offset, cf.size), cf.binary);
+    }
+    m_timing.queuedNs = HostClock::nowNs();
+
+    if (triggerNs > 0)
+        m_latency.record(LatencyStats::TriggerToEngine, engineNs - triggerNs);
+    m_latency.record(LatencyStats::EngineToPacked, m_timing.packedNs - engineNs);
+    m_latency.record(LatencyStats::PackedToQueued, m_timing.queuedNs - m_timing.packedNs);
+    m_latencyDirty = true;
+
+    emit segmentStarted(seg.name, seg.startIndex, seg.endIndex);
 
     for (int i = seg.startIndex; i <= seg.endIndex; ++i)
         emit actionStarted(i, actionTypeToString(m_actions[i].type), m_actions[i].rawParamText);
 
-    const QString frame = Protocol::packWork(segActions, m_device);
-    logStructured(QStringLiteral("TX"), QStringLiteral("WORK"), idx, frame.trimmed());
-    m_serial->sendFrame(frame);
+    if (fromStage)
+        logStructured(RunLog::Direction::Tx, RunLog::Type::Work, idx, QString::fromLatin1(m_txWriter.bytes()).trimmed());
+    else if (cf.binary)
+        logStructured(RunLog::Direction::Tx, RunLog::Type::Work, idx,
+                      QStringLiteral("[BIN %1] actions=%2").arg(cf.size).arg(seg.endIndex - seg.startIndex + 1));
+    else
+        logStructured(RunLog::Direction::Tx, RunLog::Type::Work, idx,
+                      QString::fromLatin1(m_planArena.constData() + cf.offset, cf.size).trimmed());
 
-    // No per-action ack in this protocol version.
-    for (int i = seg.startIndex; i <= seg.endIndex; ++i)
-        emit actionFinished(i, true, 0, QStringLiteral("OK"));
+    if (m_autoplay)
+        beginAwaitSegment(idx); // before the ACK path: a fast device may already be reporting
+
+    if (m_sequencer->isEnabled() && m_workFrameId != 0)
+        m_unackedWork.insert(m_workFrameId, idx); // finished on ACK, see onFrameDelivered
+    else
+        finishSegmentActions(idx, true, QStringLiteral("OK")); // text protocol: no ack
 
     m_segmentRunning = false;
+    stageNextSegment(); // transmits while this segment executes
+    writeCheckpoint();  // in flight until the final STEPRUN (noteSegmentDone)
     emit idle();
     return true;
 }
 
+void WorkflowEngine::stageNextSegment()
+{
+    if (!m_prefetchMode || !m_serial || !m_serial->isOpen() || m_segmentRunning)
+        return;
+    if (m_planDirty || m_compiledBinary != m_binaryMode || m_compiledDictionary != m_dictionaryMode)
+        return; // recompiled before the next dispatch anyway
+    if (!m_voiceDefsSent && !m_compiledDefs.isEmpty())
+        return; // the staged frame could reference ids the device no longer has
+
+    const int next = pickNextSegmentIndex();
+    if (next < 0 || next == m_stagedSegment)
+        return;
+
+    m_lastStageId = (m_lastStageId == 0xFFFF) ? 1 : quint16(m_lastStageId + 1);
+    const CompiledFrame cf = m_compiled[next];
+    m_txWriter.clear();
+    if (!Protocol::writeStageWork(m_txWriter, m_lastStageId, m_planArena.sliced(cf.offset, cf.size), cf.binary))
+        return; // too long to stage: runNextSegment sends the WORK frame itself
+    m_sequencer->send(m_txWriter.bytes(), cf.binary);
+    m_stagedSegment = next;
+    m_stagedId = m_lastStageId;
+
+    logStructured(RunLog::Direction::Tx, RunLog::Type::Work, next,
+                  QStringLiteral("STAGE:%1 bytes=%2").arg(m_stagedId).arg(m_txWriter.size()));
+}
+
 void WorkflowEngine::markCurrentOrPreviousSegmentForRerun()
 {
     int target = -1;
@@ -150,9 +738,20 @@ void WorkflowEngine::markCurrentOrPreviousSegmentForRerun()
         target = m_currentSegmentIndex;
     }
 
+    markSegmentForRerun(target);
+}
+
+void WorkflowEngine::markSegmentForRerun(int target)
+{
     if (target < 0 || target >= m_segments.size())
         return;
     m_markedRerunSegment = target;
+    writeCheckpoint();
+    if (m_stagedSegment >= 0 && m_stagedSegment != target)
+    {
+        invalidateStaged();
+        stageNextSegment(); // overwrite the device's staging buffer with the rerun segment
+    }
 
     const Segment& seg = m_segments[target];
     if (seg.startIndex >= 0 && seg.startIndex < m_actions.size())
@@ -163,119 +762,445 @@ void WorkflowEngine::markCurrentOrPreviousSegmentForRerun()
     }
 }
 
+void WorkflowEngine::setAutoplay(bool on)
+{
+    if (m_autoplay == on)
+        return;
+    m_autoplay = on;
+    if (!on)
+    {
+        m_autoNextTimer.stop();
+        m_completionTimer.stop();
+        m_awaitSegment = -1;
+    }
+    logStructured(RunLog::Direction::Tx, RunLog::Type::Config, -1,
+                  QStringLiteral("Autoplay %1 gapMs=%2").arg(on ? QStringLiteral("on") : QStringLiteral("off")).arg(m_autoplayGapMs));
+    emit autoplayChanged(on);
+}
+
+void WorkflowEngine::stopAutoplay(const QString& reason)
+{
+    if (!m_autoplay)
+        return;
+    logStructured(RunLog::Direction::Tx, RunLog::Type::Config, m_currentSegmentIndex,
+                  QStringLiteral("Autoplay stopped: %1").arg(reason));
+    setAutoplay(false);
+}
+
+qint64 WorkflowEngine::predictActionMs(const ActionItem& a) const
+{
+    const qint64 slot = qint64(qMax(0, m_device.onMs)) + qMax(0, m_device.gapMs);
+    switch (a.type)
+    {
+    case ActionType::L:
+    {
+        const QString mode = a.ledMode.trimmed().toUpper();
+        const bool oneByOne = (mode == QStringLiteral("SEQ") || mode == QStringLiteral("RAND"));
+        return oneByOne ? slot * qMax(1, m_device.ledCount) : slot;
+    }
+    case ActionType::D:
+        return qMax(0, a.delayMs);
+    case ActionType::B:
+        return qMax(0, m_device.buzzerDurMs);
+    case ActionType::V:
+    {
+        // speed 0 -> 375ms, 5 -> 250ms, 10 -> 125ms per character
+        const int speed = qBound(0, (a.voiceSet == 2) ? m_voice2.voiceSpeed : m_voice1.voiceSpeed, 10);
+        return qint64(a.voiceText.size()) * (375 - 25 * speed);
+    }
+    case ActionType::Unknown:
+        break;
+    }
+    return 0;
+}
+
+void WorkflowEngine::beginAwaitSegment(int segmentIndex)
+{
+    m_awaitSegment = segmentIndex;
+    m_awaitStepMs = predictedStepMs(segmentIndex);
+    if (m_awaitStepMs.isEmpty())
+    {
+        completeSegment(false); // nothing for the device to run
+        return;
+    }
+    armCompletionTimer(0);
+}
+
+void WorkflowEngine::armCompletionTimer(int fromStep)
+{
+    qint64 remainingMs = 0;
+    for (int i = qMax(0, fromStep); i < m_awaitStepMs.size(); ++i)
+        remainingMs += m_awaitStepMs[i];
+    const qint64 deadline = qint64(double(remainingMs) * kCompletionFallbackFactor) + kCompletionFallbackSlackMs;
+    m_completionTimer.start(int(qMin<qint64>(deadline, std::numeric_limits<int>::max())));
+}
+
+void WorkflowEngine::completeSegment(bool byTimeout)
+{
+    const int idx = m_awaitSegment;
+    m_awaitSegment = -1;
+    m_completionTimer.stop();
+    if (idx < 0)
+        return;
+
+    if (byTimeout)
+        logStructured(RunLog::Direction::Rx, RunLog::Type::Error, idx,
+                      QStringLiteral("No final STEPRUN within predicted duration, advancing"));
+    if (idx == m_currentSegmentIndex)
+        noteSegmentDone(); // autoplay advances past it either way
+    emit segmentCompleted(idx, byTimeout);
+
+    m_autoRerunStreak = (m_markedRerunSegment == idx) ? m_autoRerunStreak + 1 : 0;
+    if (m_autoRerunStreak > kMaxAutoplayReruns)
+        stopAutoplay(QStringLiteral("segment %1 failed %2 times in a row").arg(idx).arg(m_autoRerunStreak));
+
+    if (m_autoplay)
+        m_autoNextTimer.start(m_autoplayGapMs); // via the event loop even for 0: we may be inside RX dispatch
+}
+
+void WorkflowEngine::onCompletionTimeout()
+{
+    completeSegment(true);
+}
+
+void WorkflowEngine::onAutoplayNext()
+{
+    if (!m_autoplay || m_awaitSegment >= 0)
+        return;
+    noteTrigger();
+    runNextSegment();
+}
+
 void WorkflowEngine::sendConfigs()
 {
     if (!m_serial || !m_serial->isOpen())
         return;
 
-    const QString ledCfg = Protocol::packLedConfig(m_device, m_colors);
-    const QString voiceCfg1 = Protocol::packVoiceConfig1(m_voice1);
-    const QString voiceCfg2 = Protocol::packVoiceConfig2(m_voice2);
-    const QString beepCfg = Protocol::packBeepConfig(m_device);
+    // Render all four blocks; the latest call wins if a CFGHASH? is still outstanding.
+    for (int i = 0; i < Protocol::kConfigBlockCount; ++i)
+    {
+        PendingConfig& p = m_pendingConfigs[i];
+        m_txWriter.clear();
+        p.binary = false;
+        switch (Protocol::ConfigBlock(i))
+        {
+        case Protocol::ConfigBlock::LedSet:
+            p.binary = m_binaryMode && Protocol::writeLedConfigBinary(m_txWriter, m_device, m_colors);
+            if (!p.binary)
+                Protocol::writeLedConfig(m_txWriter, m_device, m_colors);
+            break;
+        case Protocol::ConfigBlock::VoiceSet1:
+            Protocol::writeVoiceConfig(m_txWriter, 1, m_voice1);
+            break;
+        case Protocol::ConfigBlock::VoiceSet2:
+            Protocol::writeVoiceConfig(m_txWriter, 2, m_voice2);
+            break;
+        case Protocol::ConfigBlock::BeepSet:
+            Protocol::writeBeepConfig(m_txWriter, m_device);
+            break;
+        }
+        p.bytes = m_txWriter.bytes();
+        p.hash = Protocol::configFrameHash(p.bytes, p.binary);
+    }
+    m_configsPending = true;
+
+    if (m_cfgHashSupport == CfgHashSupport::No || m_cfgCacheValid)
+    {
+        flushPendingConfigs();
+        return;
+    }
+    if (m_cfgQueryTimer.isActive())
+        return; // reply to the earlier query will flush these
 
-    m_serial->sendFrame(ledCfg);
-    logStructured(QStringLiteral("TX"), QStringLiteral("CONFIG"), -1, ledCfg.trimmed());
+    m_txWriter.clear();
+    Protocol::writeConfigHashQuery(m_txWriter);
+    m_serial->sendBytes(m_txWriter.bytes());
+    m_sideTxSinceWork = true;
+    m_cfgQueryTimer.start();
+}
 
-    m_serial->sendFrame(voiceCfg1);
-    logStructured(QStringLiteral("TX"), QStringLiteral("CONFIG"), -1, voiceCfg1.trimmed());
+void WorkflowEngine::flushPendingConfigs()
+{
+    if (!m_configsPending)
+        return;
+    m_configsPending = false;
 
-    m_serial->sendFrame(voiceCfg2);
-    logStructured(QStringLiteral("TX"), QStringLiteral("CONFIG"), -1, voiceCfg2.trimmed());
+    // A reply arriving after this point describes the device before these frames: ignore it.
+    m_cfgQueryTimer.stop();
 
-    m_serial->sendFrame(beepCfg);
-    logStructured(QStringLiteral("TX"), QStringLiteral("CONFIG"), -1, beepCfg.trimmed());
+    QStringList unchanged;
+    for (int i = 0; i < Protocol::kConfigBlockCount; ++i)
+    {
+        PendingConfig& p = m_pendingConfigs[i];
+        const char* name = Protocol::configBlockName(Protocol::ConfigBlock(i));
+        if (m_cfgCacheValid && m_deviceCfgHash[i] == p.hash)
+        {
+            unchanged << QString::fromLatin1(name);
+            continue;
+        }
+
+        m_sequencer->send(p.bytes, p.binary);
+        m_sideTxSinceWork = true;
+        logStructured(RunLog::Direction::Tx, RunLog::Type::Config, -1,
+                      p.binary ? QStringLiteral("[BIN %1] %2").arg(p.bytes.size()).arg(QString::fromLatin1(name))
+                               : QString::fromLatin1(p.bytes).trimmed());
+        m_deviceCfgHash[i] = p.hash; // assumed applied; ERR/FAULT or a failed frame invalidates the cache
+        p.bytes.clear();
+    }
+
+    if (!unchanged.isEmpty())
+        logStructured(RunLog::Direction::Tx, RunLog::Type::Config, -1,
+                      QStringLiteral("Unchanged on device, not sent: %1").arg(unchanged.join(QStringLiteral(", "))));
+}
+
+void WorkflowEngine::onConfigHashReply(const Protocol::RxMessage& m)
+{
+    logStructured(RunLog::Direction::Rx, RunLog::Type::Config, -1, QString::fromLatin1(m.line));
+    if (!m_cfgQueryTimer.isActive())
+        return; // late: the configs were already sent in full
+
+    m_cfgQueryTimer.stop();
+    m_cfgHashSupport = CfgHashSupport::Yes;
+    for (int i = 0; i < Protocol::kConfigBlockCount; ++i)
+        m_deviceCfgHash[i] = m.configHashes[i];
+    m_cfgCacheValid = true;
+    flushPendingConfigs();
+}
+
+void WorkflowEngine::onConfigHashTimeout()
+{
+    logStructured(RunLog::Direction::Rx, RunLog::Type::Config, -1,
+                  QStringLiteral("No CFGHASH reply, sending every config block"));
+    m_cfgHashSupport = CfgHashSupport::No; // until the port is reopened
+    invalidateConfigCache();
+    flushPendingConfigs();
 }
 
 void WorkflowEngine::logTestTx(const QString& frame)
 {
-    if (!m_logReady)
+    m_sideTxSinceWork = true; // the caller sends it right after this
+    if (!m_runLog.isOpen() && !m_binLog.isOpen())
         return;
-    logStructured(QStringLiteral("TX"), QStringLiteral("TEST"), -1, frame.trimmed());
+    logStructured(RunLog::Direction::Tx, RunLog::Type::Test, -1, frame.trimmed());
+}
+
+void WorkflowEngine::onSerialFrame(const QString& frame, qint64 hostNs)
+{
+    onSerialLine(frame.toUtf8(), hostNs);
+}
+
+void WorkflowEngine::onSerialLine(const QByteArray& line, qint64 hostNs)
+{
+    m_rx.dispatch(line, (hostNs > 0) ? hostNs : HostClock::nowNs());
+}
+
+void WorkflowEngine::setupRxRoutes()
+{
+    using Protocol::RxKind;
+    using Protocol::RxMessage;
+
+    m_rx.setHandler(RxKind::StepRun, [this](const RxMessage& m, qint64 ns) { onStepRun(m, ns); });
+    m_rx.setHandler(RxKind::Ack, [this](const RxMessage& m, qint64) { m_sequencer->handleAck(m.seq, false); });
+    m_rx.setHandler(RxKind::Nak, [this](const RxMessage& m, qint64) {
+        logStructured(RunLog::Direction::Rx, RunLog::Type::Error, m_currentSegmentIndex, QString::fromLatin1(m.line));
+        m_sequencer->handleAck(m.seq, true);
+    });
+    m_rx.setHandler(RxKind::Version, [this](const RxMessage& m, qint64) { onVersionReply(m); });
+    m_rx.setHandler(RxKind::ConfigHash, [this](const RxMessage& m, qint64) { onConfigHashReply(m); });
+    m_rx.setHandler(RxKind::Error, [this](const RxMessage& m, qint64) { onDeviceReport(m); });
+    m_rx.setHandler(RxKind::Fault, [this](const RxMessage& m, qint64) { onDeviceReport(m); });
+    m_rx.setHandler(RxKind::Unknown, [this](const RxMessage& m, qint64) { onUnknownRx(m); });
 }
 
-void WorkflowEngine::onSerialFrame(const QString& frame)
+void WorkflowEngine::onStepRun(const Protocol::RxMessage& m, qint64 rxNs)
 {
-    logStructured(QStringLiteral("RX"), QStringLiteral("WORK"), m_currentSegmentIndex, frame.trimmed());
+    logStructured(RunLog::Direction::Rx, RunLog::Type::Work, m_currentSegmentIndex, QString::fromLatin1(m.line),
+                  m.step);
+
+    // Step 1 starts once the device has the whole WORK frame; step k starts when step k-1
+    // finished, i.e. when its report was sent. Reports that cannot be paired are not sampled.
+    const int prevStep = m_lastStep;
+    const qint64 prevStartMs = m_lastStepStartMs;
+    qint64 stepHostNs = -1;
+    if (m.step <= 1)
+        stepHostNs = m_workTxDoneNs;
+    else if (m.step == prevStep + 1)
+        stepHostNs = m_lastStepRxNs;
+    m_lastStep = m.step;
+    m_lastStepRxNs = rxNs;
+    m_lastStepStartMs = m.startTimeMs;
+    if (stepHostNs > 0)
+        m_clock.addSample(stepHostNs, m.startTimeMs);
+    recordStepLatency(rxNs);
+    emit progressUpdated(m.step, m.startTimeMs);
+    checkStepTiming(m, rxNs, prevStep, prevStartMs); // after progressUpdated so a slow flag is not overwritten
+
+    if (m_segmentInFlight && m_currentSegmentIndex >= 0
+        && m.step >= predictedStepMs(m_currentSegmentIndex).size())
+        noteSegmentDone(); // final step reported (manual mode too)
 
-    const auto pr = Protocol::parseSetpRun(frame);
-    if (pr.ok)
+    if (m_awaitSegment >= 0)
     {
-        if (!m_haveDeviceBase)
-        {
-            m_haveDeviceBase = true;
-            m_deviceBaseMs = pr.startTimeMs;
-            m_hostBaseElapsedMs = m_runTimer.isValid() ? m_runTimer.elapsed() : 0;
-        }
-        emit progressUpdated(pr.currentStep, pr.startTimeMs);
+        if (m.step >= m_awaitStepMs.size())
+            completeSegment(false);
+        else
+            armCompletionTimer(m.step); // device is alive: the deadline follows the remaining steps
+    }
+}
+
+void WorkflowEngine::onVersionReply(const Protocol::RxMessage& m)
+{
+    logStructured(RunLog::Direction::Rx, RunLog::Type::Config, -1, QString::fromLatin1(m.line));
+    if (!m_handshakeTimer.isActive())
+        return; // late or unsolicited reply: keep the negotiated mode
+
+    m_handshakeTimer.stop();
+    m_binaryMode = m_preferBinary && m.binary;
+    m_dictionaryMode = m_preferDictionary && m.dictionary;
+    m_prefetchMode = m_preferPrefetch && m.staging;
+    m_sequencer->setEnabled(m_ackWindow > 0 && m.sequenced);
+    emit protocolNegotiated(m.version, m_binaryMode, m_sequencer->isEnabled());
+}
+
+void WorkflowEngine::onDeviceReport(const Protocol::RxMessage& m)
+{
+    const bool fault = (m.kind == Protocol::RxKind::Fault);
+    logStructured(RunLog::Direction::Rx, RunLog::Type::Error, m_currentSegmentIndex, QString::fromLatin1(m.line));
+    invalidateConfigCache(); // the rejected frame may have been a config block
+    m_voiceDefsSent = false; // e.g. "unknown voice id" after a device reset
+    invalidateStaged();      // e.g. ERR:2 for a GO whose STAGE was lost
+
+    // Only a report that can be tied to the in-flight WORK/GO reruns it: an ERR for a
+    // config block, VOICEDEF or a test frame says nothing about the segment.
+    const bool segmentReport = m_segmentInFlight && !m_sideTxSinceWork && m_currentSegmentIndex >= 0;
+    if (segmentReport)
+        markSegmentForRerun(m_currentSegmentIndex); // the device did not (fully) run it
+    if (fault)
+        stopAutoplay(QStringLiteral("device fault"));
+    else if (segmentReport && m_awaitSegment >= 0)
+        completeSegment(false); // no more STEPRUNs are coming; autoplay goes on with the rerun
+    emit deviceReport(fault, m.code, QString::fromUtf8(m.detail));
+}
+
+void WorkflowEngine::onUnknownRx(const Protocol::RxMessage& m)
+{
+    ++m_unknownRx;
+    if (m_unknownRx > kMaxUnknownRxLogged)
+        return;
+    logStructured(RunLog::Direction::Rx, RunLog::Type::Unknown, m_currentSegmentIndex,
+                  m_unknownRx < kMaxUnknownRxLogged
+                      ? QString::fromLatin1(m.line)
+                      : QStringLiteral("%1 (further unknown frames are not logged)").arg(QString::fromLatin1(m.line)));
+}
+
+void WorkflowEngine::recordStepLatency(qint64 rxNs)
+{
+    if (m_timing.engineNs == 0)
+        return; // STEPRUN outside a segment we sent (e.g. after Reset)
+
+    if (m_timing.lastStepNs == 0)
+    {
+        if (m_timing.writtenNs > 0)
+            m_latency.record(LatencyStats::WrittenToFirstStep, rxNs - m_timing.writtenNs);
+        if (m_timing.triggerNs > 0)
+            m_latency.record(LatencyStats::TriggerToFirstStep, rxNs - m_timing.triggerNs);
+    }
+    else
+    {
+        m_latency.record(LatencyStats::StepToStep, rxNs - m_timing.lastStepNs);
     }
+    m_timing.lastStepNs = rxNs;
+    m_latencyDirty = true;
 }
 
-void WorkflowEngine::startNewRunLog()
+void WorkflowEngine::onTxCompleted(quint64 frameId, qint64 hostNs)
 {
-    if (m_logFile.isOpen())
-        m_logFile.close();
+    if (frameId == 0 || frameId != m_workFrameId)
+        return;
 
-    m_runTimer.restart();
-    m_haveDeviceBase = false;
-    m_deviceBaseMs = 0;
-    m_hostBaseElapsedMs = 0;
+    m_workTxDoneNs = hostNs;
+    if (m_timing.writtenNs == 0 && m_timing.queuedNs > 0)
+    {
+        m_timing.writtenNs = hostNs;
+        m_latency.record(LatencyStats::QueuedToWritten, hostNs - m_timing.queuedNs);
+        m_latencyDirty = true;
+    }
+    logStructured(RunLog::Direction::Tx, RunLog::Type::Work, m_workFrameSegment,
+                  QStringLiteral("TX complete frame=%1 drainUs=%2")
+                      .arg(frameId)
+                      .arg((hostNs - m_workQueuedNs) / 1000));
+    emit segmentTransmitted(m_workFrameSegment, hostNs);
+}
+
+void WorkflowEngine::startNewRunLog(const QString& continueBase)
+{
+    m_runLog.close();
+    m_binLog.close();
+
+    m_clock.reset();
+    m_clockReportedSamples = 0;
+    m_timingAnomalies = 0;
+    m_lastStep = 0;
+    m_lastStepRxNs = -1;
+    m_lastStepStartMs = -1;
+    m_workFrameId = 0;
+    m_workFrameSegment = -1;
+    m_workTxDoneNs = -1;
+    m_unknownRx = 0;
 
     const QString baseDir = QCoreApplication::applicationDirPath();
     QDir d(baseDir);
     if (!d.exists("logs"))
         d.mkpath("logs");
 
-    const QString ts = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz");
-    const QString filePath = d.filePath(QString("logs/%1.log").arg(ts));
-
-    m_logFile.setFileName(filePath);
-    if (!m_logFile.open(QIODevice::WriteOnly | QIODevice::Text))
+    const QDateTime now = QDateTime::currentDateTime();
+    const bool resume = !continueBase.isEmpty();
+    if (resume)
     {
-        m_logReady = false;
-        emit logLine(QStringLiteral("日志文件创建失败：%1").arg(filePath));
-        return;
+        m_runLogBase = continueBase;
     }
+    else
+    {
+        QString ts = now.toString("yyyyMMdd_HHmmss_zzz");
+        if (!m_runLogTag.isEmpty())
+            ts += QLatin1Char('_') + m_runLogTag;
+        m_runLogBase = d.filePath(QString("logs/%1").arg(ts));
+    }
+    const QString filePath = m_runLogBase + QStringLiteral(".log");
 
-    m_logStream.setDevice(&m_logFile);
-#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
-    m_logStream.setEncoding(QStringConverter::Utf8);
-#else
-    m_logStream.setCodec("UTF-8");
-#endif
-
-    m_logReady = true;
+    QString err;
+    if (m_textLog && !m_runLog.open(filePath, err, resume))
+        emit logLine(QStringLiteral("日志文件创建失败：%1（%2）").arg(filePath, err));
+    if (m_binaryLog)
+    {
+        const bool ok = (resume && QFile::exists(m_runLogBase + QStringLiteral(".rlog")))
+            ? m_binLog.reopen(m_runLogBase, HostClock::nowNs(), now.toMSecsSinceEpoch(), err)
+            : m_binLog.open(m_runLogBase, HostClock::nowNs(), now.toMSecsSinceEpoch(), err);
+        if (!ok)
+            emit logLine(QStringLiteral("二进制日志创建失败：%1").arg(err));
+    }
 }
 
 qint64 WorkflowEngine::nowDeviceMs() const
 {
-    if (!m_haveDeviceBase)
-        return -1;
-    const qint64 nowElapsed = m_runTimer.isValid() ? m_runTimer.elapsed() : 0;
-    return m_deviceBaseMs + (nowElapsed - m_hostBaseElapsedMs);
+    return m_clock.deviceMsAt(HostClock::nowNs());
 }
 
-void WorkflowEngine::logStructured(const QString& direction,
-                                  const QString& type,
-                                  int segmentIndex,
-                                  const QString& rawLine)
+void WorkflowEngine::logStructured(RunLog::Direction direction,
+                                   RunLog::Type type,
+                                   int segmentIndex,
+                                   const QString& rawLine,
+                                   int action)
 {
     const qint64 devMs = nowDeviceMs();
-    const QString line = QStringLiteral("[%1] [%2] [%3] [%4] [%5]")
-                             .arg(devMs)
-                             .arg(direction)
-                             .arg(type)
-                             .arg(segmentIndex)
-                             .arg(rawLine);
-    writeLogLine(line);
+    if (m_binLog.isOpen())
+        m_binLog.append(HostClock::nowNs(), devMs, direction, type, segmentIndex, action, rawLine.toUtf8());
+    writeLogLine(RunLog::formatLine(devMs, direction, type, segmentIndex, rawLine));
 }
 
 void WorkflowEngine::writeLogLine(const QString& line)
 {
     emit logLine(line);
 
-    if (m_logReady && m_logFile.isOpen())
-    {
-        m_logStream << line << "\n";
-        m_logStream.flush();
-    }
+    m_runLog.append(line); // no-op when no run log is open
 }
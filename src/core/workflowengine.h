@@ -4,15 +4,22 @@
  * @brief Segment-level scheduler that builds WORK frames and pushes them via SerialService.
  */
 
+#include <QHash>
 #include <QObject>
+#include <QTimer>
 #include <QVector>
-#include <QFile>
-#include <QTextStream>
-#include <QElapsedTimer>
 
+#include "binaryrunlog.h"
+#include "clocksync.h"
+#include "framewriter.h"
+#include "latencystats.h"
 #include "models.h"
+#include "runcheckpoint.h"
+#include "runlogwriter.h"
+#include "rxdecoder.h"
 #include "../config/appsettings.h"
 
+class FrameSequencer;
 class SerialService;
 
 class WorkflowEngine : public QObject
@@ -23,22 +30,171 @@ public:
 
     void setSerialService(SerialService* s);
 
-    void setDeviceProps(const DeviceProps& props) { m_device = props; }
+    void setDeviceProps(const DeviceProps& props) { m_device = props; m_planDirty = true; }
     void setColors(const QVector<ColorItem>& colors) { m_colors = colors; }
-    void setVoiceSets(const VoiceProps& v1, const VoiceProps& v2) { m_voice1 = v1; m_voice2 = v2; }
+    void setVoiceSets(const VoiceProps& v1, const VoiceProps& v2);
 
-    void loadPlan(const QVector<ActionItem>& actions);
+    /**
+     * @brief 一次设置 Start 前需要的全部运行参数（设备属性、颜色、语音、SettingsData::run）
+     */
+    void applyRunSettings(const SettingsData& s);
+
+    /**
+     * @brief 打开串口前设置握手偏好与确认参数（SettingsData::serial）
+     */
+    void applySerialSettings(const SerialConfig& s);
+
+    /**
+     * @brief 打开串口后是否发 VER? 握手；设备回 BIN 才切换到二进制 WORK/LEDSET
+     */
+    void setPreferBinary(bool on) { m_preferBinary = on; }
+    bool isBinaryMode() const { return m_binaryMode; }
+
+    /**
+     * @brief 语音短语字典（VOICEDEF + VOICE,#id）；同样需要握手，设备回 DICT 才启用
+     *
+     * 启用后 loadPlan 时把不同的语音文本各下发一次，WORK 帧里只带编号。
+     */
+    void setPreferVoiceDictionary(bool on) { m_preferDictionary = on; }
+    bool isDictionaryMode() const { return m_dictionaryMode; }
+
+    /**
+     * @brief 预取：当前段下发后立即把下一段 STAGE 到设备暂存区，触发时只发 GO:<id>
+     *
+     * 需要握手，设备回 STAGE 才启用。标记重做会用重做段覆盖暂存区；
+     * 重新编译、重新握手、ERR/FAULT、发送失败后暂存作废，下一段按普通 WORK 整帧下发。
+     */
+    void setPreferPrefetch(bool on) { m_preferPrefetch = on; }
+    bool isPrefetchMode() const { return m_prefetchMode; }
+
+    /**
+     * @brief 序号/确认下发（FrameSequencer）；window=0 表示不使用，设备需在握手中声明 SEQ
+     *
+     * 开启后 actionFinished 在设备 ACK 该段 WORK 时才发出；重发仍失败则报失败并标记重跑。
+     */
+    void setAckOptions(int window, int timeoutMs, int maxRetries);
+    bool isSequenced() const;
+
+    /**
+     * @brief 载入计划（RandomColorResolver::resolveAll 之后）并预编译每段 WORK 帧
+     * @param seed RAND 顺序的随机种子；0 = 随机生成。种子写入 Run 日志，可用于复现
+     *
+     * 所有段的帧字节连续存放在一块 arena 里，runNextSegment 只做查表 + 发送；
+     * 设备参数或帧格式（文本/二进制/字典）变化后，在下一次 runNextSegment 时用同一种子重新编译。
+     * 字典模式下编译后立即下发 VOICEDEF（串口未开时推迟到第一段之前）。
+     */
+    void loadPlan(const QVector<ActionItem>& actions, quint32 seed = 0);
+    quint32 planSeed() const { return m_planSeed; }
 
     bool hasPlan() const { return !m_actions.isEmpty(); }
     const QVector<ActionItem>& plan() const { return m_actions; }
+    int segmentCount() const { return int(m_segments.size()); }
+    int currentSegmentIndex() const { return m_currentSegmentIndex; } ///< -1 = 本次 Run 尚未发段
+    int markedRerunSegment() const { return m_markedRerunSegment; }   ///< -1 = 无
+
+    /**
+     * @brief 所有段都已下发且没有待重做的段（下一次 runNextSegment 会报 No next segment）
+     */
+    bool isRunComplete() const { return !m_segments.isEmpty() && pickNextSegmentIndex() < 0; }
+    const QVector<Segment>& segments() const { return m_segments; }
+
+    /**
+     * @brief Run 断点文件（runcheckpoint.h）；空 = 不写断点（默认）
+     *
+     * 设置后 loadPlan、每段下发后、该段执行完（末步 STEPRUN）后、标记重做时重写断点（在 Run 日志写线程上原子替换），
+     * 无下一段时删除。display 只随断点保存，供恢复时重建队列表；需在 loadPlan 之前设置。
+     */
+    void setCheckpointPath(const QString& path) { m_checkpointPath = path; }
+    void setCheckpointDisplay(const RunCheckpoint::Display& display) { m_checkpointDisplay = display; }
+
+    /**
+     * @brief 从断点恢复：续写原 Run 日志，用断点里已解析颜色的计划和种子重新编译，回到原来的段与重做标记
+     *
+     * 断点写于某段执行中（未收到末步 STEPRUN）时，该段视为未执行：currentSegmentIndex() 回到上一段，下一次再发它。
+     * 替代 beginRun + loadPlan（不经过 ExcelImporter / RandomColorResolver）；之后照常 sendConfigs、runNextSegment。
+     * @return false 时 errMsg 为原因，引擎状态不变
+     */
+    bool resumeRun(const RunCheckpoint::Checkpoint& cp, QString& errMsg);
+
+    /**
+     * @brief 删除断点文件（重置 Run 时）；下一次 loadPlan 前不再写断点
+     */
+    void discardCheckpoint();
+
+    /**
+     * @brief Run 日志的刷新策略（RunLogWriter::FlushPolicy），下一次 beginRun 起生效
+     */
+    void setLogFlushPolicy(RunLogWriter::FlushPolicy policy, int intervalMs) { m_runLog.setFlushPolicy(policy, intervalMs); }
+
+    /**
+     * @brief 每次 Run 写哪些日志文件：文本 logs/<run>.log、二进制 logs/<run>.rlog（binaryrunlog.h），下一次 beginRun 起生效
+     */
+    void setRunLogFormats(bool text, bool binary) { m_textLog = text; m_binaryLog = binary || !text; }
+
+    /**
+     * @brief 日志文件名后缀（logs/<ts>_<tag>.*），多治具时区分各路；空 = 无后缀
+     */
+    void setRunLogTag(const QString& tag) { m_runLogTag = tag; }
 
     void beginRun(); // create log file + reset time base (per Start)
 
+    /**
+     * @brief 设备时钟模型的当前误差估计（ms，窗口内残差 RMS）；尚无样本时为 -1
+     */
+    double deviceClockErrorMs() const { return m_clock.isValid() ? m_clock.errorMs() : -1.0; }
+
+    /**
+     * @brief 结束本次 Run：Run 日志写出并 fsync；把延迟直方图导出为 logs/<run>.latency.csv/.json（无新样本则跳过）
+     * @note beginRun 会先对上一次 Run 调用它；无下一段、Reset、退出时也应调用
+     */
+    void finishRun();
+
+    /**
+     * @brief 记录“下一段”触发时刻（热键/按钮），供 runNextSegment 计算 trigger_to_engine
+     * @param hostNs 0 = 现在
+     */
+    void noteTrigger(qint64 hostNs = 0);
+    const LatencyStats& latencyStats() const { return m_latency; }
+
     bool runNextSegment();
     void resetRun();
+
+    /**
+     * @brief 自动连播：一段的 STEPRUN 到达该段步数后，隔 gapMs 自动发下一段
+     *
+     * STEPRUN 丢失时按预测时长兜底（predictActionMs，余量见 workflowengine.cpp）；
+     * 标记重做照常生效，ERR 立即结束当前段并先重做，FAULT 或无下一段时自动停止。
+     * 打开后需先触发一次 runNextSegment（“下一步”）开始。
+     */
+    void setAutoplay(bool on);
+    void setAutoplayGapMs(int gapMs) { m_autoplayGapMs = qMax(0, gapMs); }
+    bool isAutoplay() const { return m_autoplay; }
+    bool isAwaitingSegment() const { return m_awaitSegment >= 0; } ///< autoplay: segment still executing
+    bool isHandshakePending() const { return m_handshakeTimer.isActive(); } ///< VER? sent, protocolNegotiated follows
+
+    /**
+     * @brief 动作的名义执行时长（ms），与 firmware_sim 的 DeviceModel 同一模型
+     */
+    qint64 predictActionMs(const ActionItem& a) const;
+
+    /**
+     * @brief 步时长异常判定：实际 > 预测 x (1 + pct/100) + slackMs 时报 stepTimingSlow
+     *
+     * 预测在编译计划时按段算好（每个 STEPRUN 一项）；第 k 步的实际时长取 STEPRUN k+1 与 k 的设备
+     * 开始时间之差，末步取其 STEPRUN 到达时刻（经设备时钟模型换算）减开始时间。
+     */
+    void setTimingTolerance(int pct, int slackMs) { m_timingTolerancePct = qMax(0, pct); m_timingSlackMs = qMax(0, slackMs); }
+    const QVector<qint64>& predictedStepMs(int segmentIndex) const;
     void markCurrentOrPreviousSegmentForRerun();
 
-    void sendConfigs(); // LEDSET/VOICESET/BEEPSET
+    /**
+     * @brief 下发 LEDSET/VOICESET1/VOICESET2/BEEPSET，只发设备上内容不同的块
+     *
+     * 先用 CFGHASH? 取设备各块指纹（本次串口会话内缓存，ERR/FAULT/发送失败后作废），
+     * 与本地帧的 Protocol::configFrameHash 比较；设备不回 CFGHASH 时四块全部下发。
+     * 查询未返回前开始下一段，会先把四块全部发出，保证配置先于 WORK 到达。
+     */
+    void sendConfigs();
     void logTestTx(const QString& frame);
 
 signals:
@@ -49,23 +205,103 @@ signals:
     void progressUpdated(int currentStep, qint64 deviceMs);
     void rerunMarked(const QString& flowName);
     void logLine(const QString& line);
+    void segmentTransmitted(int segmentIndex, qint64 hostNs); ///< WORK frame fully written out
+    void protocolNegotiated(int version, bool binary, bool sequenced); ///< version=0: no reply, text mode
+    void deviceReport(bool fault, int code, const QString& detail); ///< ERR:/FAULT: from the device
+    void segmentCompleted(int segmentIndex, bool byTimeout); ///< autoplay only; byTimeout = predicted-duration fallback
+    void stepTimingSlow(const QString& flowName, int step, qint64 predictedMs, qint64 actualMs);
+    void autoplayChanged(bool on);
 
 public slots:
-    void onSerialFrame(const QString& frame);
+    void onSerialFrame(const QString& frame, qint64 hostNs = 0);
+
+    /**
+     * @brief RX 主路径：按前缀分发表路由到各类型处理（rxdecoder.h），逐行不分配内存
+     */
+    void onSerialLine(const QByteArray& line, qint64 hostNs);
+    void onTxCompleted(quint64 frameId, qint64 hostNs);
+
+private slots:
+    void onSerialOpened(bool ok);
+    void onHandshakeTimeout();
+    void onFrameDelivered(quint64 ticket);
+    void onFrameFailed(quint64 ticket, const QString& reason);
+    void onConfigHashTimeout();
+    void onAutoplayNext();
+    void onCompletionTimeout();
 
 private:
     void rebuildSegments();
     int pickNextSegmentIndex() const;
     void writeLogLine(const QString& line);
-    void logStructured(const QString& direction,
-                       const QString& type,
+    void logStructured(RunLog::Direction direction,
+                       RunLog::Type type,
                        int segmentIndex,
-                       const QString& rawLine);
+                       const QString& rawLine,
+                       int action = -1);
     qint64 nowDeviceMs() const;
-    void startNewRunLog();
+    void startNewRunLog(const QString& continueBase = QString()); ///< continueBase: append to that run's logs (resume)
+    void installPlan(const QVector<ActionItem>& actions, quint32 seed);
+    void writeCheckpoint();
+    void noteSegmentDone();
+    void startHandshake();
+    void finishSegmentActions(int segmentIndex, bool ok, const QString& msg);
+    void markSegmentForRerun(int segmentIndex);
+    void recordStepLatency(qint64 rxNs);
+    void setupRxRoutes();
+    void onStepRun(const Protocol::RxMessage& m, qint64 rxNs);
+    void onVersionReply(const Protocol::RxMessage& m);
+    void onDeviceReport(const Protocol::RxMessage& m);
+    void onUnknownRx(const Protocol::RxMessage& m);
+    void onConfigHashReply(const Protocol::RxMessage& m);
+    void flushPendingConfigs();
+    void invalidateConfigCache() { m_cfgCacheValid = false; }
+    void compilePlan();
+    void sendVoiceDefs(); ///< once per run/session, before the first WORK that references them
+    void stageNextSegment();
+    void invalidateStaged() { m_stagedSegment = -1; }
+    void beginAwaitSegment(int segmentIndex);
+    void predictPlanTiming();
+    void checkStepTiming(const Protocol::RxMessage& m, qint64 rxNs, int prevStep, qint64 prevStartMs);
+    void flagIfSlow(int segmentIndex, int step, qint64 predictedMs, qint64 actualMs);
+    void armCompletionTimer(int fromStep);
+    void completeSegment(bool byTimeout);
+    void stopAutoplay(const QString& reason);
 
 private:
     SerialService* m_serial = nullptr;
+    Protocol::FrameWriter m_txWriter; ///< reused for every outgoing frame
+
+    bool m_preferBinary = false;
+    bool m_binaryMode = false;
+    bool m_preferDictionary = false;
+    bool m_dictionaryMode = false;
+    bool m_preferPrefetch = false;
+    bool m_prefetchMode = false;
+    QTimer m_handshakeTimer;
+
+    Protocol::RxDispatcher m_rx;
+    quint64 m_unknownRx = 0; ///< per run; only the first few are logged
+
+    FrameSequencer* m_sequencer = nullptr;
+    int m_ackWindow = 0;
+    QHash<quint64, int> m_unackedWork; ///< ticket -> segment index (sequenced mode)
+
+    // Config fingerprints (CFGHASH), see sendConfigs()
+    enum class CfgHashSupport { Unknown, Yes, No };
+    struct PendingConfig
+    {
+        QByteArray bytes;
+        bool binary = false;
+        quint32 hash = 0;
+    };
+    PendingConfig m_pendingConfigs[Protocol::kConfigBlockCount];
+    bool m_configsPending = false;
+    quint32 m_deviceCfgHash[Protocol::kConfigBlockCount] = {}; ///< what the device holds (0 = nothing)
+    bool m_cfgCacheValid = false;
+    CfgHashSupport m_cfgHashSupport = CfgHashSupport::Unknown;
+    QTimer m_cfgQueryTimer;
+
     DeviceProps m_device;
     QVector<ColorItem> m_colors;
     VoiceProps m_voice1;
@@ -74,16 +310,86 @@ private:
     QVector<ActionItem> m_actions;
     QVector<Segment> m_segments;
 
+    // Pre-rendered WORK frames: segment i is m_planArena[offset, offset + size).
+    struct CompiledFrame
+    {
+        qsizetype offset = 0;
+        qsizetype size = 0;
+        bool binary = false; ///< false in binary mode too when the frame exceeded the u16 length
+    };
+    QByteArray m_planArena;
+    QVector<CompiledFrame> m_compiled;
+    QVector<CompiledFrame> m_compiledDefs; ///< VOICEDEF frames, id = index + 1
+    Protocol::VoiceDictionary m_voiceDict;
+    bool m_voiceDefsSent = false;         ///< device holds m_compiledDefs (VER? / ERR clear this)
+    quint32 m_planSeed = 0;
+    bool m_compiledBinary = false;
+    bool m_compiledDictionary = false;
+    bool m_planDirty = true;
+
+    // Prefetch: segment whose WORK frame sits in the device's staging buffer (-1 = none/unknown).
+    int m_stagedSegment = -1;
+    quint16 m_stagedId = 0;
+    quint16 m_lastStageId = 0;
+
     int m_currentSegmentIndex = -1;
-    bool m_segmentRunning = false;
+    bool m_segmentRunning = false; ///< inside runNextSegment only
     int m_markedRerunSegment = -1;
+    bool m_segmentInFlight = false; ///< m_currentSegmentIndex sent, final STEPRUN not seen yet (checkpoint)
+    bool m_sideTxSinceWork = false; ///< config/VOICEDEF/CFGHASH?/test frame sent with or after the last WORK/GO: an ERR may be about it
+
+    // Autoplay: segment whose STEPRUNs we are waiting for, and the nominal duration of its steps.
+    bool m_autoplay = false;
+    int m_autoplayGapMs = 0;
+    int m_awaitSegment = -1;
+    int m_autoRerunStreak = 0;
+    QVector<qint64> m_awaitStepMs;
+    QTimer m_autoNextTimer;
+    QTimer m_completionTimer;
+
+    RunLogWriter m_runLog;        ///< logs/<run>.log（文本，后台线程写）
+    RunLog::BinaryWriter m_binLog; ///< logs/<run>.rlog/.rlogd（定长记录，内存映射追加）
+    bool m_textLog = true;
+    QString m_runLogTag;
+    bool m_binaryLog = true;
+
+    // Device timeline: each STEPRUN start time is paired with the host time that step began
+    // (TX complete for step 1, the previous STEPRUN arrival otherwise), see clocksync.h.
+    ClockSync m_clock;
+    quint64 m_clockReportedSamples = 0; ///< acceptedTotal() at the last "Clock fit" log line
+    int m_lastStep = 0;
+    qint64 m_lastStepRxNs = -1;
+    qint64 m_lastStepStartMs = -1;  ///< device start time of m_lastStep
+
+    QVector<QVector<qint64>> m_predictedStepMs; ///< per segment, one entry per STEPRUN
+    int m_timingTolerancePct = 20;
+    int m_timingSlackMs = 50;
+    quint64 m_timingAnomalies = 0;  ///< this run
+
+    // Last WORK frame: when it was queued and when its bytes actually left the port.
+    quint64 m_workFrameId = 0;
+    int m_workFrameSegment = -1;
+    qint64 m_workQueuedNs = 0;
+    qint64 m_workTxDoneNs = -1;
 
-    QFile m_logFile;
-    QTextStream m_logStream;
-    bool m_logReady = false;
+    // Latency stages of the segment in flight (0 = not reached yet), see latencystats.h.
+    struct SegmentTiming
+    {
+        qint64 triggerNs = 0;
+        qint64 engineNs = 0;
+        qint64 packedNs = 0;
+        qint64 queuedNs = 0;
+        qint64 writtenNs = 0;
+        qint64 lastStepNs = 0;
+    };
+    SegmentTiming m_timing;
+    qint64 m_pendingTriggerNs = 0;
+    LatencyStats m_latency;
+    bool m_latencyDirty = false;
+    QString m_runLogBase; ///< logs/<timestamp> of the current run, without extension
 
-    QElapsedTimer m_runTimer;
-    bool m_haveDeviceBase = false;
-    qint64 m_deviceBaseMs = 0;
-    qint64 m_hostBaseElapsedMs = 0;
+    // Run checkpoint (runcheckpoint.h)
+    QString m_checkpointPath;                  ///< empty = no checkpoints
+    RunCheckpoint::Display m_checkpointDisplay;
+    QByteArray m_checkpointPlan;               ///< encodePlan() of the loaded plan; empty = nothing to checkpoint
 };
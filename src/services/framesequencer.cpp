@@ -0,0 +1,219 @@
+/**
+ * @file framesequencer.cpp
+ * @brief Go-back-N sequencing on top of SerialService.
+ */
+
+#include "framesequencer.h"
+
+#include "serialservice.h"
+
+#include "../core/hostclock.h"
+#include "../core/protocol.h"
+
+FrameSequencer::FrameSequencer(QObject* parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &FrameSequencer::onTimer);
+}
+
+void FrameSequencer::setSerialService(SerialService* s)
+{
+    if (m_serial)
+        disconnect(m_serial, nullptr, this, nullptr);
+    m_serial = s;
+    if (m_serial)
+        connect(m_serial, &SerialService::txCompleted, this, &FrameSequencer::onTxCompleted);
+}
+
+void FrameSequencer::setEnabled(bool on)
+{
+    if (on == m_enabled)
+        return;
+    reset(QStringLiteral("序号模式切换"));
+    m_enabled = on;
+}
+
+void FrameSequencer::reset(const QString& reason)
+{
+    dropAll(reason);
+    m_nextSeq = 1;
+}
+
+void FrameSequencer::dropAll(const QString& reason)
+{
+    m_timer.stop();
+    std::deque<Entry> inFlight;
+    std::deque<Entry> waiting;
+    inFlight.swap(m_inFlight);
+    waiting.swap(m_waiting);
+    for (const Entry& e : inFlight)
+        emit failed(e.ticket, reason);
+    for (const Entry& e : waiting)
+        emit failed(e.ticket, reason);
+}
+
+quint64 FrameSequencer::send(const QByteArray& frame, bool binary)
+{
+    if (!m_serial)
+        return 0;
+
+    if (!m_enabled)
+    {
+        // Pass-through: the ticket is the SerialService frame id.
+        const quint64 id = binary ? m_serial->sendBinary(frame) : m_serial->sendBytes(frame);
+        return id;
+    }
+
+    Entry e;
+    e.ticket = m_nextTicket++;
+    e.frame = frame;
+    e.binary = binary;
+    m_waiting.push_back(std::move(e));
+    const quint64 ticket = m_waiting.back().ticket;
+    pump();
+    return ticket;
+}
+
+void FrameSequencer::pump()
+{
+    while (m_enabled && !m_waiting.empty() && int(m_inFlight.size()) < m_window)
+    {
+        Entry e = std::move(m_waiting.front());
+        m_waiting.pop_front();
+        e.seq = m_nextSeq++;
+        if (m_nextSeq == 0)
+            m_nextSeq = 1; // 0 is never used on the wire
+
+        m_writer.clear();
+        if (!Protocol::writeSequencedFrame(m_writer, e.seq, e.frame, e.binary))
+        {
+            // Cannot happen for frames built with kBinaryWrapBytes headroom; never put a bad length on the wire.
+            m_nextSeq = e.seq;
+            emit failed(e.ticket, QStringLiteral("帧过长，无法加序号发送"));
+            continue;
+        }
+        e.wire = m_writer.bytes();
+
+        m_inFlight.push_back(std::move(e));
+        transmit(m_inFlight.back());
+    }
+}
+
+void FrameSequencer::transmit(Entry& e)
+{
+    ++e.attempts;
+    e.deadlineNs = 0;
+    e.serialId = e.binary ? m_serial->sendBinary(e.wire) : m_serial->sendBytes(e.wire);
+    if (e.serialId == 0)
+    {
+        // Not queued (port closed / TX queue full): let the timeout retry it.
+        e.deadlineNs = HostClock::nowNs() + qint64(m_timeoutMs) * 1000000;
+        armTimer();
+    }
+}
+
+void FrameSequencer::onTxCompleted(quint64 frameId, qint64 hostNs)
+{
+    if (!m_enabled)
+    {
+        emit transmitted(frameId, hostNs);
+        return;
+    }
+
+    for (Entry& e : m_inFlight)
+    {
+        if (e.serialId != frameId)
+            continue;
+        e.deadlineNs = hostNs + qint64(m_timeoutMs) * 1000000;
+        if (!e.reportedTx)
+        {
+            e.reportedTx = true;
+            emit transmitted(e.ticket, hostNs);
+        }
+        armTimer();
+        return;
+    }
+}
+
+void FrameSequencer::handleAck(quint16 seq, bool nak)
+{
+    if (!m_enabled)
+        return;
+
+    if (nak)
+    {
+        for (std::size_t i = 0; i < m_inFlight.size(); ++i)
+        {
+            if (m_inFlight[i].seq == seq)
+            {
+                retransmitFrom(i);
+                break;
+            }
+        }
+        return;
+    }
+
+    // Cumulative: everything up to seq has been executed.
+    while (!m_inFlight.empty() && seqLessEq(m_inFlight.front().seq, seq))
+    {
+        const quint64 ticket = m_inFlight.front().ticket;
+        m_inFlight.pop_front();
+        emit delivered(ticket);
+    }
+    armTimer();
+    pump();
+}
+
+void FrameSequencer::retransmitFrom(std::size_t index)
+{
+    // Go-back-N: the device drops everything after a gap, so resend the tail in order.
+    if (m_inFlight[index].attempts > m_maxRetries)
+    {
+        // A hole in the sequence can't be skipped: the device would NAK everything after
+        // it. Give up on the whole window and let the owner re-synchronise (VER?).
+        reset(QStringLiteral("重发 %1 次仍未确认").arg(m_maxRetries));
+        emit resyncRequired();
+        return;
+    }
+
+    for (std::size_t i = index; i < m_inFlight.size(); ++i)
+    {
+        emit retransmitted(m_inFlight[i].ticket, m_inFlight[i].attempts);
+        transmit(m_inFlight[i]);
+    }
+    armTimer();
+}
+
+void FrameSequencer::onTimer()
+{
+    const qint64 now = HostClock::nowNs();
+    for (std::size_t i = 0; i < m_inFlight.size(); ++i)
+    {
+        const Entry& e = m_inFlight[i];
+        if (e.deadlineNs > 0 && e.deadlineNs <= now)
+        {
+            retransmitFrom(i);
+            return;
+        }
+    }
+    armTimer();
+}
+
+void FrameSequencer::armTimer()
+{
+    qint64 earliest = 0;
+    for (const Entry& e : m_inFlight)
+    {
+        if (e.deadlineNs > 0 && (earliest == 0 || e.deadlineNs < earliest))
+            earliest = e.deadlineNs;
+    }
+    if (earliest == 0)
+    {
+        m_timer.stop();
+        return;
+    }
+    const qint64 waitMs = qMax<qint64>(0, (earliest - HostClock::nowNs() + 999999) / 1000000);
+    m_timer.start(int(waitMs));
+}
@@ -0,0 +1,113 @@
+#pragma once
+/**
+ * @file framesequencer.h
+ * @brief 可靠下发层：帧序号 + ACK/NAK + 超时重传 + 滑动窗口（go-back-N）
+ *
+ * - 关闭时（默认）：send() 直接交给 SerialService，行为与旧版一致
+ * - 开启时：每帧包上序号（格式见 protocol.h），最多 window 帧在途；
+ *   ACK:<seq> 累计确认，NAK:<seq> 或超时则从该帧起全部重发；
+ *   某帧重发超过 maxRetries 次时整窗报 failed，并发出 resyncRequired（需重新握手）
+ * - 超时从该帧字节真正写出端口（txCompleted）时开始计，不含排队时间
+ *
+ * 调用方以 ticket 标识一帧（重发不会改变 ticket）。
+ */
+
+#include <QObject>
+#include <QByteArray>
+#include <QTimer>
+
+#include <deque>
+
+#include "../core/framewriter.h"
+
+class SerialService;
+
+class FrameSequencer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FrameSequencer(QObject* parent = nullptr);
+
+    void setSerialService(SerialService* s);
+
+    /**
+     * @brief 开启/关闭序号模式；切换会丢弃所有在途与排队帧（按 failed 上报）
+     */
+    void setEnabled(bool on);
+    bool isEnabled() const { return m_enabled; }
+
+    void setWindow(int frames) { m_window = qMax(1, frames); pump(); }
+    void setTimeoutMs(int ms) { m_timeoutMs = qMax(1, ms); }
+    void setMaxRetries(int n) { m_maxRetries = qMax(0, n); }
+
+    /**
+     * @brief 发送一帧（文本帧以 CRLF 结尾；binary=true 为 binaryframe.h 帧）
+     * @return ticket；0 表示未能入队
+     */
+    quint64 send(const QByteArray& frame, bool binary);
+
+    /**
+     * @brief 处理设备的 ACK/NAK（由 RX 分发表路由过来）；未启用时忽略
+     */
+    void handleAck(quint16 seq, bool nak);
+
+    /**
+     * @brief 新会话：序号回到 1，丢弃在途与排队帧（按 failed 上报）
+     */
+    void reset(const QString& reason);
+
+    int inFlightCount() const { return int(m_inFlight.size()); }
+    int queuedCount() const { return int(m_waiting.size()); }
+
+signals:
+    void delivered(quint64 ticket);
+    void failed(quint64 ticket, const QString& reason);
+
+    // 首次发送的字节已写出端口（与 SerialService::txCompleted 对应，重发不再上报）
+    void transmitted(quint64 ticket, qint64 hostNs);
+
+    void retransmitted(quint64 ticket, int attempt);
+
+    // 序号已复位，设备需重新握手（VER?）后才能继续
+    void resyncRequired();
+
+private slots:
+    void onTxCompleted(quint64 frameId, qint64 hostNs);
+    void onTimer();
+
+private:
+    struct Entry
+    {
+        quint64 ticket = 0;
+        quint16 seq = 0;
+        QByteArray frame;        ///< original (unsequenced) frame
+        QByteArray wire;         ///< sequenced bytes as sent
+        bool binary = false;
+        int attempts = 0;
+        quint64 serialId = 0;    ///< SerialService frame id of the latest transmission
+        qint64 deadlineNs = 0;   ///< 0 = not yet on the wire
+        bool reportedTx = false;
+    };
+
+    void pump();
+    void transmit(Entry& e);
+    void retransmitFrom(std::size_t index);
+    void dropAll(const QString& reason);
+    void armTimer();
+    static bool seqLessEq(quint16 a, quint16 b) { return quint16(b - a) < 0x8000; }
+
+private:
+    SerialService* m_serial = nullptr;
+    bool m_enabled = false;
+    int m_window = 4;
+    int m_timeoutMs = 300;
+    int m_maxRetries = 3;
+
+    quint64 m_nextTicket = 1;
+    quint16 m_nextSeq = 1;
+    std::deque<Entry> m_inFlight;
+    std::deque<Entry> m_waiting;
+
+    Protocol::FrameWriter m_writer;
+    QTimer m_timer;
+};
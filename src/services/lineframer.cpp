@@ -0,0 +1,99 @@
+/**
+ * @file lineframer.cpp
+ * @brief Ring-buffer CRLF framer (see lineframer.h).
+ */
+
+#include "lineframer.h"
+
+LineFramer::LineFramer(qsizetype capacity)
+    : m_capacity(capacity > 0 ? capacity : 8192)
+{
+    m_ring.resize(m_capacity);
+    m_scratch.resize(m_capacity);
+}
+
+void LineFramer::reset()
+{
+    m_head = 0;
+    m_size = 0;
+    m_scanned = 0;
+    m_discarding = false;
+}
+
+void LineFramer::appendToRing(const char* data, qsizetype n)
+{
+    char* ring = m_ring.data();
+    qsizetype tail = m_head + m_size;
+    if (tail >= m_capacity)
+        tail -= m_capacity;
+
+    const qsizetype first = (n < m_capacity - tail) ? n : (m_capacity - tail);
+    std::memcpy(ring + tail, data, static_cast<size_t>(first));
+    if (n > first)
+        std::memcpy(ring, data + first, static_cast<size_t>(n - first));
+    m_size += n;
+}
+
+qsizetype LineFramer::scanRing()
+{
+    if (m_scanned >= m_size)
+        return -1;
+
+    const char* ring = m_ring.constData();
+    qsizetype pos = m_head + m_scanned;
+    if (pos >= m_capacity)
+        pos -= m_capacity;
+    qsizetype remaining = m_size - m_scanned;
+
+    // At most two contiguous spans: [pos, end-of-ring) and [0, ...).
+    const qsizetype span1 = (remaining < m_capacity - pos) ? remaining : (m_capacity - pos);
+    if (const char* nl = findNewline(ring + pos, span1))
+        return m_scanned + (nl - (ring + pos));
+
+    remaining -= span1;
+    if (remaining > 0)
+    {
+        if (const char* nl = findNewline(ring, remaining))
+            return m_scanned + span1 + (nl - ring);
+    }
+
+    m_scanned = m_size;
+    return -1;
+}
+
+QByteArrayView LineFramer::lineView(qsizetype lineLen)
+{
+    const char* ring = m_ring.constData();
+    if (m_head + lineLen <= m_capacity)
+        return QByteArrayView(ring + m_head, lineLen);
+
+    // Line wraps the end of the ring: stitch into the scratch buffer.
+    char* out = m_scratch.data();
+    const qsizetype first = m_capacity - m_head;
+    std::memcpy(out, ring + m_head, static_cast<size_t>(first));
+    std::memcpy(out + first, ring, static_cast<size_t>(lineLen - first));
+    return QByteArrayView(out, lineLen);
+}
+
+void LineFramer::consume(qsizetype n)
+{
+    m_size -= n;
+    m_scanned = 0;
+    if (m_size == 0)
+    {
+        m_head = 0; // keep the next line contiguous
+        return;
+    }
+    m_head += n;
+    if (m_head >= m_capacity)
+        m_head -= m_capacity;
+}
+
+void LineFramer::overflow()
+{
+    // The pending line is longer than the ring: drop it and skip to the next '\n'.
+    m_droppedBytes += static_cast<quint64>(m_size);
+    ++m_overflowCount;
+    reset();
+    m_discarding = true;
+}
@@ -0,0 +1,132 @@
+#pragma once
+/**
+ * @file lineframer.h
+ * @brief CRLF 切帧器：固定容量环形缓冲 + memchr 换行扫描，帧以非拥有的字节视图交付
+ *
+ * - 输入块里完整的行直接以视图交付（零拷贝），只有跨块的半行才进入环形缓冲
+ * - 环形缓冲不做 memmove；一行跨越环尾时才拷贝到预分配的 scratch 里拼接
+ * - 交付前去掉首尾 ASCII 空白（含 '\r'），空行不交付
+ * - 单行超过容量：丢弃已缓冲部分并跳过到下一个 '\n'，按字节计数（不再整体清空）
+ *
+ * 视图只在 sink 回调期间有效；需要保留请自行拷贝（例如 QByteArray(view)）。
+ */
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+#include <cstring>
+
+class LineFramer
+{
+public:
+    explicit LineFramer(qsizetype capacity = 8192);
+
+    /**
+     * @brief 丢弃缓冲内容与跳过状态（计数器保留）
+     */
+    void reset();
+
+    /**
+     * @brief 喂入一段字节流；每切出一行调用一次 sink(QByteArrayView)
+     */
+    template <typename Sink>
+    void feed(const char* data, qsizetype len, Sink&& sink);
+
+    qsizetype capacity() const { return m_capacity; }
+    qsizetype bufferedBytes() const { return m_size; }
+
+    /**
+     * @brief 因超长行被丢弃的累计字节数 / 超长事件次数
+     */
+    quint64 droppedBytes() const { return m_droppedBytes; }
+    quint64 overflowCount() const { return m_overflowCount; }
+
+private:
+    static const char* findNewline(const char* p, qsizetype n)
+    {
+        return static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(n)));
+    }
+
+    void appendToRing(const char* data, qsizetype n);
+    qsizetype scanRing();                       ///< offset of '\n' from m_head, or -1
+    QByteArrayView lineView(qsizetype lineLen); ///< contiguous view of [m_head, m_head+lineLen)
+    void consume(qsizetype n);
+    void overflow();
+
+    template <typename Sink>
+    static void deliver(QByteArrayView line, Sink& sink)
+    {
+        line = line.trimmed();
+        if (!line.isEmpty())
+            sink(line);
+    }
+
+private:
+    QByteArray m_ring;
+    QByteArray m_scratch;
+    qsizetype m_capacity = 0;
+    qsizetype m_head = 0;      ///< start of the pending partial line
+    qsizetype m_size = 0;      ///< buffered bytes
+    qsizetype m_scanned = 0;   ///< bytes after m_head already known to contain no '\n'
+    bool m_discarding = false; ///< skipping the tail of an overlong line
+
+    quint64 m_droppedBytes = 0;
+    quint64 m_overflowCount = 0;
+};
+
+template <typename Sink>
+void LineFramer::feed(const char* data, qsizetype len, Sink&& sink)
+{
+    while (len > 0)
+    {
+        if (m_discarding)
+        {
+            const char* nl = findNewline(data, len);
+            if (!nl)
+            {
+                m_droppedBytes += static_cast<quint64>(len);
+                return;
+            }
+            const qsizetype skip = (nl - data) + 1;
+            m_droppedBytes += static_cast<quint64>(skip);
+            data += skip;
+            len -= skip;
+            m_discarding = false;
+            continue;
+        }
+
+        if (m_size == 0)
+        {
+            // Fast path: nothing pending, hand out whole lines straight from the input.
+            const char* nl = findNewline(data, len);
+            while (nl)
+            {
+                const qsizetype lineLen = nl - data;
+                deliver(QByteArrayView(data, lineLen), sink);
+                data += lineLen + 1;
+                len -= lineLen + 1;
+                nl = (len > 0) ? findNewline(data, len) : nullptr;
+            }
+            if (len == 0)
+                return;
+        }
+
+        const qsizetype space = m_capacity - m_size;
+        if (space == 0)
+        {
+            overflow();
+            continue;
+        }
+
+        const qsizetype n = (len < space) ? len : space;
+        appendToRing(data, n);
+        data += n;
+        len -= n;
+
+        for (qsizetype off = scanRing(); off >= 0; off = scanRing())
+        {
+            deliver(lineView(off), sink);
+            consume(off + 1);
+        }
+    }
+}
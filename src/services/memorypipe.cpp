@@ -0,0 +1,150 @@
+/**
+ * @file memorypipe.cpp
+ * @brief In-process pipe transport with a process-wide name registry.
+ */
+
+#include "memorypipe.h"
+
+#include <QHash>
+#include <QMutexLocker>
+
+#include <cstring>
+
+struct MemoryPipeTransport::Pipe
+{
+    QMutex mutex;
+    MemoryPipeTransport* ends[2] = {nullptr, nullptr};   ///< 端点析构前会在锁内清空
+    QByteArray inbox[2];          ///< inbox[i]：发给端点 i、尚未读出的字节
+    qsizetype readPos[2] = {0, 0};
+};
+
+namespace
+{
+QMutex g_registryMutex;
+QHash<QString, std::weak_ptr<MemoryPipeTransport::Pipe>> g_registry;
+}
+
+MemoryPipeTransport::MemoryPipeTransport(const QString& name, QObject* parent)
+    : Transport(parent)
+    , m_name(name)
+{
+}
+
+MemoryPipeTransport::~MemoryPipeTransport()
+{
+    close();
+}
+
+bool MemoryPipeTransport::open(QString& errMsg)
+{
+    close();
+
+    std::shared_ptr<Pipe> pipe;
+    {
+        QMutexLocker lock(&g_registryMutex);
+        pipe = g_registry.value(m_name).lock();
+        if (!pipe)
+        {
+            pipe = std::make_shared<Pipe>();
+            g_registry.insert(m_name, pipe);
+        }
+    }
+
+    QMutexLocker lock(&pipe->mutex);
+    int side = -1;
+    if (!pipe->ends[0])
+        side = 0;
+    else if (!pipe->ends[1])
+        side = 1;
+    if (side < 0)
+    {
+        m_errorString = QStringLiteral("内存管道 %1 两端均已占用").arg(m_name);
+        errMsg = m_errorString;
+        return false;
+    }
+
+    pipe->ends[side] = this;
+    pipe->inbox[side].clear();
+    pipe->readPos[side] = 0;
+    m_pipe = std::move(pipe);
+    m_side = side;
+    return true;
+}
+
+void MemoryPipeTransport::close()
+{
+    if (!m_pipe)
+        return;
+
+    {
+        QMutexLocker lock(&m_pipe->mutex);
+        m_pipe->ends[m_side] = nullptr;
+        m_pipe->inbox[m_side].clear();
+        m_pipe->readPos[m_side] = 0;
+    }
+    m_pipe.reset();
+    m_side = -1;
+
+    // Last end gone: drop the name, otherwise every mem:// name ever used stays registered.
+    QMutexLocker lock(&g_registryMutex);
+    const auto it = g_registry.constFind(m_name);
+    if (it != g_registry.constEnd() && it->expired())
+        g_registry.erase(it);
+}
+
+qint64 MemoryPipeTransport::read(char* data, qint64 maxLen)
+{
+    if (!m_pipe)
+        return -1;
+
+    QMutexLocker lock(&m_pipe->mutex);
+    QByteArray& in = m_pipe->inbox[m_side];
+    qsizetype& pos = m_pipe->readPos[m_side];
+    const qint64 n = qMin<qint64>(maxLen, in.size() - pos);
+    if (n <= 0)
+        return 0;
+
+    std::memcpy(data, in.constData() + pos, size_t(n));
+    pos += qsizetype(n);
+    if (pos == in.size())
+    {
+        in.truncate(0);
+        pos = 0;
+    }
+    return n;
+}
+
+qint64 MemoryPipeTransport::write(const QByteArray& data)
+{
+    if (!m_pipe)
+    {
+        m_errorString = QStringLiteral("设备未打开");
+        return -1;
+    }
+
+    const int peerSide = 1 - m_side;
+    {
+        // The peer can only go away through close(), which takes this lock, so it is
+        // safe to post to it from here.
+        QMutexLocker lock(&m_pipe->mutex);
+        MemoryPipeTransport* peer = m_pipe->ends[peerSide];
+        // No peer: the bytes go nowhere, like a serial line with nothing attached.
+        if (peer)
+        {
+            QByteArray& out = m_pipe->inbox[peerSide];
+            const bool wasEmpty = (out.size() == m_pipe->readPos[peerSide]);
+            out.append(data);
+            if (wasEmpty)
+                QMetaObject::invokeMethod(peer, &Transport::readyRead, Qt::QueuedConnection);
+        }
+    }
+
+    const qint64 n = data.size();
+    QMetaObject::invokeMethod(this, [this, n]() { emit bytesWritten(n); }, Qt::QueuedConnection);
+    return n;
+}
+
+QString MemoryPipeTransport::description() const
+{
+    return QStringLiteral("内存管道 %1（%2 端）").arg(m_name, m_side == 1 ? QStringLiteral("B") : QStringLiteral("A"));
+}
@@ -0,0 +1,40 @@
+#pragma once
+/**
+ * @file memorypipe.h
+ * @brief 进程内内存管道：mem://<name>
+ *
+ * 同名的两个端点组成一条全双工管道（先打开者为 A 端，后打开者为 B 端），
+ * 第三个端点打开会失败。两端可以位于不同线程：数据在互斥锁保护的缓冲里交换，
+ * readyRead/bytesWritten 通过 Qt::QueuedConnection 投递到各自线程。
+ * 用于单元联调与吞吐压测（不经过内核）。
+ */
+
+#include <QMutex>
+
+#include <memory>
+
+#include "transport.h"
+
+class MemoryPipeTransport : public Transport
+{
+    Q_OBJECT
+public:
+    explicit MemoryPipeTransport(const QString& name, QObject* parent = nullptr);
+    ~MemoryPipeTransport() override;
+
+    bool open(QString& errMsg) override;
+    void close() override;
+    bool isOpen() const override { return m_side >= 0; }
+    qint64 read(char* data, qint64 maxLen) override;
+    qint64 write(const QByteArray& data) override;
+    QString errorString() const override { return m_errorString; }
+    QString description() const override;
+
+    struct Pipe;
+
+private:
+    QString m_name;
+    std::shared_ptr<Pipe> m_pipe;
+    int m_side = -1;        ///< 0=A, 1=B, -1=未打开
+    QString m_errorString;
+};
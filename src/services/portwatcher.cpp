@@ -0,0 +1,214 @@
+/**
+ * @file portwatcher.cpp
+ * @brief Background serial port watcher: inotify on Linux, WM_DEVICECHANGE on Windows, slow poll otherwise.
+ */
+
+#include "portwatcher.h"
+
+#include <QSerialPortInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+    #include <sys/inotify.h>
+    #include <unistd.h>
+    #include <cstring>
+#endif
+
+#ifdef Q_OS_WIN
+    #include <QAbstractNativeEventFilter>
+    #include <QPointer>
+    #include <windows.h>
+    #include <dbt.h>
+#endif
+
+namespace
+{
+constexpr int kDebounceMs = 150;
+constexpr int kFallbackPollMs = 1000;
+
+#ifdef Q_OS_LINUX
+bool isPortNode(const char* name)
+{
+    // ttyS*, ttyUSB*, ttyACM*, ttyAMA*, rfcomm* ... but not the tty/ttyN consoles churn.
+    if (std::strncmp(name, "rfcomm", 6) == 0)
+        return true;
+    if (std::strncmp(name, "tty", 3) != 0)
+        return false;
+    const char* rest = name + 3;
+    while (*rest >= '0' && *rest <= '9')
+        ++rest;
+    return *rest != '\0'; // tty and ttyN are consoles
+}
+#endif
+
+#ifdef Q_OS_WIN
+class DeviceChangeFilter : public QAbstractNativeEventFilter
+{
+public:
+    explicit DeviceChangeFilter(PortWatcher* target) : m_target(target) {}
+
+    bool nativeEventFilter(const QByteArray& eventType, void* message, qintptr* result) override
+    {
+        Q_UNUSED(result);
+        if (eventType != "windows_generic_MSG")
+            return false;
+        const MSG* msg = static_cast<const MSG*>(message);
+        if (msg->message != WM_DEVICECHANGE)
+            return false;
+        if (msg->wParam == DBT_DEVICEARRIVAL || msg->wParam == DBT_DEVICEREMOVECOMPLETE
+            || msg->wParam == DBT_DEVNODES_CHANGED)
+        {
+            if (m_target)
+                QMetaObject::invokeMethod(m_target, &PortWatcher::scheduleRescan, Qt::QueuedConnection);
+        }
+        return false;
+    }
+
+private:
+    QPointer<PortWatcher> m_target;
+};
+#endif
+}
+
+PortWatcher::PortWatcher(QObject* parent)
+    : QObject(parent)
+{
+}
+
+PortWatcher::~PortWatcher()
+{
+    stopInotify();
+}
+
+QAbstractNativeEventFilter* PortWatcher::createDeviceChangeFilter(PortWatcher* target)
+{
+#ifdef Q_OS_WIN
+    return new DeviceChangeFilter(target);
+#else
+    Q_UNUSED(target);
+    return nullptr;
+#endif
+}
+
+void PortWatcher::start()
+{
+    // Timers are created here so they belong to the watcher thread.
+    m_debounce = new QTimer(this);
+    m_debounce->setSingleShot(true);
+    m_debounce->setInterval(kDebounceMs);
+    connect(m_debounce, &QTimer::timeout, this, &PortWatcher::onRescanTimer);
+
+#if defined(Q_OS_WIN)
+    // Driven by DeviceChangeFilter.
+#else
+    if (!startInotify())
+    {
+        m_poll = new QTimer(this);
+        m_poll->setInterval(kFallbackPollMs);
+        connect(m_poll, &QTimer::timeout, this, &PortWatcher::onRescanTimer);
+        m_poll->start();
+    }
+#endif
+
+    m_known = scan();
+}
+
+QStringList PortWatcher::scan() const
+{
+    QStringList ports;
+    const auto infos = QSerialPortInfo::availablePorts();
+    ports.reserve(infos.size());
+    for (const auto& info : infos)
+        ports << info.portName();
+    ports.sort();
+    return ports;
+}
+
+void PortWatcher::diffAndEmit(const QStringList& now)
+{
+    QStringList added, removed;
+    std::set_difference(now.cbegin(), now.cend(), m_known.cbegin(), m_known.cend(), std::back_inserter(added));
+    std::set_difference(m_known.cbegin(), m_known.cend(), now.cbegin(), now.cend(), std::back_inserter(removed));
+    m_known = now;
+
+    if (!removed.isEmpty())
+        emit portsRemoved(removed);
+    if (!added.isEmpty())
+        emit portsAdded(added);
+}
+
+void PortWatcher::rescanNow()
+{
+    const QStringList now = scan();
+    diffAndEmit(now);
+    emit portsListed(now);
+}
+
+void PortWatcher::scheduleRescan()
+{
+    if (m_debounce)
+        m_debounce->start();
+}
+
+void PortWatcher::onRescanTimer()
+{
+    diffAndEmit(scan());
+}
+
+bool PortWatcher::startInotify()
+{
+#ifdef Q_OS_LINUX
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0)
+        return false;
+    if (inotify_add_watch(m_inotifyFd, "/dev", IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB) < 0)
+    {
+        stopInotify();
+        return false;
+    }
+    m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &PortWatcher::onInotifyReadable);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PortWatcher::stopInotify()
+{
+#ifdef Q_OS_LINUX
+    delete m_notifier;
+    m_notifier = nullptr;
+    if (m_inotifyFd >= 0)
+    {
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+#endif
+}
+
+void PortWatcher::onInotifyReadable()
+{
+#ifdef Q_OS_LINUX
+    alignas(inotify_event) char buf[4096];
+    bool relevant = false;
+    while (true)
+    {
+        const ssize_t n = ::read(m_inotifyFd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        for (ssize_t off = 0; off < n;)
+        {
+            const auto* ev = reinterpret_cast<const inotify_event*>(buf + off);
+            if ((ev->mask & IN_Q_OVERFLOW) || (ev->len > 0 && isPortNode(ev->name)))
+                relevant = true;
+            off += ssize_t(sizeof(inotify_event) + ev->len);
+        }
+    }
+    if (relevant)
+        scheduleRescan();
+#endif
+}
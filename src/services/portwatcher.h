@@ -0,0 +1,69 @@
+#pragma once
+/**
+ * @file portwatcher.h
+ * @brief 串口热插拔监视：在后台线程枚举端口，只在变化时发出增删差异
+ *
+ * - Linux：inotify 监视 /dev 的 tty* 节点创建/删除，去抖后重新枚举
+ * - Windows：WM_DEVICECHANGE（由 GUI 线程的原生事件过滤器转发，见 createDeviceChangeFilter）
+ * - 其他平台或 inotify 不可用：后台线程低频轮询
+ *
+ * QSerialPortInfo::availablePorts() 只在监视线程上调用，不会卡 GUI。
+ */
+
+#include <QObject>
+#include <QStringList>
+
+class QAbstractNativeEventFilter;
+class QSocketNotifier;
+class QTimer;
+
+class PortWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PortWatcher(QObject* parent = nullptr);
+    ~PortWatcher() override;
+
+    /**
+     * @brief Windows 下返回转发 WM_DEVICECHANGE 的过滤器（由调用方在 GUI 线程安装/卸载）；其他平台返回 nullptr
+     */
+    static QAbstractNativeEventFilter* createDeviceChangeFilter(PortWatcher* target);
+
+public slots:
+    /**
+     * @brief 在监视线程上调用：建立 inotify/轮询并做首次枚举
+     */
+    void start();
+
+    /**
+     * @brief 立即枚举并发出完整列表（portsListed），有差异时同时发出增删
+     */
+    void rescanNow();
+
+    /**
+     * @brief 去抖后枚举（设备节点创建与权限设置往往分几次到达）
+     */
+    void scheduleRescan();
+
+signals:
+    void portsListed(const QStringList& ports);
+    void portsAdded(const QStringList& ports);
+    void portsRemoved(const QStringList& ports);
+
+private slots:
+    void onInotifyReadable();
+    void onRescanTimer();
+
+private:
+    bool startInotify();
+    void stopInotify();
+    QStringList scan() const;
+    void diffAndEmit(const QStringList& now);
+
+private:
+    QStringList m_known;   ///< 已排序
+    QTimer* m_debounce = nullptr;
+    QTimer* m_poll = nullptr;
+    int m_inotifyFd = -1;
+    QSocketNotifier* m_notifier = nullptr;
+};
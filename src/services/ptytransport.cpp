@@ -0,0 +1,180 @@
+/**
+ * @file ptytransport.cpp
+ * @brief PTY master transport driven by QSocketNotifier.
+ *
+ * write() only copies into the kernel (or m_pending when it is full); bytesWritten is
+ * always reported from the write notifier so the worker never sees it re-entrantly.
+ */
+
+#include "ptytransport.h"
+
+#ifdef Q_OS_UNIX
+
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr int kHangupPollMs = 100;
+}
+
+PtyTransport::PtyTransport(QObject* parent)
+    : Transport(parent)
+{
+}
+
+PtyTransport::~PtyTransport()
+{
+    close();
+}
+
+void PtyTransport::setErrnoError()
+{
+    m_errorString = QString::fromLocal8Bit(std::strerror(errno));
+}
+
+bool PtyTransport::open(QString& errMsg)
+{
+    close();
+
+    const int fd = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0 || ::grantpt(fd) != 0 || ::unlockpt(fd) != 0)
+    {
+        setErrnoError();
+        if (fd >= 0)
+            ::close(fd);
+        errMsg = m_errorString;
+        return false;
+    }
+
+    // Raw mode: the protocol relies on CRLF arriving untouched.
+    termios tio{};
+    if (::tcgetattr(fd, &tio) == 0)
+    {
+        ::cfmakeraw(&tio);
+        ::tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    const char* name = ::ptsname(fd);
+    m_slavePath = name ? QString::fromLocal8Bit(name) : QString();
+    m_fd = fd;
+
+    m_readNotifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_readNotifier, &QSocketNotifier::activated, this, &PtyTransport::onReadable);
+    m_writeNotifier = new QSocketNotifier(m_fd, QSocketNotifier::Write, this);
+    m_writeNotifier->setEnabled(false);
+    connect(m_writeNotifier, &QSocketNotifier::activated, this, &PtyTransport::onWritable);
+    return true;
+}
+
+void PtyTransport::close()
+{
+    delete m_readNotifier;
+    m_readNotifier = nullptr;
+    delete m_writeNotifier;
+    m_writeNotifier = nullptr;
+
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_pending.clear();
+    m_unreported = 0;
+}
+
+qint64 PtyTransport::read(char* data, qint64 maxLen)
+{
+    if (m_fd < 0)
+        return -1;
+
+    const ssize_t n = ::read(m_fd, data, size_t(maxLen));
+    if (n >= 0)
+        return n;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return 0;
+    // EIO: no process has the slave side open (yet); treat as "no data".
+    if (errno == EIO)
+    {
+        m_hangup = true;
+        return 0;
+    }
+    setErrnoError();
+    return -1;
+}
+
+qint64 PtyTransport::write(const QByteArray& data)
+{
+    if (m_fd < 0)
+    {
+        m_errorString = QStringLiteral("设备未打开");
+        return -1;
+    }
+
+    m_pending.append(data);
+    m_unreported += data.size();
+    m_writeNotifier->setEnabled(true);
+    return data.size();
+}
+
+void PtyTransport::flushPending()
+{
+    while (!m_pending.isEmpty())
+    {
+        const ssize_t n = ::write(m_fd, m_pending.constData(), size_t(m_pending.size()));
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+            setErrnoError();
+            m_pending.clear();
+            emit errorOccurred(m_errorString);
+            return;
+        }
+        m_pending.remove(0, qsizetype(n));
+    }
+}
+
+void PtyTransport::onWritable()
+{
+    flushPending();
+    if (!m_pending.isEmpty())
+        return;
+
+    m_writeNotifier->setEnabled(false);
+    const qint64 n = m_unreported;
+    m_unreported = 0;
+    if (n > 0)
+        emit bytesWritten(n);
+}
+
+void PtyTransport::onReadable()
+{
+    emit readyRead();
+
+    // The master stays readable (POLLHUP) while nobody holds the slave: poll slowly
+    // instead of spinning on the notifier.
+    if (m_hangup && m_readNotifier)
+    {
+        m_hangup = false;
+        m_readNotifier->setEnabled(false);
+        QTimer::singleShot(kHangupPollMs, this, [this]() {
+            if (m_readNotifier)
+                m_readNotifier->setEnabled(true);
+        });
+    }
+}
+
+QString PtyTransport::description() const
+{
+    return QStringLiteral("PTY %1").arg(m_slavePath);
+}
+
+#endif // Q_OS_UNIX
@@ -0,0 +1,54 @@
+#pragma once
+/**
+ * @file ptytransport.h
+ * @brief POSIX 伪终端传输：打开后上位机持有主端，模拟下位机连到 slavePath()
+ *
+ * 用于没有实物串口时的联调：description() 给出从端路径（例如 /dev/pts/5），
+ * 把固件模拟器或 `cat` 接到该路径即可。非 POSIX 平台由 Transport::create 拒绝。
+ */
+
+#include "transport.h"
+
+#ifdef Q_OS_UNIX
+
+class QSocketNotifier;
+
+class PtyTransport : public Transport
+{
+    Q_OBJECT
+public:
+    explicit PtyTransport(QObject* parent = nullptr);
+    ~PtyTransport() override;
+
+    bool open(QString& errMsg) override;
+    void close() override;
+    bool isOpen() const override { return m_fd >= 0; }
+    qint64 read(char* data, qint64 maxLen) override;
+    qint64 write(const QByteArray& data) override;
+    QString errorString() const override { return m_errorString; }
+    QString description() const override;
+
+    QString slavePath() const { return m_slavePath; }
+
+private slots:
+    void onReadable();
+    void onWritable();
+
+private:
+    void setErrnoError();
+    void flushPending();
+
+private:
+    int m_fd = -1;
+    QString m_slavePath;
+    QString m_errorString;
+    QSocketNotifier* m_readNotifier = nullptr;
+    QSocketNotifier* m_writeNotifier = nullptr;
+
+    // 内核缓冲满时暂存；写空后统一回报 bytesWritten
+    QByteArray m_pending;
+    qint64 m_unreported = 0;
+    bool m_hangup = false;
+};
+
+#endif // Q_OS_UNIX
@@ -0,0 +1,65 @@
+#include "serialporttransport.h"
+
+SerialPortTransport::SerialPortTransport(const QString& portName, const SerialParams& params, QObject* parent)
+    : IoDeviceTransport(parent)
+    , m_port(this)
+    , m_params(params)
+{
+    attachDevice(&m_port);
+    m_port.setPortName(portName);
+    connect(&m_port, &QSerialPort::errorOccurred, this, &SerialPortTransport::onPortErrorOccurred);
+}
+
+QSerialPort::Parity SerialPortTransport::parseParity(const QString& parityText)
+{
+    const QString p = parityText.trimmed().toLower();
+    if (p == "even") return QSerialPort::EvenParity;
+    if (p == "odd")  return QSerialPort::OddParity;
+    return QSerialPort::NoParity;
+}
+
+QSerialPort::DataBits SerialPortTransport::parseDataBits(int dataBits)
+{
+    if (dataBits == 7) return QSerialPort::Data7;
+    return QSerialPort::Data8;
+}
+
+QSerialPort::StopBits SerialPortTransport::parseStopBits(int stopBits)
+{
+    if (stopBits == 2) return QSerialPort::TwoStop;
+    return QSerialPort::OneStop;
+}
+
+bool SerialPortTransport::open(QString& errMsg)
+{
+    m_port.setBaudRate(m_params.baud);
+    m_port.setDataBits(parseDataBits(m_params.dataBits));
+    m_port.setParity(parseParity(m_params.parityText));
+    m_port.setStopBits(parseStopBits(m_params.stopBits));
+    m_port.setFlowControl(QSerialPort::NoFlowControl);
+
+    if (!m_port.open(QIODevice::ReadWrite))
+    {
+        errMsg = m_port.errorString();
+        return false;
+    }
+    return true;
+}
+
+void SerialPortTransport::close()
+{
+    if (m_port.isOpen())
+        m_port.close();
+}
+
+QString SerialPortTransport::description() const
+{
+    return QStringLiteral("串口 %1 @ %2").arg(m_port.portName()).arg(m_params.baud);
+}
+
+void SerialPortTransport::onPortErrorOccurred(QSerialPort::SerialPortError e)
+{
+    if (e == QSerialPort::NoError)
+        return;
+    emit errorOccurred(m_port.errorString());
+}
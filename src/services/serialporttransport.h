@@ -0,0 +1,32 @@
+#pragma once
+/**
+ * @file serialporttransport.h
+ * @brief 真实串口传输（QSerialPort）
+ */
+
+#include <QSerialPort>
+
+#include "transport.h"
+
+class SerialPortTransport : public IoDeviceTransport
+{
+    Q_OBJECT
+public:
+    SerialPortTransport(const QString& portName, const SerialParams& params, QObject* parent = nullptr);
+
+    bool open(QString& errMsg) override;
+    void close() override;
+    QString description() const override;
+
+private slots:
+    void onPortErrorOccurred(QSerialPort::SerialPortError e);
+
+private:
+    static QSerialPort::Parity parseParity(const QString& parityText);
+    static QSerialPort::DataBits parseDataBits(int dataBits);
+    static QSerialPort::StopBits parseStopBits(int stopBits);
+
+private:
+    QSerialPort m_port;
+    SerialParams m_params;
+};
@@ -1,51 +1,168 @@
 /**
  * @file serialservice.cpp
  * @brief Serial service: enumerate ports, open/close, send/receive with CRLF framing.
+ *
+ * The port itself lives in SerialWorker, either on the caller's thread (direct mode)
+ * or on a dedicated QThread (threaded mode). Frames cross over through SerialChannel.
  */
 
 #include "serialservice.h"
 
-#include <QSerialPortInfo>
+#include "portwatcher.h"
+
+#include "../core/hostclock.h"
+
+#include <QAbstractNativeEventFilter>
+#include <QCoreApplication>
+#include <QMetaMethod>
+#include <QThread>
+
+namespace
+{
+constexpr std::size_t kFrameQueueCapacity = 1024;
+}
 
 SerialService::SerialService(QObject *parent)
     : QObject(parent)
+    , m_channel(kFrameQueueCapacity)
 {
-    connect(&m_port, &QSerialPort::readyRead, this, &SerialService::onReadyRead);
+    startWorker(false);
+}
 
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
-    connect(&m_port, &QSerialPort::errorOccurred, this, &SerialService::onPortErrorOccurred);
-#else
-    connect(&m_port, SIGNAL(error(QSerialPort::SerialPortError)), this, SLOT(onPortErrorOccurred(QSerialPort::SerialPortError)));
-#endif
+SerialService::~SerialService()
+{
+    setPortWatchEnabled(false);
+    stopWorker();
 }
 
-void SerialService::refreshPorts()
+void SerialService::setPortWatchEnabled(bool on)
 {
-    QStringList ports;
-    const auto infos = QSerialPortInfo::availablePorts();
-    for (const auto& info : infos)
-        ports << info.portName();
-    emit portsUpdated(ports);
+    if (on == isPortWatchEnabled())
+        return;
+
+    if (!on)
+    {
+        if (m_deviceChangeFilter && QCoreApplication::instance())
+            QCoreApplication::instance()->removeNativeEventFilter(m_deviceChangeFilter.get());
+        m_deviceChangeFilter.reset();
+
+        m_portWatcher->disconnect(this);
+        m_portThread->quit();
+        m_portThread->wait(); // watcher is deleted via QThread::finished -> deleteLater
+        delete m_portThread;
+        m_portThread = nullptr;
+        m_portWatcher = nullptr;
+        return;
+    }
+
+    m_portWatcher = new PortWatcher();
+    m_portThread = new QThread(this);
+    m_portThread->setObjectName(QStringLiteral("PortWatch"));
+    m_portWatcher->moveToThread(m_portThread);
+    connect(m_portThread, &QThread::started, m_portWatcher, &PortWatcher::start);
+    connect(m_portThread, &QThread::finished, m_portWatcher, &QObject::deleteLater);
+    connect(m_portWatcher, &PortWatcher::portsListed, this, &SerialService::portsUpdated);
+    connect(m_portWatcher, &PortWatcher::portsAdded, this, &SerialService::portsAdded);
+    connect(m_portWatcher, &PortWatcher::portsRemoved, this, &SerialService::portsRemoved);
+    m_portThread->start(QThread::LowPriority);
+
+    m_deviceChangeFilter.reset(PortWatcher::createDeviceChangeFilter(m_portWatcher));
+    if (m_deviceChangeFilter && QCoreApplication::instance())
+        QCoreApplication::instance()->installNativeEventFilter(m_deviceChangeFilter.get());
+}
+
+void SerialService::startWorker(bool threaded)
+{
+    m_worker = new SerialWorker(&m_channel);
+
+    if (threaded)
+    {
+        m_thread = new QThread(this);
+        m_thread->setObjectName(QStringLiteral("SerialIO"));
+        m_worker->moveToThread(m_thread);
+        connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    }
+
+    // Worker -> service signals are queued in threaded mode (AutoConnection).
+    connect(m_worker, &SerialWorker::opened, this, [this](bool ok, const QString& err) {
+        if (!ok)
+            m_openRequested = false;
+        emit opened(ok, err);
+    });
+    connect(m_worker, &SerialWorker::closed, this, [this]() {
+        m_openRequested = false;
+        emit closed();
+    });
+    connect(m_worker, &SerialWorker::transportReady, this, &SerialService::transportReady);
+    connect(m_worker, &SerialWorker::error, this, &SerialService::error);
+    connect(m_worker, &SerialWorker::rxPending, this, &SerialService::onRxPending);
+    connect(m_worker, &SerialWorker::txWritten, this, &SerialService::onTxWritten);
+    connect(m_worker, &SerialWorker::txCompleted, this, &SerialService::txCompleted);
+
+    if (m_thread)
+        m_thread->start(QThread::HighestPriority);
+
+    setTxLimits(m_txMaxInFlightBytes, m_txCoalesceBytes);
+}
+
+void SerialService::stopWorker()
+{
+    if (!m_worker)
+        return;
+
+    if (m_thread)
+    {
+        if (m_worker->isOpen())
+            QMetaObject::invokeMethod(m_worker, &SerialWorker::closePort, Qt::BlockingQueuedConnection);
+        m_worker->disconnect(this);
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread; // worker is deleted via QThread::finished -> deleteLater
+        m_thread = nullptr;
+    }
+    else
+    {
+        m_worker->disconnect(this);
+        if (m_worker->isOpen())
+            m_worker->closePort();
+        delete m_worker;
+    }
+    m_worker = nullptr;
+    m_openRequested = false;
+
+    // Both sides are stopped now; drop leftovers.
+    SerialFrame dropped;
+    while (m_channel.tx.pop(dropped)) {}
+    while (m_channel.rx.pop(dropped)) {}
+    m_channel.txWake.store(false);
+    m_channel.rxWake.store(false);
 }
 
-QSerialPort::Parity SerialService::parseParity(const QString& parityText)
+void SerialService::setThreadedIo(bool on)
 {
-    const QString p = parityText.trimmed().toLower();
-    if (p == "even") return QSerialPort::EvenParity;
-    if (p == "odd")  return QSerialPort::OddParity;
-    return QSerialPort::NoParity;
+    if (on == isThreadedIo())
+        return;
+    if (isOpen())
+    {
+        emit error(QStringLiteral("串口打开时不能切换 I/O 线程模式"));
+        return;
+    }
+
+    stopWorker();
+    startWorker(on);
 }
 
-QSerialPort::DataBits SerialService::parseDataBits(int dataBits)
+Qt::ConnectionType SerialService::workerCallType() const
 {
-    if (dataBits == 7) return QSerialPort::Data7;
-    return QSerialPort::Data8;
+    return m_thread ? Qt::QueuedConnection : Qt::DirectConnection;
 }
 
-QSerialPort::StopBits SerialService::parseStopBits(int stopBits)
+void SerialService::refreshPorts()
 {
-    if (stopBits == 2) return QSerialPort::TwoStop;
-    return QSerialPort::OneStop;
+    if (!m_portWatcher)
+        return;
+    // Queued behind PortWatcher::start(), so the first listing is never missed.
+    QMetaObject::invokeMethod(m_portWatcher, &PortWatcher::rescanNow, Qt::QueuedConnection);
 }
 
 void SerialService::openPort(const QString &portName,
@@ -54,96 +171,96 @@ void SerialService::openPort(const QString &portName,
                              const QString &parityText,
                              int stopBits)
 {
-    if (m_port.isOpen())
-        m_port.close();
+    m_openRequested = true; // frames sent from here on are drained once the port is up
+    SerialWorker* w = m_worker;
+    QMetaObject::invokeMethod(w, [=]() {
+        w->openPort(portName, baud, dataBits, parityText, stopBits);
+    }, workerCallType());
+}
 
-    m_port.setPortName(portName);
-    m_port.setBaudRate(baud);
-    m_port.setDataBits(parseDataBits(dataBits));
-    m_port.setParity(parseParity(parityText));
-    m_port.setStopBits(parseStopBits(stopBits));
-    m_port.setFlowControl(QSerialPort::NoFlowControl);
+void SerialService::closePort()
+{
+    m_openRequested = false;
+    QMetaObject::invokeMethod(m_worker, &SerialWorker::closePort, workerCallType());
+}
 
-    if (!m_port.open(QIODevice::ReadWrite))
-    {
-        emit opened(false, QStringLiteral("打开串口失败：%1").arg(m_port.errorString()));
-        return;
-    }
+void SerialService::setTxLimits(int maxInFlightBytes, int coalesceBytes)
+{
+    m_txMaxInFlightBytes = maxInFlightBytes;
+    m_txCoalesceBytes = coalesceBytes;
+    SerialWorker* w = m_worker;
+    QMetaObject::invokeMethod(w, [=]() {
+        w->setTxLimits(maxInFlightBytes, coalesceBytes);
+    }, workerCallType());
+}
 
-    m_rxBuffer.clear();
-    emit opened(true, QString());
+quint64 SerialService::sendFrame(const QString &frame)
+{
+    return sendBytes(frame.toUtf8());
 }
 
-void SerialService::closePort()
+quint64 SerialService::sendBytes(const QByteArray &frame)
 {
-    if (!m_port.isOpen())
-    {
-        emit closed();
-        return;
-    }
+    SerialFrame f;
+    f.data = frame;
+    if (!f.data.endsWith("\r\n"))
+        f.data.append("\r\n");
+    return enqueueTx(std::move(f));
+}
 
-    m_port.close();
-    m_rxBuffer.clear();
-    emit closed();
+quint64 SerialService::sendBinary(const QByteArray &frame)
+{
+    SerialFrame f;
+    f.data = frame;
+    f.binary = true;
+    return enqueueTx(std::move(f));
 }
 
-void SerialService::sendFrame(const QString &frame)
+quint64 SerialService::enqueueTx(SerialFrame &&f)
 {
-    if (!m_port.isOpen())
+    if (!isOpen() && !m_openRequested)
     {
         emit error(QStringLiteral("串口未打开，无法发送"));
-        return;
+        return 0;
     }
 
-    QString payload = frame;
-    if (!payload.endsWith(QStringLiteral("\r\n")))
-        payload += QStringLiteral("\r\n");
-
-    const QByteArray data = payload.toUtf8();
-    const qint64 n = m_port.write(data);
-    if (n < 0)
+    const quint64 id = m_nextFrameId;
+    f.hostNs = HostClock::nowNs();
+    f.id = id;
+    if (!m_channel.tx.push(std::move(f)))
     {
-        emit error(QStringLiteral("串口发送失败：%1").arg(m_port.errorString()));
-        return;
+        emit error(QStringLiteral("发送队列已满，帧已丢弃"));
+        return 0;
     }
+    ++m_nextFrameId;
 
-    emit txRaw(payload.trimmed());
+    if (!m_channel.txWake.exchange(true, std::memory_order_acq_rel))
+        QMetaObject::invokeMethod(m_worker, &SerialWorker::drainTx, workerCallType());
+    return id;
 }
 
-void SerialService::onReadyRead()
+void SerialService::onRxPending()
 {
-    if (!m_port.isOpen())
-        return;
+    m_channel.rxWake.store(false, std::memory_order_release);
 
-    m_rxBuffer.append(m_port.readAll());
+    static const QMetaMethod rxRawSignal = QMetaMethod::fromSignal(&SerialService::rxRaw);
+    static const QMetaMethod rxFrameSignal = QMetaMethod::fromSignal(&SerialService::rxFrame);
+    const bool wantText = isSignalConnected(rxRawSignal) || isSignalConnected(rxFrameSignal);
 
-    // CRLF framing
-    while (true)
+    SerialFrame f;
+    while (m_channel.rx.pop(f))
     {
-        const int end = m_rxBuffer.indexOf('\n');
-        if (end < 0)
-        {
-            if (m_rxBuffer.size() > 8192)
-            {
-                m_rxBuffer.clear();
-                emit error(QStringLiteral("接收缓冲过长，已清空"));
-            }
-            return;
-        }
-
-        const QByteArray line = m_rxBuffer.left(end + 1);
-        m_rxBuffer.remove(0, end + 1);
-
-        const QString frame = QString::fromUtf8(line).trimmed();
-        if (!frame.isEmpty())
-            emit rxRaw(frame);
+        emit rxLine(f.data, f.hostNs);
+        if (!wantText)
+            continue;
+        const QString frame = QString::fromUtf8(f.data);
+        emit rxRaw(frame);
+        emit rxFrame(frame, f.hostNs);
     }
 }
 
-void SerialService::onPortErrorOccurred(QSerialPort::SerialPortError e)
+void SerialService::onTxWritten(const QString &frame, qint64 hostNs)
 {
-    if (e == QSerialPort::NoError)
-        return;
-
-    emit error(QStringLiteral("串口错误：%1").arg(m_port.errorString()));
+    emit txRaw(frame);
+    emit txFrame(frame, hostNs);
 }
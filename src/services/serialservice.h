@@ -8,6 +8,14 @@
  * - 下位机分动作指令；回包 *E 表示动作完成（带错误信息）
  * - 这里负责“字节流 -> 帧字符串”的切帧（按 '*' ... '#'）
  *
+ * 🧵 线程模式（setThreadedIo(true)）：
+ * - QSerialPort 由 SerialWorker 持有，运行在独立 QThread 上
+ * - TX/RX 帧经 SPSC 环形队列跨线程，GUI 重绘不会推迟 WORK 下发或 STEPRUN 上报
+ * - 每帧带主机时间戳（HostClock::nowNs），见 rxFrame/txFrame
+ * - 打开/关闭为异步：以 opened/closed 信号为准
+ *
+ * 🔌 传输层：portName 也可以是 "pty" / "tcp://host:port" / "mem://name"（见 transport.h）
+ *
  * ⚠️ 你之前报过：
  *   Use of undeclared identifier 'QShortcut'
  * 这类错误通常是头文件没 include。
@@ -21,22 +29,45 @@
 #include <QString>
 #include <QStringList>
 
-#include <QSerialPort>
+#include <memory>
+
+#include "serialworker.h"
+
+class PortWatcher;
+class QAbstractNativeEventFilter;
+class QThread;
 
 class SerialService : public QObject
 {
     Q_OBJECT
 public:
     explicit SerialService(QObject* parent = nullptr);
+    ~SerialService() override;
+
+    /**
+     * @brief 切换 I/O 线程模式（仅在串口关闭时生效）
+     * @param on true=端口运行在独立 I/O 线程；false=与 GUI 同线程（旧行为）
+     */
+    void setThreadedIo(bool on);
+    bool isThreadedIo() const { return m_thread != nullptr; }
 
     /**
-     * @brief 枚举串口端口名（例如 COM3）
+     * @brief 开关端口监视线程（默认关闭）：开启后枚举与插拔检测才可用
+     * @note 只有需要端口下拉框的界面开启；多治具的其余端口、命令行运行器不需要
+     */
+    void setPortWatchEnabled(bool on);
+    bool isPortWatchEnabled() const { return m_portWatcher != nullptr; }
+
+    /**
+     * @brief 枚举串口端口名（例如 COM3），结果经 portsUpdated 异步返回
+     * @note 枚举在端口监视线程上进行；插拔变化由 portsAdded/portsRemoved 自动上报，无需轮询
+     *       未开启端口监视时不做任何事
      */
     void refreshPorts();
 
     /**
      * @brief 打开串口
-     * @param portName 例如 "COM3"
+     * @param portName 例如 "COM3"；或 "pty" / "tcp://127.0.0.1:5555" / "mem://sim"
      * @param baud 波特率
      * @param dataBits 7/8
      * @param parityText "None"/"Even"/"Odd"
@@ -53,42 +84,89 @@ public:
      */
     void closePort();
 
-    bool isOpen() const { return m_port.isOpen(); }
+    bool isOpen() const { return m_worker && m_worker->isOpen(); }
 
     /**
      * @brief 发送一条已打包好的帧（形如 "*L,1,ALL,350,0,5,1,2,3,4,5#"）
      * @note 这里不做协议层校验（由 Protocol 负责）；SerialService 只负责发送与回显信号
      */
-    void sendFrame(const QString& frame);
+    quint64 sendFrame(const QString& frame);
+
+    /**
+     * @brief 发送已编码好的字节帧（应以 CRLF 结尾，缺失时自动补上）
+     * @note 与 Protocol::FrameWriter 配合：TX 路径不再经过 QString/UTF-8 转码；
+     *       QByteArray 隐式共享入队，不做深拷贝
+     * @return 帧编号（与 txCompleted 对应）；0 表示未入队
+     * @note openPort 之后、opened 之前发送的帧先留在队列里，打开成功后按序写出；打开失败则丢弃
+     */
+    quint64 sendBytes(const QByteArray& frame);
+
+    /**
+     * @brief 发送二进制帧（binaryframe.h），原样入队，不补 CRLF
+     * @return 帧编号；0 表示未入队
+     */
+    quint64 sendBinary(const QByteArray& frame);
+
+    /**
+     * @brief TX 队列限额
+     * @param maxInFlightBytes 已交给端口但尚未写出的字节上限（背压阈值）
+     * @param coalesceBytes 连续小帧合并为一次 write 的上限（0=不合并）
+     */
+    void setTxLimits(int maxInFlightBytes, int coalesceBytes);
 
 signals:
-    // 端口枚举完成
+    // 端口枚举完成（完整列表，响应 refreshPorts）
     void portsUpdated(const QStringList& ports);
 
+    // 热插拔差异（端口监视线程检测到变化时）
+    void portsAdded(const QStringList& ports);
+    void portsRemoved(const QStringList& ports);
+
     // 打开/关闭
     void opened(bool ok, const QString& err);
     void closed();
 
+    // 传输已打开，description 为人类可读描述（例如 "PTY /dev/pts/5"）
+    void transportReady(const QString& description);
+
     // 原始帧收发（已切帧）
     void rxRaw(const QString& frame);
     void txRaw(const QString& frame);
 
+    // 同上，附主机时间戳：RX=从端口读出时刻，TX=交给端口写出时刻
+    void rxFrame(const QString& frame, qint64 hostNs);
+
+    // RX 原始字节行（不含 CRLF，不做 QString 转码）；rxRaw/rxFrame 无人连接时不再构造 QString
+    void rxLine(const QByteArray& line, qint64 hostNs);
+    void txFrame(const QString& frame, qint64 hostNs);
+
+    // 帧 frameId 的全部字节已写出端口（hostNs 为 bytesWritten 回报时刻）
+    void txCompleted(quint64 frameId, qint64 hostNs);
+
     // 串口错误
     void error(const QString& err);
 
 private slots:
-    void onReadyRead();
-    void onPortErrorOccurred(QSerialPort::SerialPortError e);
+    void onRxPending();
+    void onTxWritten(const QString& frame, qint64 hostNs);
 
 private:
-    // parity 解析
-    static QSerialPort::Parity parseParity(const QString& parityText);
-    static QSerialPort::DataBits parseDataBits(int dataBits);
-    static QSerialPort::StopBits parseStopBits(int stopBits);
+    quint64 enqueueTx(SerialFrame&& f);
+    void startWorker(bool threaded);
+    void stopWorker();
+    Qt::ConnectionType workerCallType() const;
 
 private:
-    QSerialPort m_port;
-
-    // 切帧缓冲（字节流 -> 多帧）
-    QByteArray m_rxBuffer;
+    SerialChannel m_channel;
+    SerialWorker* m_worker = nullptr;
+    QThread* m_thread = nullptr;
+
+    PortWatcher* m_portWatcher = nullptr;
+    QThread* m_portThread = nullptr;
+    std::unique_ptr<QAbstractNativeEventFilter> m_deviceChangeFilter;
+
+    quint64 m_nextFrameId = 1;
+    bool m_openRequested = false;  ///< openPort 已调用、尚未失败/关闭：此时入队的帧在打开后写出
+    int m_txMaxInFlightBytes = 4096;
+    int m_txCoalesceBytes = 512;
 };
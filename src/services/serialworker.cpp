@@ -0,0 +1,268 @@
+/**
+ * @file serialworker.cpp
+ * @brief Serial I/O worker: owns the Transport, writes queued frames and splits RX into CRLF lines.
+ */
+
+#include "serialworker.h"
+
+#include "transport.h"
+
+#include "../core/hostclock.h"
+
+SerialWorker::SerialWorker(SerialChannel* channel, QObject* parent)
+    : QObject(parent)
+    , m_channel(channel)
+    , m_framer(8192)
+{
+    m_readBuf.resize(4096);
+    m_txBatch.reserve(m_coalesceBytes);
+}
+
+bool SerialWorker::transportOpen() const
+{
+    return m_transport && m_transport->isOpen();
+}
+
+void SerialWorker::releaseTransport()
+{
+    if (!m_transport)
+        return;
+    m_transport->disconnect(this);
+    m_transport->close();
+    // May be inside one of its own signal emissions.
+    m_transport->deleteLater();
+    m_transport = nullptr;
+}
+
+void SerialWorker::openPort(const QString& portName,
+                            int baud,
+                            int dataBits,
+                            const QString& parityText,
+                            int stopBits)
+{
+    m_open.store(false, std::memory_order_release);
+    if (m_transport)
+    {
+        // Re-open over an open or still-connecting port: its queue goes with it.
+        releaseTransport();
+        discardTx();
+    }
+
+    SerialParams params;
+    params.baud = baud;
+    params.dataBits = dataBits;
+    params.parityText = parityText;
+    params.stopBits = stopBits;
+
+    QString err;
+    Transport* t = Transport::create(portName, params, this, err);
+    if (!t)
+    {
+        discardTx();
+        emit opened(false, QStringLiteral("打开串口失败：%1").arg(err));
+        return;
+    }
+    if (!t->open(err))
+    {
+        delete t;
+        discardTx();
+        emit opened(false, QStringLiteral("打开串口失败：%1").arg(err));
+        return;
+    }
+
+    m_transport = t;
+    connect(t, &Transport::readyRead, this, &SerialWorker::onReadyRead);
+    connect(t, &Transport::bytesWritten, this, &SerialWorker::onBytesWritten);
+    connect(t, &Transport::errorOccurred, this, &SerialWorker::onTransportError);
+
+    if (t->isOpen())
+        onTransportConnected();
+    else
+        connect(t, &Transport::connected, this, &SerialWorker::onTransportConnected); // e.g. TCP connect
+}
+
+void SerialWorker::onTransportConnected()
+{
+    m_framer.reset();
+    resetTx();
+    m_open.store(true, std::memory_order_release);
+    emit transportReady(m_transport->description());
+    emit opened(true, QString());
+
+    // Frames queued while the open request was in flight.
+    drainTx();
+}
+
+void SerialWorker::closePort()
+{
+    m_open.store(false, std::memory_order_release);
+    releaseTransport();
+    m_framer.reset();
+    discardTx();
+
+    emit closed();
+}
+
+void SerialWorker::discardTx()
+{
+    // Frames queued for a port that is gone (or never came up) must not reach the next one.
+    m_channel->txWake.store(false, std::memory_order_release);
+    SerialFrame dropped;
+    while (m_channel->tx.pop(dropped)) {}
+    resetTx();
+}
+
+void SerialWorker::resetTx()
+{
+    m_inFlight.clear();
+    m_txHead = SerialFrame();
+    m_haveTxHead = false;
+    m_bytesQueued = 0;
+    m_bytesDrained = 0;
+}
+
+void SerialWorker::setTxLimits(int maxInFlightBytes, int coalesceBytes)
+{
+    m_maxInFlightBytes = qMax(1, maxInFlightBytes);
+    m_coalesceBytes = qMax(0, coalesceBytes);
+    m_txBatch.reserve(m_coalesceBytes);
+    drainTx();
+}
+
+void SerialWorker::drainTx()
+{
+    m_channel->txWake.store(false, std::memory_order_release);
+    if (m_transport && !isOpen())
+        return; // still connecting: onTransportConnected drains
+
+    while (true)
+    {
+        const qint64 inFlight = m_bytesQueued - m_bytesDrained;
+        const int firstBatchIndex = int(m_inFlight.size());
+        m_txBatch.truncate(0);
+
+        while (true)
+        {
+            if (!m_haveTxHead)
+            {
+                if (!m_channel->tx.pop(m_txHead))
+                    break;
+                m_haveTxHead = true;
+            }
+            if (!transportOpen())
+            {
+                m_haveTxHead = false; // port went away: drop
+                continue;
+            }
+
+            const qint64 frameSize = m_txHead.data.size();
+            const qint64 batchSize = m_txBatch.size();
+            if (batchSize > 0 && batchSize + frameSize > m_coalesceBytes)
+                break;
+            // An oversized frame still goes out alone once nothing else is in flight.
+            if (inFlight + batchSize + frameSize > m_maxInFlightBytes && (inFlight + batchSize) > 0)
+                break;
+
+            m_txBatch.append(m_txHead.data);
+            m_inFlight.push_back({m_txHead.id, m_bytesQueued + m_txBatch.size()});
+            m_batchFrames.push_back(std::move(m_txHead));
+            m_txHead = SerialFrame();
+            m_haveTxHead = false;
+        }
+
+        if (m_txBatch.isEmpty())
+            return;
+
+        const qint64 n = m_transport->write(m_txBatch);
+        if (n != m_txBatch.size())
+        {
+            emit error(QStringLiteral("串口发送失败：%1").arg(m_transport->errorString()));
+            // These frames will never report completion.
+            m_inFlight.erase(m_inFlight.begin() + firstBatchIndex, m_inFlight.end());
+            m_batchFrames.clear();
+            return;
+        }
+        m_bytesQueued += n;
+
+        const qint64 hostNs = HostClock::nowNs();
+        for (const auto& f : m_batchFrames)
+        {
+            if (f.binary)
+                emit txWritten(QStringLiteral("[BIN %1] %2").arg(f.data.size())
+                                   .arg(QString::fromLatin1(f.data.toHex(' ').toUpper())), hostNs);
+            else
+                emit txWritten(QString::fromUtf8(f.data).trimmed(), hostNs);
+        }
+        m_batchFrames.clear();
+    }
+}
+
+void SerialWorker::onBytesWritten(qint64 bytes)
+{
+    m_bytesDrained += bytes;
+
+    const qint64 hostNs = HostClock::nowNs();
+    while (!m_inFlight.empty() && m_inFlight.front().endOffset <= m_bytesDrained)
+    {
+        emit txCompleted(m_inFlight.front().id, hostNs);
+        m_inFlight.pop_front();
+    }
+
+    if (m_haveTxHead || !m_channel->tx.isEmpty())
+        drainTx();
+}
+
+void SerialWorker::pushRx(QByteArray&& line, qint64 hostNs)
+{
+    SerialFrame f;
+    f.data = std::move(line);
+    f.hostNs = hostNs;
+    if (!m_channel->rx.push(std::move(f)))
+    {
+        emit error(QStringLiteral("接收队列已满，丢弃一帧"));
+        return;
+    }
+
+    if (!m_channel->rxWake.exchange(true, std::memory_order_acq_rel))
+        emit rxPending();
+}
+
+void SerialWorker::onReadyRead()
+{
+    if (!transportOpen())
+        return;
+
+    const qint64 hostNs = HostClock::nowNs();
+    const quint64 overflowsBefore = m_framer.overflowCount();
+    const quint64 droppedBefore = m_framer.droppedBytes();
+
+    // CRLF framing straight out of the read buffer; only the frame itself is copied.
+    auto sink = [&](QByteArrayView line) { pushRx(line.toByteArray(), hostNs); };
+    while (true)
+    {
+        const qint64 n = m_transport->read(m_readBuf.data(), m_readBuf.size());
+        if (n <= 0)
+            break;
+        m_framer.feed(m_readBuf.constData(), n, sink);
+    }
+
+    if (m_framer.overflowCount() != overflowsBefore)
+    {
+        emit error(QStringLiteral("接收行超过 %1 字节，已丢弃 %2 字节")
+                       .arg(m_framer.capacity())
+                       .arg(m_framer.droppedBytes() - droppedBefore));
+    }
+}
+
+void SerialWorker::onTransportError(const QString& err)
+{
+    if (m_transport && !isOpen())
+    {
+        // The asynchronous open failed.
+        releaseTransport();
+        discardTx();
+        emit opened(false, QStringLiteral("打开串口失败：%1").arg(err));
+        return;
+    }
+    emit error(QStringLiteral("串口错误：%1").arg(err));
+}
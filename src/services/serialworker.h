@@ -0,0 +1,142 @@
+#pragma once
+/**
+ * @file serialworker.h
+ * @brief 串口 I/O 工作对象：持有 Transport，负责实际写出、读取与 CRLF 切帧（LineFramer）
+ *
+ * 端口名即传输描述（见 transport.h）：真实串口、pty、tcp://、mem:// 走同一条收发路径
+ *
+ * - 直连模式：与 SerialService 同处 GUI 线程，信号为直接调用
+ * - 线程模式：被 SerialService 移到独立 QThread；与 GUI 线程之间只通过
+ *   SerialChannel 里的两条 SPSC 队列交换帧，跨线程只投递“有新数据”的唤醒
+ */
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <deque>
+
+#include "lineframer.h"
+#include "spscqueue.h"
+
+class Transport;
+
+/**
+ * @brief 一帧数据 + 主机时间戳（HostClock::nowNs）
+ * - TX：data 为完整负载（含 CRLF），hostNs 为入队时间，id 由 SerialService 分配
+ * - RX：data 为去掉 CRLF 的一行，hostNs 为从端口读出的时间
+ */
+struct SerialFrame
+{
+    QByteArray data;
+    qint64 hostNs = 0;
+    quint64 id = 0;
+    bool binary = false;   ///< TX：二进制帧（binaryframe.h），回显时按十六进制显示
+};
+
+/**
+ * @brief GUI 线程与 I/O 线程共享的队列与唤醒标志（由 SerialService 持有）
+ *
+ * txWake/rxWake 保证每批数据只投递一次跨线程唤醒：生产者 push 后
+ * exchange(true) 得到 false 才唤醒；消费者先 store(false) 再 pop 到空。
+ */
+struct SerialChannel
+{
+    explicit SerialChannel(std::size_t capacity) : tx(capacity), rx(capacity) {}
+
+    SpscQueue<SerialFrame> tx;   ///< GUI -> I/O
+    SpscQueue<SerialFrame> rx;   ///< I/O -> GUI
+    std::atomic<bool> txWake{false};
+    std::atomic<bool> rxWake{false};
+};
+
+class SerialWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SerialWorker(SerialChannel* channel, QObject* parent = nullptr);
+
+    /**
+     * @brief 线程安全：任意线程可读
+     */
+    bool isOpen() const { return m_open.load(std::memory_order_acquire); }
+
+public slots:
+    /**
+     * @param portName 传输描述：串口名 / "pty" / "tcp://host:port" / "mem://name"
+     */
+    void openPort(const QString& portName,
+                  int baud,
+                  int dataBits,
+                  const QString& parityText,
+                  int stopBits);
+    void closePort();
+
+    /**
+     * @brief 取 TX 队列并写出（由 SerialService 在 txWake 置位时投递）
+     *
+     * 在途字节（已交给端口、尚未 bytesWritten 回报）不超过 maxInFlightBytes；
+     * 超出时帧留在 SPSC 队列里，队列满即对生产者形成背压。
+     * 连续的小帧合并为一次 write，单次合并不超过 coalesceBytes。
+     */
+    void drainTx();
+
+    void setTxLimits(int maxInFlightBytes, int coalesceBytes);
+
+signals:
+    void opened(bool ok, const QString& err);
+    void closed();
+
+    // 传输已打开（description 例如 "PTY /dev/pts/5"）
+    void transportReady(const QString& description);
+    void error(const QString& err);
+
+    // RX 队列由空变为非空
+    void rxPending();
+
+    // 一帧已交给端口写出（frame 已去掉 CRLF；二进制帧为 "[BIN n] 十六进制"）
+    void txWritten(const QString& frame, qint64 hostNs);
+
+    // 一帧的全部字节已由端口写出到系统驱动（bytesWritten 回报）
+    void txCompleted(quint64 frameId, qint64 hostNs);
+
+private slots:
+    void onTransportConnected();
+    void onReadyRead();
+    void onBytesWritten(qint64 bytes);
+    void onTransportError(const QString& err);
+
+private:
+    void pushRx(QByteArray&& line, qint64 hostNs);
+    void resetTx();
+    void discardTx();
+    void releaseTransport();
+    bool transportOpen() const;
+
+private:
+    SerialChannel* m_channel = nullptr;
+    Transport* m_transport = nullptr;
+    std::atomic<bool> m_open{false};
+
+    // TX：在途帧按写出顺序记录其结束位置（累计字节偏移）
+    struct InFlightFrame
+    {
+        quint64 id = 0;
+        qint64 endOffset = 0;
+    };
+    std::deque<InFlightFrame> m_inFlight;
+    SerialFrame m_txHead;          ///< 已出队但因限额暂未写出的帧
+    bool m_haveTxHead = false;
+    QByteArray m_txBatch;          ///< 合并写缓冲（复用）
+    QVector<SerialFrame> m_batchFrames;
+    qint64 m_bytesQueued = 0;      ///< 累计交给端口的字节
+    qint64 m_bytesDrained = 0;     ///< 累计 bytesWritten 回报的字节
+    int m_maxInFlightBytes = 4096;
+    int m_coalesceBytes = 512;
+
+    // 切帧（字节流 -> 多帧）；m_readBuf 为预分配的读缓冲
+    LineFramer m_framer;
+    QByteArray m_readBuf;
+};
@@ -0,0 +1,89 @@
+#pragma once
+/**
+ * @file spscqueue.h
+ * @brief Bounded lock-free single-producer/single-consumer ring queue.
+ *
+ * Exactly one thread may call push() and exactly one (other) thread may call pop().
+ * Capacity is rounded up to a power of two. head/tail are free-running counters, so
+ * every slot is usable. Each side keeps a cached copy of the other side's index to
+ * avoid touching the shared cache line on every call.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(std::size_t capacity = 1024)
+    {
+        std::size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        m_mask = cap - 1;
+        m_slots.reset(new T[cap]);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Producer side. Returns false (value untouched) when the queue is full.
+     */
+    bool push(T&& value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCache > m_mask)
+        {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail - m_headCache > m_mask)
+                return false;
+        }
+        m_slots[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Consumer side. Returns false when the queue is empty.
+     */
+    bool pop(T& out)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tailCache)
+        {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tailCache)
+                return false;
+        }
+        out = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Approximate fill level (exact when called from either owning thread while the other is idle).
+     */
+    std::size_t sizeApprox() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty() const { return sizeApprox() == 0; }
+    std::size_t capacity() const { return m_mask + 1; }
+
+private:
+    std::unique_ptr<T[]> m_slots;
+    std::size_t m_mask = 0;
+
+    // consumer-owned line
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    std::size_t m_tailCache = 0;
+
+    // producer-owned line
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    std::size_t m_headCache = 0;
+};
@@ -0,0 +1,66 @@
+#include "tcptransport.h"
+
+namespace
+{
+constexpr int kConnectTimeoutMs = 3000;
+}
+
+TcpTransport::TcpTransport(const QString& host, quint16 port, QObject* parent)
+    : IoDeviceTransport(parent)
+    , m_socket(this)
+    , m_connectTimer(this)
+    , m_host(host)
+    , m_portNo(port)
+{
+    attachDevice(&m_socket);
+    connect(&m_socket, &QAbstractSocket::connected, this, &TcpTransport::onConnected);
+    connect(&m_socket, &QAbstractSocket::errorOccurred, this, &TcpTransport::onSocketError);
+    m_connectTimer.setSingleShot(true);
+    connect(&m_connectTimer, &QTimer::timeout, this, &TcpTransport::onConnectTimeout);
+}
+
+bool TcpTransport::open(QString& errMsg)
+{
+    Q_UNUSED(errMsg);
+    // Never wait here: in direct I/O mode this is the GUI thread.
+    m_socket.connectToHost(m_host, m_portNo);
+    m_connectTimer.start(kConnectTimeoutMs);
+    return true;
+}
+
+void TcpTransport::close()
+{
+    m_connectTimer.stop();
+    m_socket.abort();
+}
+
+void TcpTransport::onConnected()
+{
+    m_connectTimer.stop();
+    // Frames are small and latency-sensitive: don't let Nagle hold them back.
+    m_socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    emit connected();
+}
+
+void TcpTransport::onConnectTimeout()
+{
+    m_socket.abort();
+    emit errorOccurred(QStringLiteral("连接 %1:%2 超时").arg(m_host).arg(m_portNo));
+}
+
+bool TcpTransport::isOpen() const
+{
+    return m_socket.state() == QAbstractSocket::ConnectedState;
+}
+
+QString TcpTransport::description() const
+{
+    return QStringLiteral("TCP %1:%2").arg(m_host).arg(m_portNo);
+}
+
+void TcpTransport::onSocketError(QAbstractSocket::SocketError e)
+{
+    Q_UNUSED(e);
+    m_connectTimer.stop();
+    emit errorOccurred(m_socket.errorString());
+}
@@ -0,0 +1,36 @@
+#pragma once
+/**
+ * @file tcptransport.h
+ * @brief TCP 客户端传输：tcp://host:port（本机回环压测 / 连接模拟下位机）
+ */
+
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "transport.h"
+
+class TcpTransport : public IoDeviceTransport
+{
+    Q_OBJECT
+public:
+    TcpTransport(const QString& host, quint16 port, QObject* parent = nullptr);
+
+    /**
+     * @brief 异步连接：连上发 connected()，失败或 kConnectTimeoutMs 内未连上发 errorOccurred()
+     */
+    bool open(QString& errMsg) override;
+    void close() override;
+    bool isOpen() const override;
+    QString description() const override;
+
+private slots:
+    void onConnected();
+    void onSocketError(QAbstractSocket::SocketError e);
+    void onConnectTimeout();
+
+private:
+    QTcpSocket m_socket;
+    QTimer m_connectTimer;
+    QString m_host;
+    quint16 m_portNo = 0;
+};
@@ -0,0 +1,107 @@
+/**
+ * @file transport.cpp
+ * @brief Transport factory and the shared QIODevice-backed implementation.
+ */
+
+#include "transport.h"
+
+#include "memorypipe.h"
+#include "ptytransport.h"
+#include "serialporttransport.h"
+#include "tcptransport.h"
+
+#include <QIODevice>
+
+namespace
+{
+const QLatin1String kTcpPrefix("tcp://");
+const QLatin1String kMemPrefix("mem://");
+const QLatin1String kPtySpec("pty");
+}
+
+Transport* Transport::create(const QString& spec,
+                             const SerialParams& params,
+                             QObject* parent,
+                             QString& errMsg)
+{
+    const QString s = spec.trimmed();
+    if (s.isEmpty())
+    {
+        errMsg = QStringLiteral("端口为空");
+        return nullptr;
+    }
+
+    if (s.startsWith(kTcpPrefix, Qt::CaseInsensitive))
+    {
+        const QString hostPort = s.mid(kTcpPrefix.size());
+        const int colon = hostPort.lastIndexOf(':');
+        bool ok = false;
+        const int port = (colon > 0) ? hostPort.mid(colon + 1).toInt(&ok) : 0;
+        if (!ok || port <= 0 || port > 65535)
+        {
+            errMsg = QStringLiteral("TCP 地址格式应为 tcp://host:port：%1").arg(s);
+            return nullptr;
+        }
+        return new TcpTransport(hostPort.left(colon), quint16(port), parent);
+    }
+
+    if (s.startsWith(kMemPrefix, Qt::CaseInsensitive))
+    {
+        const QString name = s.mid(kMemPrefix.size());
+        if (name.isEmpty())
+        {
+            errMsg = QStringLiteral("内存管道需要名称：mem://<name>");
+            return nullptr;
+        }
+        return new MemoryPipeTransport(name, parent);
+    }
+
+    if (s.compare(kPtySpec, Qt::CaseInsensitive) == 0)
+    {
+#ifdef Q_OS_UNIX
+        return new PtyTransport(parent);
+#else
+        errMsg = QStringLiteral("伪终端仅在 POSIX 系统可用");
+        return nullptr;
+#endif
+    }
+
+    return new SerialPortTransport(s, params, parent);
+}
+
+bool Transport::isSerialPortSpec(const QString& spec)
+{
+    const QString s = spec.trimmed();
+    return !s.isEmpty()
+        && !s.startsWith(kTcpPrefix, Qt::CaseInsensitive)
+        && !s.startsWith(kMemPrefix, Qt::CaseInsensitive)
+        && s.compare(kPtySpec, Qt::CaseInsensitive) != 0;
+}
+
+void IoDeviceTransport::attachDevice(QIODevice* device)
+{
+    m_device = device;
+    // QIODevice already emits bytesWritten from the event loop, never inside write().
+    connect(m_device, &QIODevice::readyRead, this, &Transport::readyRead);
+    connect(m_device, &QIODevice::bytesWritten, this, &Transport::bytesWritten);
+}
+
+bool IoDeviceTransport::isOpen() const
+{
+    return m_device->isOpen();
+}
+
+qint64 IoDeviceTransport::read(char* data, qint64 maxLen)
+{
+    return m_device->read(data, maxLen);
+}
+
+qint64 IoDeviceTransport::write(const QByteArray& data)
+{
+    return m_device->write(data);
+}
+
+QString IoDeviceTransport::errorString() const
+{
+    return m_device->errorString();
+}
@@ -0,0 +1,109 @@
+#pragma once
+/**
+ * @file transport.h
+ * @brief 字节流传输层接口：SerialWorker 只依赖它，不再直接依赖 QSerialPort
+ *
+ * 端口名即传输描述（spec）：
+ * - "COM3" / "ttyUSB0"        -> 串口（QSerialPort，沿用 SerialParams）
+ * - "pty"                     -> 新建 POSIX 伪终端对，从端路径见 description()
+ * - "tcp://127.0.0.1:5555"    -> TCP 客户端（本机回环压测）
+ * - "mem://<name>"            -> 进程内内存管道（先打开者为 A 端，后打开者为 B 端）
+ *
+ * 约定：
+ * - readyRead / bytesWritten 语义与 QIODevice 一致
+ * - bytesWritten 必须异步发出（不得在 write() 内同步回调）
+ * - open() 不得阻塞：需要等待的传输（TCP 连接）返回 true 后 isOpen() 仍为 false，
+ *   连上时发出 connected()，失败时发出 errorOccurred()
+ * - 所有调用都在 SerialWorker 所在线程进行
+ */
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+
+class QIODevice;
+
+/**
+ * @brief 串口参数（仅串口传输使用，其余传输忽略）
+ */
+struct SerialParams
+{
+    int baud = 115200;
+    int dataBits = 8;
+    QString parityText = QStringLiteral("None");
+    int stopBits = 1;
+};
+
+class Transport : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Transport(QObject* parent = nullptr) : QObject(parent) {}
+    ~Transport() override = default;
+
+    /**
+     * @brief 按 spec 创建传输对象（未打开）；spec 非法时返回 nullptr 并填写 errMsg
+     */
+    static Transport* create(const QString& spec,
+                             const SerialParams& params,
+                             QObject* parent,
+                             QString& errMsg);
+
+    /**
+     * @brief spec 是否指向真实串口（用于端口枚举/拔出检测）
+     */
+    static bool isSerialPortSpec(const QString& spec);
+
+    /**
+     * @brief 开始打开；false = 立即失败。返回 true 且 isOpen() 为 false 时等待 connected()
+     */
+    virtual bool open(QString& errMsg) = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+
+    /**
+     * @brief 非阻塞读；无数据返回 0，出错返回 -1
+     */
+    virtual qint64 read(char* data, qint64 maxLen) = 0;
+
+    /**
+     * @brief 非阻塞写；全部接收返回 data.size()，出错返回 -1
+     */
+    virtual qint64 write(const QByteArray& data) = 0;
+
+    virtual QString errorString() const = 0;
+
+    /**
+     * @brief 人类可读的描述（例如 "PTY /dev/pts/5"）
+     */
+    virtual QString description() const = 0;
+
+signals:
+    void connected();
+    void readyRead();
+    void bytesWritten(qint64 bytes);
+    void errorOccurred(const QString& err);
+};
+
+/**
+ * @brief 包装现成 QIODevice 的通用实现（串口、TCP）
+ */
+class IoDeviceTransport : public Transport
+{
+    Q_OBJECT
+public:
+    bool isOpen() const override;
+    qint64 read(char* data, qint64 maxLen) override;
+    qint64 write(const QByteArray& data) override;
+    QString errorString() const override;
+
+protected:
+    explicit IoDeviceTransport(QObject* parent = nullptr) : Transport(parent) {}
+
+    /**
+     * @brief 派生类在自身成员构造完成后调用，接入 readyRead/bytesWritten
+     */
+    void attachDevice(QIODevice* device);
+
+    QIODevice* m_device = nullptr;
+};
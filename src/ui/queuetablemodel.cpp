@@ -24,6 +24,7 @@ QString excelColumnName(int col)
 const QColor kRunningColor(200, 255, 200);
 const QColor kDoneColor(220, 220, 220);
 const QColor kRerunColor(255, 150, 150);
+const QColor kSlowColor(255, 205, 120);
 }
 
 QueueTableModel::QueueTableModel(QObject* parent)
@@ -64,6 +65,7 @@ void QueueTableModel::setTableRows(const QVector<ExcelTableRow>& rows, int colum
         r.flowState = FlowState::None;
         r.rerunMarked = false;
         r.timeStates.fill(StepState::None, r.timeColumns.size());
+        r.timeNotes.fill(QString(), r.timeColumns.size());
         m_rows.push_back(r);
         if (!r.isHeader && !r.flow.isEmpty())
             m_flowRow.insert(r.flow, i);
@@ -175,6 +177,8 @@ void QueueTableModel::clearStepTimes()
                 row.cells[colIdx].clear();
             if (i < row.timeStates.size())
                 row.timeStates[i] = StepState::None;
+            if (i < row.timeNotes.size())
+                row.timeNotes[i].clear();
             emitTimeCellChanged(r, colIdx);
         }
     }
@@ -225,9 +229,30 @@ void QueueTableModel::setStepTime(const QString& flowName, int stepIndex, qint64
     row.cells[colIdx] = QString::number(deviceMs);
     if (stepZero < row.timeStates.size())
         row.timeStates[stepZero] = StepState::Done;
+    if (stepZero < row.timeNotes.size())
+        row.timeNotes[stepZero].clear();
     emitTimeCellChanged(rowIdx, colIdx);
 }
 
+void QueueTableModel::setStepSlow(const QString& flowName, int stepIndex, qint64 predictedMs, qint64 actualMs)
+{
+    if (stepIndex <= 0)
+        return;
+    const int rowIdx = rowForFlowName(flowName);
+    if (rowIdx < 0 || rowIdx >= m_rows.size())
+        return;
+    auto& row = m_rows[rowIdx];
+    const int stepZero = stepIndex - 1;
+    if (stepZero >= row.timeStates.size() || stepZero >= row.timeNotes.size())
+        return;
+    row.timeStates[stepZero] = StepState::Slow;
+    row.timeNotes[stepZero] = QStringLiteral("步时长超出预测：预测 %1 ms，实际 %2 ms（+%3 ms）")
+                                  .arg(predictedMs)
+                                  .arg(actualMs)
+                                  .arg(actualMs - predictedMs);
+    emitTimeCellChanged(rowIdx, row.timeColumns.value(stepZero, -1));
+}
+
 int QueueTableModel::stepCountForFlow(const QString& flowName) const
 {
     const int rowIdx = rowForFlowName(flowName);
@@ -301,6 +326,14 @@ QVariant QueueTableModel::data(const QModelIndex& index, int role) const
     if (role == Qt::TextAlignmentRole)
         return Qt::AlignCenter;
 
+    if (role == Qt::ToolTipRole)
+    {
+        const int stepIdx = (col > 0) ? r.timeColumns.indexOf(col - 1) : -1;
+        if (stepIdx >= 0 && stepIdx < r.timeNotes.size() && !r.timeNotes[stepIdx].isEmpty())
+            return r.timeNotes[stepIdx];
+        return {};
+    }
+
     if (role == Qt::BackgroundRole)
     {
         if (col == 0)
@@ -322,6 +355,8 @@ QVariant QueueTableModel::data(const QModelIndex& index, int role) const
                 return kRunningColor;
             if (r.timeStates[stepIdx] == StepState::Done)
                 return kDoneColor;
+            if (r.timeStates[stepIdx] == StepState::Slow)
+                return kSlowColor;
         }
         if (!r.isHeader && r.ledColumns.contains(cellIdx))
         {
@@ -31,6 +31,7 @@ public:
     void clearStepTimes();
     void setStepRunning(const QString& flowName, int stepIndex);
     void setStepTime(const QString& flowName, int stepIndex, qint64 deviceMs);
+    void setStepSlow(const QString& flowName, int stepIndex, qint64 predictedMs, qint64 actualMs); ///< 步时长超出预测容差
     int stepCountForFlow(const QString& flowName) const;
     void setLedColorMap(const QHash<int, QColor>& colors);
     bool ledColorIndexAt(const QModelIndex& index, int* colorIndex) const;
@@ -43,7 +44,7 @@ public:
 
 private:
     enum class FlowState { None, Running, Done };
-    enum class StepState { None, Running, Done };
+    enum class StepState { None, Running, Done, Slow };
 
     struct DisplayRow
     {
@@ -55,6 +56,7 @@ private:
         FlowState flowState = FlowState::None;
         bool rerunMarked = false;
         QVector<StepState> timeStates;
+        QVector<QString> timeNotes;   ///< tooltip per time column (slow steps)
     };
 
     void setFlowState(const QString& flowName, FlowState state);
@@ -0,0 +1,274 @@
+#include "headlessrunner.h"
+
+#include <QTextStream>
+
+#include "../../src/core/excelimporter.h"
+#include "../../src/core/hostclock.h"
+#include "../../src/core/randomcolorresolver.h"
+#include "../../src/core/workflowengine.h"
+#include "../../src/services/serialservice.h"
+
+namespace Cli
+{
+namespace
+{
+void printLine(const QString& text)
+{
+    QTextStream out(stdout);
+    out << text << Qt::endl;
+}
+
+void printError(const QString& text)
+{
+    QTextStream err(stderr);
+    err << text << Qt::endl;
+}
+
+qint64 sumMs(const QVector<qint64>& steps)
+{
+    qint64 total = 0;
+    for (qint64 ms : steps)
+        total += ms;
+    return total;
+}
+} // namespace
+
+HeadlessRunner::HeadlessRunner(const SettingsData& settings, const RunOptions& opt, QObject* parent)
+    : QObject(parent)
+    , m_settings(settings)
+    , m_opt(opt)
+{
+    if (!m_opt.port.isEmpty())
+        m_settings.serial.portName = m_opt.port;
+    if (m_opt.baud > 0)
+        m_settings.serial.baud = m_opt.baud;
+    if (m_opt.gapMs >= 0)
+        m_settings.run.autoplayGapMs = m_opt.gapMs;
+
+    m_importer = new ExcelImporter(this);
+    m_serial = new SerialService(this);
+    m_engine = new WorkflowEngine(this);
+    m_engine->setSerialService(m_serial); // before our own connects: the engine sees opened() first
+
+    m_deadline.setSingleShot(true);
+    connect(&m_deadline, &QTimer::timeout, this, [this]() {
+        fail(ExitTimedOut, QStringLiteral("timeout after %1 s").arg(m_opt.timeoutS));
+    });
+
+    connect(m_serial, &SerialService::rxLine, m_engine, &WorkflowEngine::onSerialLine);
+    connect(m_serial, &SerialService::opened, this, &HeadlessRunner::onSerialOpened);
+    connect(m_serial, &SerialService::transportReady, this, [](const QString& description) {
+        printLine(QStringLiteral("Port: %1").arg(description));
+    });
+    connect(m_serial, &SerialService::error, this, [this](const QString& err) {
+        if (m_started)
+            fail(ExitRunFailed, QStringLiteral("port error: %1").arg(err));
+        else
+            printError(err);
+    });
+    connect(m_serial, &SerialService::closed, this, [this]() {
+        fail(ExitRunFailed, QStringLiteral("port closed"));
+    });
+
+    connect(m_engine, &WorkflowEngine::protocolNegotiated, this, [this](int version, bool binary, bool sequenced) {
+        printLine(version > 0 ? QStringLiteral("Protocol: v%1 %2%3")
+                                    .arg(version)
+                                    .arg(binary ? QStringLiteral("binary") : QStringLiteral("text"))
+                                    .arg(sequenced ? QStringLiteral(" sequenced") : QString())
+                              : QStringLiteral("Protocol: no handshake reply, text"));
+        if (m_waitHandshake)
+        {
+            m_waitHandshake = false;
+            beginPlan();
+        }
+    });
+    connect(m_engine, &WorkflowEngine::segmentStarted, this, &HeadlessRunner::onSegmentStarted);
+    connect(m_engine, &WorkflowEngine::segmentCompleted, this, &HeadlessRunner::onSegmentCompleted);
+    connect(m_engine, &WorkflowEngine::autoplayChanged, this, &HeadlessRunner::onAutoplayChanged);
+    connect(m_engine, &WorkflowEngine::rerunMarked, this, [this](const QString&) { m_segRerun = true; });
+    connect(m_engine, &WorkflowEngine::stepTimingSlow, this, [this](const QString&, int, qint64, qint64) {
+        ++m_segSlowSteps;
+        ++m_slowSteps;
+    });
+    connect(m_engine, &WorkflowEngine::deviceReport, this, [this](bool fault, int code, const QString& detail) {
+        printError(QStringLiteral("%1 %2: %3").arg(fault ? QStringLiteral("FAULT") : QStringLiteral("ERR")).arg(code).arg(detail));
+        if (fault)
+        {
+            m_fault = true;
+            m_faultText = QStringLiteral("device fault %1: %2").arg(code).arg(detail);
+        }
+    });
+    connect(m_engine, &WorkflowEngine::logLine, this, [this](const QString& line) {
+        static const QLatin1String kStopped("Autoplay stopped: ");
+        const int at = line.indexOf(kStopped);
+        if (at >= 0)
+            m_stopReason = line.mid(at + kStopped.size()).trimmed();
+        if (m_opt.verbose)
+            printError(line);
+    });
+}
+
+HeadlessRunner::~HeadlessRunner()
+{
+    m_engine->finishRun();
+    m_serial->disconnect(this);
+    m_serial->closePort();
+    delete m_engine;
+    delete m_serial; // joins its I/O thread
+}
+
+bool HeadlessRunner::prepare(QString& errMsg)
+{
+    if (!m_importer->loadXlsx(m_opt.xlsxPath, errMsg))
+        return false;
+    if (m_importer->actions().isEmpty())
+    {
+        errMsg = QStringLiteral("未导入Excel：没有动作");
+        return false;
+    }
+    if (!RandomColorResolver::precheckSolvable(m_importer->actions(), m_settings.colors, m_settings.conflicts,
+                                               m_settings.device.ledCount, errMsg))
+        return false;
+    return RandomColorResolver::resolveAll(m_importer->actions(), m_settings.colors, m_settings.conflicts,
+                                           m_settings.device.ledCount, m_resolved, errMsg);
+}
+
+void HeadlessRunner::start()
+{
+    const SerialConfig& sc = m_settings.serial;
+    if (sc.portName.isEmpty())
+    {
+        finish(ExitSetupFailed, QStringLiteral("no port (use --port or serial/portName in the ini)"));
+        return;
+    }
+    if (m_opt.timeoutS > 0)
+        m_deadline.start(m_opt.timeoutS * 1000); // includes opening the port and the handshake
+    m_serial->setThreadedIo(sc.threadedIo);
+    m_serial->setTxLimits(sc.txInFlightBytes, sc.txCoalesceBytes);
+    m_engine->applySerialSettings(sc);
+    m_serial->openPort(sc.portName, sc.baud, sc.dataBits, sc.parity, sc.stopBits);
+}
+
+void HeadlessRunner::onSerialOpened(bool ok, const QString& err)
+{
+    if (!ok)
+    {
+        finish(ExitSetupFailed, QStringLiteral("open %1 failed: %2").arg(m_settings.serial.portName, err));
+        return;
+    }
+    // The engine saw opened() first: if it sent VER?, configs go out after the reply (or its timeout).
+    m_waitHandshake = m_engine->isHandshakePending();
+    if (!m_waitHandshake)
+        beginPlan();
+}
+
+void HeadlessRunner::beginPlan()
+{
+    if (m_started || m_done)
+        return;
+    m_started = true;
+
+    m_engine->applyRunSettings(m_settings);
+    m_engine->beginRun();
+    m_engine->sendConfigs();
+    m_engine->loadPlan(m_resolved, m_opt.seed);
+
+    qint64 predictedMs = 0;
+    for (int i = 0; i < m_engine->segmentCount(); ++i)
+        predictedMs += sumMs(m_engine->predictedStepMs(i));
+    printLine(QStringLiteral("Plan: actions=%1 segments=%2 seed=%3 predictedMs=%4")
+                  .arg(m_resolved.size())
+                  .arg(m_engine->segmentCount())
+                  .arg(m_engine->planSeed())
+                  .arg(predictedMs));
+
+    m_runStartNs = HostClock::nowNs();
+    m_engine->setAutoplay(true);
+    m_engine->noteTrigger();
+    if (!m_engine->runNextSegment())
+        evaluate(); // e.g. every segment empty
+}
+
+void HeadlessRunner::onSegmentStarted(const QString& name, int, int)
+{
+    m_segName = name;
+    m_segStartNs = HostClock::nowNs();
+    m_segRerun = false;
+    m_segSlowSteps = 0;
+}
+
+void HeadlessRunner::onSegmentCompleted(int segmentIndex, bool byTimeout)
+{
+    const qint64 actualMs = HostClock::nsToMs(HostClock::nowNs() - m_segStartNs);
+    const QVector<qint64>& steps = m_engine->predictedStepMs(segmentIndex);
+
+    ++m_segmentsRun;
+    if (m_segRerun)
+        ++m_reruns;
+    if (byTimeout)
+        ++m_timeouts;
+
+    const QString result = m_segRerun ? QStringLiteral("rerun")
+                         : byTimeout  ? QStringLiteral("timeout")
+                                      : QStringLiteral("ok");
+    printLine(QStringLiteral("[seg %1/%2] %3 steps=%4 predictedMs=%5 actualMs=%6 slowSteps=%7 result=%8")
+                  .arg(segmentIndex + 1)
+                  .arg(m_engine->segmentCount())
+                  .arg(m_segName)
+                  .arg(steps.size())
+                  .arg(sumMs(steps))
+                  .arg(actualMs)
+                  .arg(m_segSlowSteps)
+                  .arg(result));
+}
+
+void HeadlessRunner::onAutoplayChanged(bool on)
+{
+    if (on || !m_started || m_done)
+        return;
+    // Let the engine finish its own handling first (deviceReport, finishRun for "no next segment").
+    QTimer::singleShot(0, this, &HeadlessRunner::evaluate);
+}
+
+void HeadlessRunner::evaluate()
+{
+    if (m_done)
+        return;
+    if (m_fault)
+        fail(ExitRunFailed, m_faultText);
+    else if (!m_engine->isRunComplete())
+        fail(ExitRunFailed, m_stopReason.isEmpty() ? QStringLiteral("autoplay stopped") : m_stopReason);
+    else if (m_timeouts > 0)
+        finish(ExitIncomplete, QStringLiteral("complete, %1 segment(s) without final STEPRUN").arg(m_timeouts));
+    else
+        finish(ExitOk, QStringLiteral("complete"));
+}
+
+void HeadlessRunner::fail(int exitCode, const QString& reason)
+{
+    if (m_done)
+        return;
+    m_engine->setAutoplay(false);
+    finish(exitCode, QStringLiteral("failed: %1").arg(reason));
+}
+
+void HeadlessRunner::finish(int exitCode, const QString& result)
+{
+    if (m_done)
+        return;
+    m_done = true;
+    m_deadline.stop();
+    m_engine->finishRun();
+
+    const qint64 elapsedMs = m_runStartNs > 0 ? HostClock::nsToMs(HostClock::nowNs() - m_runStartNs) : 0;
+    printLine(QStringLiteral("Run %1: segmentsRun=%2 reruns=%3 timeouts=%4 slowSteps=%5 elapsedMs=%6 exit=%7")
+                  .arg(result)
+                  .arg(m_segmentsRun)
+                  .arg(m_reruns)
+                  .arg(m_timeouts)
+                  .arg(m_slowSteps)
+                  .arg(elapsedMs)
+                  .arg(exitCode));
+    emit finished(exitCode);
+}
+} // namespace Cli
@@ -0,0 +1,109 @@
+#pragma once
+/**
+ * @file headlessrunner.h
+ * @brief 无界面运行一次完整 Run：导入 xlsx -> 解析随机颜色 -> 打开端口 -> 自动连播全部段
+ *
+ * 流程与 MainWindow 的“打开串口 + 开始 + 自动连播”相同，直接驱动核心库里的
+ * ExcelImporter / RandomColorResolver / SerialService / WorkflowEngine：
+ * - prepare()：同步完成导入与颜色解析（失败即返回，不打开端口）
+ * - start()：打开端口；需要握手时等 protocolNegotiated，再 beginRun/sendConfigs/loadPlan 并发第一段
+ * - 每段完成（segmentCompleted）打印一行计时；自动连播停止后判定结果并发 finished(exitCode)
+ *
+ * 单个进程只驱动一个治具（忽略 station/extraPorts）；多治具由脚本各起一个进程。
+ */
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+#include "../../src/config/appsettings.h"
+#include "../../src/core/models.h"
+
+class ExcelImporter;
+class SerialService;
+class WorkflowEngine;
+
+namespace Cli
+{
+enum ExitCode
+{
+    ExitOk = 0,
+    ExitSetupFailed = 1,   ///< 参数/配置/导入/颜色解析/打开端口失败
+    ExitRunFailed = 2,     ///< FAULT、连续重做过多、端口断开等导致未跑完全部段
+    ExitTimedOut = 3,      ///< 超过 --timeout-s
+    ExitIncomplete = 4,    ///< 全部段已跑完，但有段未收到末步 STEPRUN（按预测时长兜底推进）
+};
+
+struct RunOptions
+{
+    QString xlsxPath;
+    QString port;          ///< 空 = ini 里的 serial/portName
+    int baud = 0;          ///< 0 = ini 里的 serial/baud
+    quint32 seed = 0;      ///< RAND 顺序种子，0 = 随机（实际种子会打印出来）
+    int gapMs = -1;        ///< 段间间隔，<0 = ini 里的 run/autoplayGapMs
+    int timeoutS = 0;      ///< 整次 Run 的超时，0 = 不限
+    bool verbose = false;  ///< 把 Run 日志逐行打到 stderr
+};
+
+class HeadlessRunner : public QObject
+{
+    Q_OBJECT
+public:
+    HeadlessRunner(const SettingsData& settings, const RunOptions& opt, QObject* parent = nullptr);
+    ~HeadlessRunner() override;
+
+    /**
+     * @brief 导入 xlsx 并解析随机颜色
+     * @return false 时 errMsg 为失败原因
+     */
+    bool prepare(QString& errMsg);
+
+    /**
+     * @brief 打开端口并开始 Run（异步，结束时发 finished）
+     */
+    void start();
+
+signals:
+    void finished(int exitCode);
+
+private:
+    void onSerialOpened(bool ok, const QString& err);
+    void beginPlan();
+    void onSegmentStarted(const QString& name, int startRow, int endRow);
+    void onSegmentCompleted(int segmentIndex, bool byTimeout);
+    void onAutoplayChanged(bool on);
+    void evaluate();
+    void fail(int exitCode, const QString& reason);
+    void finish(int exitCode, const QString& result);
+
+private:
+    SettingsData m_settings;
+    RunOptions m_opt;
+
+    ExcelImporter* m_importer = nullptr;
+    SerialService* m_serial = nullptr;
+    WorkflowEngine* m_engine = nullptr;
+    QTimer m_deadline;
+
+    QVector<ActionItem> m_resolved;
+    bool m_waitHandshake = false;
+    bool m_started = false;
+    bool m_done = false;
+    bool m_fault = false;
+    QString m_faultText;
+    QString m_stopReason;     ///< 最近一次 "Autoplay stopped: ..." 的原因
+
+    // 当前段
+    QString m_segName;
+    qint64 m_segStartNs = 0;
+    bool m_segRerun = false;
+    int m_segSlowSteps = 0;
+
+    // 汇总
+    qint64 m_runStartNs = 0;
+    int m_segmentsRun = 0;
+    int m_reruns = 0;
+    int m_timeouts = 0;
+    int m_slowSteps = 0;
+};
+} // namespace Cli
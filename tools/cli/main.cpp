@@ -0,0 +1,108 @@
+/**
+ * @file main.cpp
+ * @brief first1_run：无界面命令行运行器，供批处理脚本驱动治具
+ *
+ * 用法：
+ *   first1_run plan.xlsx --port COM7                 # 导入、解析颜色、打开端口、自动连播全部段
+ *   first1_run plan.xlsx --port tcp://127.0.0.1:5555 --seed 42 --timeout-s 600
+ *   first1_run plan.xlsx --config station2.ini       # 用另一份 ini（默认程序目录 ./config.ini）
+ *
+ *   --port/--baud   覆盖 ini 的 serial/portName、serial/baud（其余串口参数、握手偏好照 ini）
+ *   --seed          RAND 顺序种子，0 = 随机；实际种子打印在 Plan: 行，可用于复现
+ *   --gap-ms        段间间隔，覆盖 run/autoplayGapMs
+ *   --timeout-s     整次 Run（含打开端口与握手）的超时
+ *   --verbose       Run 日志逐行打到 stderr
+ *
+ * 输出（stdout）：每段完成一行 [seg i/N] ... predictedMs= actualMs= result=ok|rerun|timeout，
+ * 最后一行 Run <结果>: ... exit=<退出码>。Run 日志照常写 logs/。
+ *
+ * 退出码：0 全部完成；1 参数/配置/导入/颜色解析/打开端口失败；2 Run 失败（FAULT、重做过多、端口断开）；
+ *         3 超时；4 全部完成但有段按预测时长兜底（未收到末步 STEPRUN）
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QTimer>
+
+#include "headlessrunner.h"
+
+namespace
+{
+void printError(const QString& text)
+{
+    QTextStream err(stderr);
+    err << text << Qt::endl;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("VisualLab");
+    QCoreApplication::setOrganizationDomain("visual.lab.local");
+    QCoreApplication::setApplicationName(QStringLiteral("first1_run"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Headless runner: import an xlsx plan and run every segment with autoplay."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("xlsx"), QStringLiteral("Plan workbook (.xlsx)."));
+    const QCommandLineOption optConfig(QStringLiteral("config"), QStringLiteral("Settings ini (default: config.ini next to the executable)."), QStringLiteral("ini"));
+    const QCommandLineOption optPort(QStringLiteral("port"), QStringLiteral("Transport spec (serial port, tcp://host:port, pty)."), QStringLiteral("spec"));
+    const QCommandLineOption optBaud(QStringLiteral("baud"), QStringLiteral("Baud rate."), QStringLiteral("rate"));
+    const QCommandLineOption optSeed(QStringLiteral("seed"), QStringLiteral("RAND order seed, 0 = random."), QStringLiteral("seed"), QStringLiteral("0"));
+    const QCommandLineOption optGap(QStringLiteral("gap-ms"), QStringLiteral("Gap between segments."), QStringLiteral("ms"));
+    const QCommandLineOption optTimeout(QStringLiteral("timeout-s"), QStringLiteral("Abort the run after this many seconds, 0 = no limit."), QStringLiteral("s"), QStringLiteral("0"));
+    const QCommandLineOption optVerbose(QStringLiteral("verbose"), QStringLiteral("Echo the run log to stderr."));
+    parser.addOptions({optConfig, optPort, optBaud, optSeed, optGap, optTimeout, optVerbose});
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1)
+        parser.showHelp(Cli::ExitSetupFailed);
+
+    Cli::RunOptions opt;
+    opt.xlsxPath = args.first();
+    opt.port = parser.value(optPort).trimmed();
+    opt.verbose = parser.isSet(optVerbose);
+    bool ok = true;
+    if (parser.isSet(optBaud))
+        opt.baud = parser.value(optBaud).toInt(&ok);
+    if (ok)
+        opt.seed = parser.value(optSeed).toUInt(&ok);
+    if (ok && parser.isSet(optGap))
+        opt.gapMs = parser.value(optGap).toInt(&ok);
+    if (ok)
+        opt.timeoutS = parser.value(optTimeout).toInt(&ok);
+    if (!ok || opt.baud < 0 || opt.timeoutS < 0)
+    {
+        printError(QStringLiteral("bad --baud/--seed/--gap-ms/--timeout-s"));
+        return Cli::ExitSetupFailed;
+    }
+
+    if (parser.isSet(optConfig))
+    {
+        const QString ini = parser.value(optConfig);
+        if (!QFileInfo::exists(ini))
+        {
+            printError(QStringLiteral("config not found: %1").arg(ini));
+            return Cli::ExitSetupFailed;
+        }
+        AppSettings::setIniPath(ini);
+    }
+
+    Cli::HeadlessRunner runner(AppSettings::load(), opt);
+    QString err;
+    if (!runner.prepare(err))
+    {
+        printError(err);
+        return Cli::ExitSetupFailed;
+    }
+
+    QObject::connect(&runner, &Cli::HeadlessRunner::finished, &app, [](int exitCode) {
+        QCoreApplication::exit(exitCode);
+    });
+    QTimer::singleShot(0, &runner, &Cli::HeadlessRunner::start); // finished() must reach a running event loop
+    return app.exec();
+}
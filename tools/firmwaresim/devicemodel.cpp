@@ -0,0 +1,440 @@
+#include "devicemodel.h"
+
+#include "../../src/core/binaryframe.h"
+
+namespace
+{
+bool takePrefix(QByteArrayView& line, QByteArrayView prefix)
+{
+    if (!line.startsWith(prefix))
+        return false;
+    line = line.sliced(prefix.size());
+    return true;
+}
+
+QList<QByteArrayView> splitFields(QByteArrayView body, char sep)
+{
+    QList<QByteArrayView> out;
+    qsizetype from = 0;
+    while (true)
+    {
+        const qsizetype at = body.indexOf(sep, from);
+        if (at < 0)
+        {
+            out.append(body.sliced(from));
+            return out;
+        }
+        out.append(body.sliced(from, at - from));
+        from = at + 1;
+    }
+}
+
+bool toInt(QByteArrayView v, int& out)
+{
+    bool ok = false;
+    const int x = v.trimmed().toInt(&ok);
+    if (ok)
+        out = x;
+    return ok;
+}
+} // namespace
+
+namespace FirmwareSim
+{
+DeviceModel::FrameKind DeviceModel::handleFrame(QByteArrayView line, QVector<SimAction>& actions, QString& errMsg)
+{
+    actions.clear();
+    line = line.trimmed();
+
+    const auto config = [&](Protocol::ConfigBlock block, bool ok) {
+        if (!ok)
+            return FrameKind::Unknown;
+        m_configHash[int(block)] = Protocol::configHash(line);
+        return FrameKind::Config;
+    };
+
+    QByteArrayView body = line;
+    if (takePrefix(body, "WORK:"))
+    {
+        parseWork(body, actions, errMsg);
+        return FrameKind::Work;
+    }
+    if (takePrefix(body, "LEDSET:"))
+        return config(Protocol::ConfigBlock::LedSet, parseLedSet(splitFields(body, ','), errMsg));
+    if (takePrefix(body, "VOICESET1:"))
+        return config(Protocol::ConfigBlock::VoiceSet1, parseVoiceSet(1, splitFields(body, ','), errMsg));
+    if (takePrefix(body, "VOICESET2:"))
+        return config(Protocol::ConfigBlock::VoiceSet2, parseVoiceSet(2, splitFields(body, ','), errMsg));
+    // README documents "BEEPSET;", protocol.cpp sends "BEEPSET:"; accept both.
+    if (takePrefix(body, "BEEPSET:") || takePrefix(body, "BEEPSET;"))
+        return config(Protocol::ConfigBlock::BeepSet, parseBeepSet(splitFields(body, ','), errMsg));
+    if (takePrefix(body, "STAGE:"))
+    {
+        // <id>,WORK:<actions>
+        const qsizetype comma = body.indexOf(',');
+        QByteArrayView work = (comma >= 0) ? body.sliced(comma + 1) : QByteArrayView();
+        int id = 0;
+        if (comma < 0 || !toInt(body.first(comma), id) || !takePrefix(work, "WORK:"))
+        {
+            errMsg = QStringLiteral("bad STAGE");
+            return FrameKind::Unknown;
+        }
+        m_stageId = quint16(id);
+        parseWork(work, actions, errMsg);
+        return FrameKind::Stage;
+    }
+    if (takePrefix(body, "GO:"))
+    {
+        int id = 0;
+        if (!toInt(body, id))
+        {
+            errMsg = QStringLiteral("bad GO");
+            return FrameKind::Unknown;
+        }
+        m_stageId = quint16(id);
+        return FrameKind::Go;
+    }
+    if (takePrefix(body, "VOICEDEF:"))
+    {
+        // <id>,<gb2312 hex bytes with spaces>
+        const qsizetype comma = body.indexOf(',');
+        int id = 0;
+        if (comma < 0 || !toInt(body.first(comma), id))
+        {
+            errMsg = QStringLiteral("bad VOICEDEF");
+            return FrameKind::Unknown;
+        }
+        const QByteArrayView hex = body.sliced(comma + 1).trimmed();
+        const qsizetype bytes = hex.isEmpty() ? 0 : hex.count(' ') + 1;
+        return defineVoice(id, bytes, errMsg) ? FrameKind::Config : FrameKind::Unknown;
+    }
+    if (line == "VER?")
+    {
+        m_voiceDefs.clear();
+        return FrameKind::VersionQuery;
+    }
+    if (line == "CFGHASH?")
+        return FrameKind::ConfigHashQuery;
+    if (line.startsWith("LEDTEST") || line.startsWith("VOICETEST") || line.startsWith("BEEPTEST") || line == "BEEP")
+        return FrameKind::Test;
+
+    errMsg = QStringLiteral("unknown frame");
+    return FrameKind::Unknown;
+}
+
+bool DeviceModel::parseLedSet(const QList<QByteArrayView>& fields, QString& errMsg)
+{
+    // <ledCount>,<onMs>,<intervalMs>,<brightness>,<colorCount>,<hex1>,...
+    int ledCount = 0, onMs = 0, gapMs = 0;
+    if (fields.size() < 5 || !toInt(fields[0], ledCount) || !toInt(fields[1], onMs) || !toInt(fields[2], gapMs))
+    {
+        errMsg = QStringLiteral("bad LEDSET");
+        return false;
+    }
+    m_ledCount = qMax(0, ledCount);
+    m_onMs = qMax(0, onMs);
+    m_gapMs = qMax(0, gapMs);
+    return true;
+}
+
+bool DeviceModel::parseVoiceSet(int setIndex, const QList<QByteArrayView>& fields, QString& errMsg)
+{
+    // <announcer>,<style>,<speed>,<pitch>,<volume>
+    int speed = 0;
+    if (fields.size() < 5 || !toInt(fields[2], speed))
+    {
+        errMsg = QStringLiteral("bad VOICESET%1").arg(setIndex);
+        return false;
+    }
+    m_voiceSpeed[setIndex - 1] = qBound(0, speed, 10);
+    return true;
+}
+
+bool DeviceModel::defineVoice(int id, qsizetype bytes, QString& errMsg)
+{
+    if (id < 1 || id > Protocol::kMaxVoiceDefs)
+    {
+        errMsg = QStringLiteral("voice id %1 out of range").arg(id);
+        return false;
+    }
+    qsizetype used = bytes;
+    for (auto it = m_voiceDefs.constBegin(); it != m_voiceDefs.constEnd(); ++it)
+        used += (it.key() == id) ? 0 : it.value();
+    if (used > Protocol::kMaxVoiceDefBytes)
+    {
+        errMsg = QStringLiteral("voice table full");
+        return false;
+    }
+    m_voiceDefs.insert(id, bytes);
+    return true;
+}
+
+bool DeviceModel::voiceBytes(int id, qsizetype& bytes, QString& errMsg) const
+{
+    const auto it = m_voiceDefs.constFind(id);
+    if (it == m_voiceDefs.constEnd())
+    {
+        errMsg = QStringLiteral("unknown voice id #%1").arg(id);
+        return false;
+    }
+    bytes = it.value();
+    return true;
+}
+
+bool DeviceModel::parseBeepSet(const QList<QByteArrayView>& fields, QString& errMsg)
+{
+    // <durationMs>,<freqHz>
+    int durMs = 0;
+    if (fields.isEmpty() || !toInt(fields[0], durMs))
+    {
+        errMsg = QStringLiteral("bad BEEPSET");
+        return false;
+    }
+    m_beepMs = qMax(0, durMs);
+    return true;
+}
+
+DeviceModel::FrameKind DeviceModel::handleBinary(quint8 type, QByteArrayView payload,
+                                                 QVector<SimAction>& actions, QString& errMsg)
+{
+    actions.clear();
+    Protocol::BinaryReader r(payload);
+
+    if (type == quint8(Protocol::BinaryType::Work))
+    {
+        parseWorkBinary(payload, actions, errMsg);
+        return FrameKind::Work;
+    }
+    if (type == quint8(Protocol::BinaryType::LedSet))
+    {
+        const quint64 ledCount = r.varUInt();
+        const quint64 onMs = r.varUInt();
+        const quint64 gapMs = r.varUInt();
+        r.varUInt(); // brightness
+        const quint64 colorCount = r.varUInt();
+        r.bytes(qsizetype(colorCount) * 3);
+        if (!r.ok() || !r.atEnd())
+        {
+            errMsg = QStringLiteral("bad binary LEDSET");
+            return FrameKind::Unknown;
+        }
+        m_ledCount = int(ledCount);
+        m_onMs = int(onMs);
+        m_gapMs = int(gapMs);
+        m_configHash[int(Protocol::ConfigBlock::LedSet)] = Protocol::configHash(payload);
+        return FrameKind::Config;
+    }
+    if (type == quint8(Protocol::BinaryType::Stage))
+    {
+        m_stageId = quint16(r.varUInt());
+        if (!r.ok())
+        {
+            errMsg = QStringLiteral("bad binary STAGE");
+            return FrameKind::Unknown;
+        }
+        parseWorkBinary(r.rest(), actions, errMsg);
+        return FrameKind::Stage;
+    }
+    if (type == quint8(Protocol::BinaryType::VoiceDef))
+    {
+        const quint64 id = r.varUInt();
+        const quint64 bytes = r.varUInt();
+        r.bytes(qsizetype(bytes));
+        if (!r.ok() || !r.atEnd() || id > quint64(Protocol::kMaxVoiceDefs))
+        {
+            errMsg = QStringLiteral("bad binary VOICEDEF");
+            return FrameKind::Unknown;
+        }
+        return defineVoice(int(id), qsizetype(bytes), errMsg) ? FrameKind::Config : FrameKind::Unknown;
+    }
+
+    errMsg = QStringLiteral("unknown binary type 0x%1").arg(type, 2, 16, QLatin1Char('0'));
+    return FrameKind::Unknown;
+}
+
+bool DeviceModel::parseWorkBinary(QByteArrayView payload, QVector<SimAction>& actions, QString& errMsg) const
+{
+    Protocol::BinaryReader r(payload);
+    const quint64 count = r.varUInt();
+    for (quint64 i = 0; i < count && r.ok(); ++i)
+    {
+        SimAction a;
+        switch (Protocol::BinaryAction(r.u8()))
+        {
+        case Protocol::BinaryAction::Led:
+        {
+            const quint64 n = r.varUInt();
+            qsizetype lit = 0;
+            for (quint64 k = 0; k < n && r.ok(); ++k)
+                lit += (r.varUInt() != 0) ? 1 : 0;
+            for (quint64 k = 0; k < n && r.ok(); ++k)
+                r.varUInt(); // colors
+            a.kind = SimAction::Kind::Led;
+            a.durationMs = ledDurationMs(lit);
+            break;
+        }
+        case Protocol::BinaryAction::Delay:
+            a.kind = SimAction::Kind::Delay;
+            a.durationMs = qint64(r.varUInt());
+            break;
+        case Protocol::BinaryAction::Voice:
+        {
+            const int style = int(r.varUInt());
+            const qsizetype bytes = qsizetype(r.varUInt());
+            r.bytes(bytes);
+            a.kind = SimAction::Kind::Voice;
+            a.durationMs = ((bytes + 1) / 2) * voiceMsPerChar(style);
+            break;
+        }
+        case Protocol::BinaryAction::Beep:
+            a.kind = SimAction::Kind::Beep;
+            a.durationMs = m_beepMs;
+            break;
+        case Protocol::BinaryAction::VoiceRef:
+        {
+            const int style = int(r.varUInt());
+            const quint64 id = r.varUInt();
+            qsizetype bytes = 0;
+            if (!r.ok() || id > quint64(Protocol::kMaxVoiceDefs) || !voiceBytes(int(id), bytes, errMsg))
+            {
+                if (errMsg.isEmpty())
+                    errMsg = QStringLiteral("bad binary VOICE reference");
+                actions.clear();
+                return false;
+            }
+            a.kind = SimAction::Kind::Voice;
+            a.durationMs = ((bytes + 1) / 2) * voiceMsPerChar(style);
+            break;
+        }
+        default:
+            errMsg = QStringLiteral("unknown binary action");
+            actions.clear();
+            return false;
+        }
+        actions.append(a);
+    }
+
+    if (!r.ok() || !r.atEnd() || actions.isEmpty())
+    {
+        errMsg = QStringLiteral("bad binary WORK");
+        actions.clear();
+        return false;
+    }
+    return true;
+}
+
+qint64 DeviceModel::ledDurationMs(qsizetype litCount) const
+{
+    const qint64 slot = qint64(m_onMs) + m_gapMs;
+    return (litCount == 0) ? slot : slot * litCount;
+}
+
+qint64 DeviceModel::voiceMsPerChar(int style) const
+{
+    const int speed = m_voiceSpeed[(style == 2) ? 1 : 0];
+    // speed 0 -> 375ms, 5 -> 250ms, 10 -> 125ms per character
+    return 375 - 25 * speed;
+}
+
+bool DeviceModel::parseWork(QByteArrayView body, QVector<SimAction>& actions, QString& errMsg) const
+{
+    const QList<QByteArrayView> parts = splitFields(body, ';');
+    for (const QByteArrayView part : parts)
+    {
+        if (part.trimmed().isEmpty())
+            continue;
+        SimAction a;
+        if (!parseAction(part.trimmed(), a, errMsg))
+        {
+            actions.clear();
+            return false;
+        }
+        actions.append(a);
+    }
+    if (actions.isEmpty())
+    {
+        errMsg = QStringLiteral("empty WORK");
+        return false;
+    }
+    return true;
+}
+
+bool DeviceModel::parseAction(QByteArrayView text, SimAction& a, QString& errMsg) const
+{
+    const QList<QByteArrayView> f = splitFields(text, ',');
+    const QByteArrayView kind = f[0].trimmed();
+
+    if (kind == "LED")
+    {
+        // LED,<order1..N>,<color1..N>
+        if (f.size() < 3 || (f.size() - 1) % 2 != 0)
+        {
+            errMsg = QStringLiteral("bad LED action: %1").arg(QString::fromLatin1(text));
+            return false;
+        }
+        const qsizetype n = (f.size() - 1) / 2;
+        qsizetype lit = 0;
+        for (qsizetype i = 1; i <= n; ++i)
+        {
+            int order = 0;
+            if (!toInt(f[i], order))
+            {
+                errMsg = QStringLiteral("bad LED order: %1").arg(QString::fromLatin1(text));
+                return false;
+            }
+            if (order != 0)
+                ++lit;
+        }
+        a.kind = SimAction::Kind::Led;
+        a.durationMs = ledDurationMs(lit);
+        return true;
+    }
+    if (kind == "DELAY")
+    {
+        int ms = 0;
+        if (f.size() < 2 || !toInt(f[1], ms) || ms < 0)
+        {
+            errMsg = QStringLiteral("bad DELAY action: %1").arg(QString::fromLatin1(text));
+            return false;
+        }
+        a.kind = SimAction::Kind::Delay;
+        a.durationMs = ms;
+        return true;
+    }
+    if (kind == "VOICE")
+    {
+        // VOICE,<hex bytes with spaces>,<style> or VOICE,#<id>,<style>
+        int style = 1;
+        if (f.size() < 3 || !toInt(f[2], style))
+        {
+            errMsg = QStringLiteral("bad VOICE action: %1").arg(QString::fromLatin1(text));
+            return false;
+        }
+        const QByteArrayView payload = f[1].trimmed();
+        qsizetype bytes = payload.isEmpty() ? 0 : payload.count(' ') + 1;
+        if (payload.startsWith('#'))
+        {
+            int id = 0;
+            if (!toInt(payload.sliced(1), id) || !voiceBytes(id, bytes, errMsg))
+            {
+                if (errMsg.isEmpty())
+                    errMsg = QStringLiteral("bad VOICE reference: %1").arg(QString::fromLatin1(text));
+                return false;
+            }
+        }
+        const qint64 chars = (bytes + 1) / 2; // GB2312: 2 bytes per Hanzi
+        a.kind = SimAction::Kind::Voice;
+        a.durationMs = chars * voiceMsPerChar(style);
+        return true;
+    }
+    if (kind == "BEEP")
+    {
+        a.kind = SimAction::Kind::Beep;
+        a.durationMs = m_beepMs;
+        return true;
+    }
+
+    errMsg = QStringLiteral("unknown action: %1").arg(QString::fromLatin1(text));
+    return false;
+}
+} // namespace FirmwareSim
@@ -0,0 +1,91 @@
+#pragma once
+/**
+ * @file devicemodel.h
+ * @brief 下位机行为模型：解析上位机下发的配置/WORK 帧，并估算每个动作的执行时长
+ *
+ * 帧格式见 src/core/protocol.h。时长模型（毫秒，均为“设备时间”）：
+ * - LED：ALL（order 全 0）= onMs + gapMs；SEQ/RAND 逐颗点亮 = N * (onMs + gapMs)，N 为非 0 order 数
+ * - DELAY：参数值
+ * - BEEP：BEEPSET 的 durationMs
+ * - VOICE：按 GB2312 字数估算，msPerChar 随 VOICESET 语速线性变化（speed 5 = 250ms/字）
+ *
+ * 文本帧与二进制帧（binaryframe.h）解析到同一组 SimAction。
+ * 每个配置块成功解析后记下 Protocol::configHash()，供 CFGHASH? 回报。
+ * STAGE 只解析不执行（FrameKind::Stage，actions 为暂存的动作），GO 返回 FrameKind::Go；两者的编号见 stageId()。
+ * VOICEDEF 存入短语表（只记字节数，用于估时），VOICE,#id 引用未定义的编号按解析失败处理；VER? 清空短语表。
+ * 纯计算，不依赖事件循环，方便在回放/离线分析中复用。
+ */
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "../../src/core/protocol.h"
+
+namespace FirmwareSim
+{
+struct SimAction
+{
+    enum class Kind { Led, Delay, Voice, Beep };
+
+    Kind kind = Kind::Delay;
+    qint64 durationMs = 0;
+};
+
+class DeviceModel
+{
+public:
+    enum class FrameKind { Config, Test, Work, Stage, Go, VersionQuery, ConfigHashQuery, Unknown };
+
+    /**
+     * @brief 处理一帧（已去掉 CRLF）
+     * @param actions FrameKind::Work 时输出解析出的动作
+     * @param errMsg 解析失败时的原因（返回 Unknown 或 Work 但 actions 为空）
+     */
+    FrameKind handleFrame(QByteArrayView line, QVector<SimAction>& actions, QString& errMsg);
+
+    /**
+     * @brief 处理一个已通过 CRC 校验的二进制帧
+     */
+    FrameKind handleBinary(quint8 type, QByteArrayView payload, QVector<SimAction>& actions, QString& errMsg);
+
+    int ledCount() const { return m_ledCount; }
+    int onMs() const { return m_onMs; }
+    int gapMs() const { return m_gapMs; }
+    int beepMs() const { return m_beepMs; }
+
+    qint64 voiceMsPerChar(int style) const;
+
+    /**
+     * @brief 各配置块最近一次被接受时的指纹（Protocol::ConfigBlock 顺序），0 = 未配置
+     */
+    const quint32 (&configHashes() const)[Protocol::kConfigBlockCount] { return m_configHash; }
+
+    int voiceDefCount() const { return int(m_voiceDefs.size()); }
+    quint16 stageId() const { return m_stageId; } ///< id of the last STAGE/GO frame
+
+private:
+    bool parseLedSet(const QList<QByteArrayView>& fields, QString& errMsg);
+    bool parseVoiceSet(int setIndex, const QList<QByteArrayView>& fields, QString& errMsg);
+    bool parseBeepSet(const QList<QByteArrayView>& fields, QString& errMsg);
+    bool defineVoice(int id, qsizetype bytes, QString& errMsg);
+    bool voiceBytes(int id, qsizetype& bytes, QString& errMsg) const;
+    bool parseWork(QByteArrayView body, QVector<SimAction>& actions, QString& errMsg) const;
+    bool parseAction(QByteArrayView text, SimAction& a, QString& errMsg) const;
+    bool parseWorkBinary(QByteArrayView payload, QVector<SimAction>& actions, QString& errMsg) const;
+    qint64 ledDurationMs(qsizetype litCount) const;
+
+private:
+    // 上电默认值与 DeviceProps/VoiceProps 一致
+    int m_ledCount = 5;
+    int m_onMs = 350;
+    int m_gapMs = 0;
+    int m_beepMs = 500;
+    int m_voiceSpeed[2] = {5, 5};
+    quint32 m_configHash[Protocol::kConfigBlockCount] = {};
+    QHash<int, qsizetype> m_voiceDefs; ///< VOICEDEF id -> GB2312 byte count
+    quint16 m_stageId = 0;
+};
+} // namespace FirmwareSim
@@ -0,0 +1,347 @@
+#include "firmwaresimulator.h"
+
+#include "../../src/core/hostclock.h"
+#include "../../src/core/protocol.h"
+#include "../../src/services/transport.h"
+
+#include <QTextStream>
+
+#include <cmath>
+
+namespace FirmwareSim
+{
+FirmwareSimulator::FirmwareSimulator(const SimOptions& opt, QObject* parent)
+    : QObject(parent)
+    , m_opt(opt)
+    , m_tx(64)
+    , m_rng(opt.seed)
+{
+    if (!(m_opt.timeScale > 0.0))
+        m_opt.timeScale = 1.0;
+    m_readBuf.resize(4096);
+    m_epochNs = HostClock::nowNs();
+
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &FirmwareSimulator::onTick);
+}
+
+qint64 FirmwareSimulator::deviceNowMs() const
+{
+    const double realMs = double(HostClock::nowNs() - m_epochNs) / 1e6;
+    return qint64(realMs * m_opt.timeScale);
+}
+
+void FirmwareSimulator::attach(Transport* link)
+{
+    detach();
+    m_link = link;
+    m_rxAccum.clear();
+    connect(m_link, &Transport::readyRead, this, &FirmwareSimulator::onReadyRead);
+}
+
+void FirmwareSimulator::detach()
+{
+    if (m_link)
+        m_link->disconnect(this);
+    m_link = nullptr;
+    m_timer.stop();
+    m_steps.clear();
+    m_segmentSizes.clear();
+    m_stepInSegment = 0;
+    m_busyUntilMs = 0;
+}
+
+void FirmwareSimulator::onReadyRead()
+{
+    if (!m_link)
+        return;
+
+    while (true)
+    {
+        const qint64 n = m_link->read(m_readBuf.data(), m_readBuf.size());
+        if (n <= 0)
+            break;
+        m_rxAccum.append(m_readBuf.constData(), qsizetype(n));
+    }
+    processRx();
+}
+
+void FirmwareSimulator::processRx()
+{
+    constexpr qsizetype kMaxPendingBytes = 64 * 1024;
+
+    qsizetype pos = 0;
+    while (pos < m_rxAccum.size())
+    {
+        const QByteArrayView rest = QByteArrayView(m_rxAccum).sliced(pos);
+        if (quint8(rest[0]) == Protocol::kBinarySync)
+        {
+            Protocol::BinaryFrame frame;
+            qsizetype used = 0;
+            const Protocol::BinaryDecode r = Protocol::decodeBinaryFrame(rest, frame, used);
+            if (r == Protocol::BinaryDecode::NeedMore)
+                break;
+            if (r == Protocol::BinaryDecode::BadCrc)
+            {
+                logLine(QStringLiteral("[%1] binary frame CRC mismatch, resyncing").arg(deviceNowMs()));
+                if (m_opt.sequenced)
+                    sendAck(m_expectedSeq, true);
+            }
+            else if (!dropForLoss())
+            {
+                handleBinary(frame.type, frame.payload);
+            }
+            pos += used;
+            continue;
+        }
+
+        const qsizetype nl = rest.indexOf('\n');
+        if (nl < 0)
+            break;
+        const QByteArrayView line = rest.first(nl).trimmed();
+        if (!line.isEmpty() && !dropForLoss())
+            handleLine(line);
+        pos += nl + 1;
+    }
+
+    m_rxAccum.remove(0, pos);
+    if (m_rxAccum.size() > kMaxPendingBytes)
+    {
+        logLine(QStringLiteral("RX garbage > %1 bytes dropped").arg(kMaxPendingBytes));
+        m_rxAccum.clear();
+    }
+}
+
+bool FirmwareSimulator::dropForLoss()
+{
+    if (m_opt.lossPercent <= 0 || int(m_rng.bounded(100)) >= m_opt.lossPercent)
+        return false;
+    ++m_framesDropped;
+    return true;
+}
+
+void FirmwareSimulator::sendReport(int code, const QString& detail)
+{
+    if (!m_link || !m_link->isOpen())
+        return;
+    m_tx.clear();
+    Protocol::writeDeviceReport(m_tx, false, code, detail.toUtf8());
+    m_link->write(m_tx.bytes());
+}
+
+void FirmwareSimulator::sendAck(quint16 seq, bool nak)
+{
+    if (!m_link || !m_link->isOpen())
+        return;
+    m_tx.clear();
+    Protocol::writeAck(m_tx, seq, nak);
+    m_link->write(m_tx.bytes());
+}
+
+bool FirmwareSimulator::acceptSequence(quint16 seq)
+{
+    if (seq == m_expectedSeq)
+    {
+        sendAck(seq, false);
+        m_expectedSeq = quint16(m_expectedSeq + 1);
+        if (m_expectedSeq == 0)
+            m_expectedSeq = 1;
+        return true;
+    }
+
+    const quint16 last = (m_expectedSeq == 1) ? quint16(0xFFFF) : quint16(m_expectedSeq - 1);
+    if (quint16(m_expectedSeq - seq) < 0x8000)
+        sendAck(last, false);          // duplicate: already executed, re-ACK
+    else
+        sendAck(m_expectedSeq, true);  // gap: ask for the missing one
+    return false;
+}
+
+void FirmwareSimulator::handleLine(QByteArrayView line)
+{
+    quint16 seq = 0;
+    QByteArrayView body;
+    bool crcOk = false;
+    if (Protocol::unwrapSequencedText(line, seq, body, crcOk))
+    {
+        if (!crcOk)
+        {
+            logLine(QStringLiteral("[%1] sequenced frame CRC mismatch").arg(deviceNowMs()));
+            sendAck(m_expectedSeq, true);
+            return;
+        }
+        if (!acceptSequence(seq))
+            return;
+        line = body;
+    }
+
+    QVector<SimAction> actions;
+    QString err;
+    const DeviceModel::FrameKind kind = m_model.handleFrame(line, actions, err);
+    handleParsed(kind, actions, err, line);
+}
+
+void FirmwareSimulator::handleBinary(quint8 type, QByteArrayView payload)
+{
+    if (type & Protocol::kBinarySeqFlag)
+    {
+        if (payload.size() < 2)
+            return;
+        const quint16 seq = quint16(quint8(payload[0]) | (quint8(payload[1]) << 8));
+        if (!acceptSequence(seq))
+            return;
+        type = quint8(type & ~Protocol::kBinarySeqFlag);
+        payload = payload.sliced(2);
+    }
+
+    QVector<SimAction> actions;
+    QString err;
+    const DeviceModel::FrameKind kind = m_model.handleBinary(type, payload, actions, err);
+    const QByteArray label = "[BIN type=" + QByteArray::number(type) + " len=" + QByteArray::number(payload.size()) + "]";
+    handleParsed(kind, actions, err, label);
+}
+
+void FirmwareSimulator::handleParsed(DeviceModel::FrameKind kind, const QVector<SimAction>& actions,
+                                     const QString& err, QByteArrayView line)
+{
+    ++m_framesReceived;
+    const qint64 arrivalMs = deviceNowMs();
+
+    switch (kind)
+    {
+    case DeviceModel::FrameKind::VersionQuery:
+        if (m_link && m_link->isOpen())
+        {
+            m_tx.clear();
+            Protocol::writeVersionReply(m_tx, Protocol::kProtocolVersion, m_opt.binary, m_opt.sequenced,
+                                        m_opt.dictionary, m_opt.staging);
+            m_link->write(m_tx.bytes());
+        }
+        m_expectedSeq = 1;
+        m_hasStaged = false;
+        break;
+    case DeviceModel::FrameKind::Stage:
+        if (actions.isEmpty())
+        {
+            logLine(QStringLiteral("[%1] STAGE rejected: %2").arg(arrivalMs).arg(err));
+            sendReport(kErrRejected, err);
+            return;
+        }
+        m_staged = actions;
+        m_stagedId = m_model.stageId();
+        m_hasStaged = true;
+        if (m_opt.verbose)
+            logLine(QStringLiteral("[%1] STAGE %2: %3 steps").arg(arrivalMs).arg(m_stagedId).arg(actions.size()));
+        break;
+    case DeviceModel::FrameKind::Go:
+        if (!m_hasStaged || m_model.stageId() != m_stagedId)
+        {
+            logLine(QStringLiteral("[%1] GO %2: not staged").arg(arrivalMs).arg(m_model.stageId()));
+            sendReport(Protocol::kErrNotStaged, QStringLiteral("not staged"));
+            return;
+        }
+        m_hasStaged = false;
+        enqueueWork(m_staged, arrivalMs);
+        break;
+    case DeviceModel::FrameKind::ConfigHashQuery:
+        if (m_link && m_link->isOpen())
+        {
+            m_tx.clear();
+            Protocol::writeConfigHashReply(m_tx, m_model.configHashes());
+            m_link->write(m_tx.bytes());
+        }
+        break;
+    case DeviceModel::FrameKind::Work:
+        if (actions.isEmpty())
+        {
+            logLine(QStringLiteral("[%1] WORK rejected: %2").arg(arrivalMs).arg(err));
+            sendReport(kErrRejected, err);
+            return;
+        }
+        enqueueWork(actions, arrivalMs);
+        break;
+    case DeviceModel::FrameKind::Config:
+    case DeviceModel::FrameKind::Test:
+        if (m_opt.verbose)
+            logLine(QStringLiteral("[%1] %2").arg(arrivalMs).arg(QString::fromLatin1(line)));
+        break;
+    case DeviceModel::FrameKind::Unknown:
+        logLine(QStringLiteral("[%1] ignored (%2): %3").arg(arrivalMs).arg(err, QString::fromLatin1(line)));
+        sendReport(kErrRejected, err);
+        break;
+    }
+}
+
+void FirmwareSimulator::enqueueWork(const QVector<SimAction>& actions, qint64 arrivalMs)
+{
+    qint64 t = qMax(arrivalMs, m_busyUntilMs) + m_opt.frameLatencyMs;
+    for (const SimAction& a : actions)
+    {
+        qint64 dur = a.durationMs;
+        if (m_opt.jitterMs > 0)
+            dur += qint64(m_rng.bounded(2 * m_opt.jitterMs + 1)) - m_opt.jitterMs;
+        Step s;
+        s.startMs = t;
+        s.endMs = t + qMax<qint64>(0, dur);
+        m_steps.enqueue(s);
+        t = s.endMs;
+    }
+    m_segmentSizes.enqueue(int(actions.size()));
+    m_busyUntilMs = t;
+
+    if (m_opt.verbose)
+        logLine(QStringLiteral("[%1] WORK %2 steps, done at %3").arg(arrivalMs).arg(actions.size()).arg(t));
+
+    scheduleNext();
+}
+
+void FirmwareSimulator::scheduleNext()
+{
+    if (m_steps.isEmpty())
+        return;
+
+    const double waitDeviceMs = double(m_steps.head().endMs - deviceNowMs());
+    const int waitRealMs = qMax(0, int(std::ceil(waitDeviceMs / m_opt.timeScale)));
+    m_timer.start(waitRealMs);
+}
+
+void FirmwareSimulator::onTick()
+{
+    // Several steps may be due at once at high time scales.
+    const qint64 now = deviceNowMs();
+    while (!m_steps.isEmpty() && m_steps.head().endMs <= now)
+    {
+        const Step s = m_steps.dequeue();
+        if (m_stepInSegment == 0)
+            m_segmentStartMs = s.startMs;
+        ++m_stepInSegment;
+        reportStep(m_stepInSegment, s.startMs);
+
+        if (m_stepInSegment == m_segmentSizes.head())
+        {
+            emit segmentFinished(m_stepInSegment, m_segmentStartMs, s.endMs);
+            m_segmentSizes.dequeue();
+            m_stepInSegment = 0;
+        }
+    }
+    scheduleNext();
+}
+
+void FirmwareSimulator::reportStep(int step, qint64 startMs)
+{
+    if (!m_link || !m_link->isOpen())
+        return;
+
+    m_tx.clear();
+    Protocol::writeStepRun(m_tx, step, startMs);
+    m_link->write(m_tx.bytes());
+    ++m_stepsReported;
+}
+
+void FirmwareSimulator::logLine(const QString& text) const
+{
+    QTextStream err(stderr);
+    err << text << Qt::endl;
+}
+} // namespace FirmwareSim
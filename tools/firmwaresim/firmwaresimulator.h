@@ -0,0 +1,125 @@
+#pragma once
+/**
+ * @file firmwaresimulator.h
+ * @brief 模拟下位机：通过 Transport 接收帧，按 DeviceModel 计时执行 WORK 并回报 STEPRUN
+ *
+ * 时间：
+ * - 设备时间（deviceMs）从模拟器启动开始计，按 timeScale 加速（timeScale=60 时 1 分钟回放 1 小时）
+ * - STEPRUN:<step>,<startMs> 在该步完成时发出，startMs 为该步开始的设备时间
+ * - WORK 到达时若仍在执行上一段，按 FIFO 排队（与真实固件的命令缓冲一致）
+ *
+ * 调度按绝对截止时间计算，定时器误差不会累积到后续步骤上。
+ *
+ * 接收同时支持 CRLF 文本帧与 0xA5 开头的二进制帧；VER? 握手时按选项声明 BIN/SEQ/DICT/STAGE。
+ * STAGE 的动作放进单个暂存区，GO 时按 WORK 到达处理；编号不符回 ERR:2。
+ * CFGHASH? 回报各配置块最近一次被接受的指纹（DeviceModel::configHashes）。
+ * 序号帧按 protocol.h 的规则处理：按序执行并累计 ACK，缺号/校验错回 NAK，重复帧只补 ACK。
+ * lossPercent 随机丢弃收到的帧，用于验证上位机重发。
+ * 无法解析的帧回 ERR:<code>,<原因>。
+ */
+
+#include <QObject>
+#include <QQueue>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QVector>
+
+#include "devicemodel.h"
+#include "../../src/core/framewriter.h"
+
+class Transport;
+
+namespace FirmwareSim
+{
+struct SimOptions
+{
+    double timeScale = 1.0;      ///< >1 加速
+    int frameLatencyMs = 0;      ///< 收到 WORK 到开始执行的固定开销（设备时间）
+    int jitterMs = 0;            ///< 每步时长叠加 [-jitter, +jitter] 的均匀抖动
+    quint32 seed = 1;
+    bool verbose = false;
+    bool binary = true;          ///< 握手时声明支持二进制帧
+    bool sequenced = true;       ///< 握手时声明支持序号/确认
+    bool dictionary = true;      ///< 握手时声明支持语音短语字典（VOICEDEF）
+    bool staging = true;         ///< 握手时声明支持预取（STAGE/GO）
+    int lossPercent = 0;         ///< 随机丢弃收到的帧（0-100）
+};
+
+class FirmwareSimulator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FirmwareSimulator(const SimOptions& opt, QObject* parent = nullptr);
+
+    /**
+     * @brief 接管已打开的传输（不转移所有权）
+     */
+    void attach(Transport* link);
+    void detach();
+
+    qint64 deviceNowMs() const;
+
+    quint64 framesReceived() const { return m_framesReceived; }
+    quint64 stepsReported() const { return m_stepsReported; }
+    quint64 framesDropped() const { return m_framesDropped; }
+
+signals:
+    void segmentFinished(int steps, qint64 deviceStartMs, qint64 deviceEndMs);
+
+private slots:
+    void onReadyRead();
+    void onTick();
+
+private:
+    struct Step
+    {
+        qint64 startMs = 0;
+        qint64 endMs = 0;
+    };
+
+    void processRx();
+    void handleLine(QByteArrayView line);
+    void handleBinary(quint8 type, QByteArrayView payload);
+    bool acceptSequence(quint16 seq);   ///< true = execute this frame
+    void sendAck(quint16 seq, bool nak);
+    void sendReport(int code, const QString& detail); ///< ERR:<code>,<detail>
+
+    static constexpr int kErrRejected = 1; ///< frame could not be parsed / executed
+    bool dropForLoss();
+    void handleParsed(DeviceModel::FrameKind kind, const QVector<SimAction>& actions,
+                      const QString& err, QByteArrayView raw);
+    void enqueueWork(const QVector<SimAction>& actions, qint64 arrivalMs);
+    void scheduleNext();
+    void reportStep(int step, qint64 startMs);
+    void logLine(const QString& text) const;
+
+private:
+    SimOptions m_opt;
+    DeviceModel m_model;
+    Transport* m_link = nullptr;
+    QByteArray m_rxAccum;   ///< 未处理的接收字节（文本/二进制混合）
+    QByteArray m_readBuf;
+    Protocol::FrameWriter m_tx;
+    QRandomGenerator m_rng;
+
+    qint64 m_epochNs = 0;
+    QTimer m_timer;
+
+    // 待执行步骤（跨段连续排队），每段以 m_segmentSizes 分隔以便重新从 1 计数
+    QQueue<Step> m_steps;
+    QQueue<int> m_segmentSizes;
+    int m_stepInSegment = 0;
+    qint64 m_segmentStartMs = 0;
+    qint64 m_busyUntilMs = 0;
+
+    quint16 m_expectedSeq = 1;
+
+    QVector<SimAction> m_staged;
+    quint16 m_stagedId = 0;
+    bool m_hasStaged = false;
+
+    quint64 m_framesReceived = 0;
+    quint64 m_framesDropped = 0;
+    quint64 m_stepsReported = 0;
+};
+} // namespace FirmwareSim
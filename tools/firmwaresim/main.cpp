@@ -0,0 +1,172 @@
+/**
+ * @file main.cpp
+ * @brief firmware_sim：模拟下位机，供无实物联调、端到端延迟与段间间隔测量使用
+ *
+ * 用法：
+ *   firmware_sim --pty                      # 打印从端路径，上位机端口填该路径
+ *   firmware_sim --listen 5555              # 上位机端口填 tcp://127.0.0.1:5555
+ *   firmware_sim --connect COM7             # 任意传输描述（真实串口 / tcp:// 等）
+ *
+ *   --time-scale 60     设备时间加速 60 倍（8 小时浸泡约 8 分钟回放完）
+ *   --latency-ms 2      每个 WORK 从收到到开始执行的固定开销
+ *   --jitter-ms 5       每步时长的均匀抖动
+ *   --seed 1            抖动随机种子
+ *   --duration-s 600    运行指定秒数后退出（CI 用）
+ *   --text-only         握手时不声明二进制帧（测试上位机回落）
+ *   --no-seq            握手时不声明序号/确认
+ *   --loss-pct 5        随机丢弃 5% 收到的帧（验证上位机重发）
+ *   --verbose           打印配置/测试帧与每段计划
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+
+#include "firmwaresimulator.h"
+#include "../../src/services/transport.h"
+
+namespace
+{
+// Wraps a socket handed out by QTcpServer (already connected).
+class AcceptedSocketTransport : public IoDeviceTransport
+{
+public:
+    AcceptedSocketTransport(QTcpSocket* socket, QObject* parent)
+        : IoDeviceTransport(parent)
+        , m_socket(socket)
+    {
+        m_socket->setParent(this);
+        m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        attachDevice(m_socket);
+        connect(m_socket, &QAbstractSocket::errorOccurred, this, [this]() {
+            emit errorOccurred(m_socket->errorString());
+        });
+    }
+
+    bool open(QString&) override { return true; }
+    void close() override { m_socket->abort(); }
+    bool isOpen() const override { return m_socket->state() == QAbstractSocket::ConnectedState; }
+    QString description() const override
+    {
+        return QStringLiteral("TCP %1:%2").arg(m_socket->peerAddress().toString()).arg(m_socket->peerPort());
+    }
+
+private:
+    QTcpSocket* m_socket = nullptr;
+};
+
+void printLine(const QString& text)
+{
+    QTextStream out(stdout);
+    out << text << Qt::endl;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("firmware_sim"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Simulated lower-level device: executes WORK frames and reports STEPRUN."));
+    parser.addHelpOption();
+    const QCommandLineOption optPty(QStringLiteral("pty"), QStringLiteral("Create a pseudo-terminal and print its slave path."));
+    const QCommandLineOption optListen(QStringLiteral("listen"), QStringLiteral("Accept one TCP connection on 127.0.0.1:<port>."), QStringLiteral("port"));
+    const QCommandLineOption optConnect(QStringLiteral("connect"), QStringLiteral("Open a transport spec (serial port, tcp://host:port)."), QStringLiteral("spec"));
+    const QCommandLineOption optScale(QStringLiteral("time-scale"), QStringLiteral("Device clock speed-up factor."), QStringLiteral("factor"), QStringLiteral("1"));
+    const QCommandLineOption optLatency(QStringLiteral("latency-ms"), QStringLiteral("Fixed delay between WORK arrival and step 1."), QStringLiteral("ms"), QStringLiteral("0"));
+    const QCommandLineOption optJitter(QStringLiteral("jitter-ms"), QStringLiteral("Uniform +/- jitter added to every step."), QStringLiteral("ms"), QStringLiteral("0"));
+    const QCommandLineOption optSeed(QStringLiteral("seed"), QStringLiteral("Jitter RNG seed."), QStringLiteral("n"), QStringLiteral("1"));
+    const QCommandLineOption optDuration(QStringLiteral("duration-s"), QStringLiteral("Exit after this many (real) seconds."), QStringLiteral("s"), QStringLiteral("0"));
+    const QCommandLineOption optTextOnly(QStringLiteral("text-only"), QStringLiteral("Do not advertise binary framing in the VER reply."));
+    const QCommandLineOption optNoSeq(QStringLiteral("no-seq"), QStringLiteral("Do not advertise sequenced delivery (ACK/NAK)."));
+    const QCommandLineOption optNoDict(QStringLiteral("no-dict"), QStringLiteral("Do not advertise the voice phrase dictionary (VOICEDEF)."));
+    const QCommandLineOption optNoStage(QStringLiteral("no-stage"), QStringLiteral("Do not advertise segment prefetch (STAGE/GO)."));
+    const QCommandLineOption optLoss(QStringLiteral("loss-pct"), QStringLiteral("Randomly drop this percentage of received frames."), QStringLiteral("pct"), QStringLiteral("0"));
+    const QCommandLineOption optVerbose(QStringLiteral("verbose"), QStringLiteral("Log config/test frames and segment plans."));
+    parser.addOptions({optPty, optListen, optConnect, optScale, optLatency, optJitter, optSeed, optDuration, optTextOnly, optNoSeq, optNoDict, optNoStage, optLoss, optVerbose});
+    parser.process(app);
+
+    FirmwareSim::SimOptions opt;
+    opt.timeScale = parser.value(optScale).toDouble();
+    opt.frameLatencyMs = parser.value(optLatency).toInt();
+    opt.jitterMs = parser.value(optJitter).toInt();
+    opt.seed = parser.value(optSeed).toUInt();
+    opt.verbose = parser.isSet(optVerbose);
+    opt.binary = !parser.isSet(optTextOnly);
+    opt.sequenced = !parser.isSet(optNoSeq);
+    opt.dictionary = !parser.isSet(optNoDict);
+    opt.staging = !parser.isSet(optNoStage);
+    opt.lossPercent = qBound(0, parser.value(optLoss).toInt(), 100);
+    if (!(opt.timeScale > 0.0))
+    {
+        printLine(QStringLiteral("--time-scale must be > 0"));
+        return 2;
+    }
+
+    FirmwareSim::FirmwareSimulator sim(opt);
+    if (opt.verbose)
+    {
+        QObject::connect(&sim, &FirmwareSim::FirmwareSimulator::segmentFinished, &app,
+                         [](int steps, qint64 startMs, qint64 endMs) {
+            printLine(QStringLiteral("segment done: steps=%1 device=%2..%3 ms").arg(steps).arg(startMs).arg(endMs));
+        });
+    }
+
+    Transport* link = nullptr;
+    QTcpServer server;
+    QString err;
+
+    if (parser.isSet(optListen))
+    {
+        const quint16 port = quint16(parser.value(optListen).toUInt());
+        if (!server.listen(QHostAddress::LocalHost, port))
+        {
+            printLine(QStringLiteral("listen failed: %1").arg(server.errorString()));
+            return 1;
+        }
+        QObject::connect(&server, &QTcpServer::newConnection, &app, [&]() {
+            while (QTcpSocket* s = server.nextPendingConnection())
+            {
+                // One host at a time: a new connection replaces the old one.
+                sim.detach();
+                delete link;
+                link = new AcceptedSocketTransport(s, &app);
+                sim.attach(link);
+                printLine(QStringLiteral("connected: %1").arg(link->description()));
+            }
+        });
+        printLine(QStringLiteral("listening: tcp://127.0.0.1:%1").arg(server.serverPort()));
+    }
+    else
+    {
+        const QString spec = parser.isSet(optConnect) ? parser.value(optConnect) : QStringLiteral("pty");
+        link = Transport::create(spec, SerialParams(), &app, err);
+        if (!link || !link->open(err))
+        {
+            printLine(QStringLiteral("open %1 failed: %2").arg(spec, err));
+            return 1;
+        }
+        sim.attach(link);
+        printLine(link->description());
+        QObject::connect(link, &Transport::errorOccurred, &app, [&](const QString& e) {
+            printLine(QStringLiteral("link error: %1").arg(e));
+            if (!link->isOpen())
+                QCoreApplication::exit(1); // e.g. tcp:// connect refused or timed out
+        });
+    }
+
+    const int durationS = parser.value(optDuration).toInt();
+    if (durationS > 0)
+        QTimer::singleShot(durationS * 1000, &app, &QCoreApplication::quit);
+
+    const int rc = app.exec();
+    printLine(QStringLiteral("frames=%1 dropped=%2 steprun=%3 deviceMs=%4")
+                  .arg(sim.framesReceived()).arg(sim.framesDropped())
+                  .arg(sim.stepsReported()).arg(sim.deviceNowMs()));
+    return rc;
+}
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""Generate src/core/gbktable.inc (Unicode BMP -> GBK/CP936 double-byte codes).
+
+Usage: python3 tools/gbktable/gen_gbk_table.py > src/core/gbktable.inc
+
+The CJK Unified Ideographs block U+4E00..U+9FA5 is fully covered by GBK and is
+emitted as a dense array indexed by (codepoint - 0x4E00); every other mapped
+code point goes into a sorted (unicode, code) list searched with lower_bound.
+GB2312 is a subset of GBK with identical codes.
+"""
+
+CJK_FIRST = 0x4E00
+CJK_LAST = 0x9FA5
+PER_LINE = 12
+
+
+def gbk(cp):
+    try:
+        b = chr(cp).encode("gbk")
+    except UnicodeEncodeError:
+        return None
+    return (b[0] << 8) | b[1] if len(b) == 2 else None
+
+
+def main():
+    dense = [gbk(cp) for cp in range(CJK_FIRST, CJK_LAST + 1)]
+    assert all(dense), "GBK must cover the whole dense CJK range"
+
+    other = []
+    for cp in list(range(0x80, CJK_FIRST)) + list(range(CJK_LAST + 1, 0x10000)):
+        if 0xD800 <= cp < 0xE000:
+            continue
+        code = gbk(cp)
+        if code:
+            other.append((cp, code))
+
+    out = []
+    out.append("// Generated by tools/gbktable/gen_gbk_table.py -- do not edit.")
+    out.append("// Unicode BMP -> GBK (CP936) double-byte code, high byte first.")
+    out.append("")
+    out.append("constexpr char16_t kGbkCjkFirst = 0x%04X;" % CJK_FIRST)
+    out.append("constexpr char16_t kGbkCjkLast = 0x%04X;" % CJK_LAST)
+    out.append("")
+    out.append("constexpr quint16 kGbkCjk[] = {")
+    for i in range(0, len(dense), PER_LINE):
+        out.append("    " + " ".join("0x%04X," % c for c in dense[i:i + PER_LINE]))
+    out.append("};")
+    out.append("")
+    out.append("struct GbkPair")
+    out.append("{")
+    out.append("    char16_t unicode;")
+    out.append("    quint16 code;")
+    out.append("};")
+    out.append("")
+    out.append("constexpr GbkPair kGbkOther[] = {")
+    per = PER_LINE // 2
+    for i in range(0, len(other), per):
+        out.append("    " + " ".join("{0x%04X, 0x%04X}," % p for p in other[i:i + per]))
+    out.append("};")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()